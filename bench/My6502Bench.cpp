@@ -0,0 +1,333 @@
+#include <emu6502.h>
+#include <emu6502_blockcache.h>
+#include <emu6502_bus.h>
+#include <emu6502_jit.h>
+#include <emu6502_paged.h>
+#include <emu6502_profile.h>
+#include <emu6502_trace.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#define MY6502_BENCH_HOST_CYCLES 1
+#else
+#define MY6502_BENCH_HOST_CYCLES 0
+#endif
+
+#ifndef MY6502_BENCH_BUILD_TYPE
+#define MY6502_BENCH_BUILD_TYPE "unknown"
+#endif
+
+/** Throughput of the emulator. Micro benchmarks run one opcode group or
+ *  addressing mode on the interpreter, macro benchmarks run mixed code on
+ *  every engine. A workload is straight line code repeated from
+ *  PROGRAM_START, one pass runs it once with exactly the cycles it takes.
+ *  On x86-64 the host clock is the time stamp counter, ins/clk are the
+ *  emulated instructions per tick of it, 0 elsewhere.
+ *
+ *  usage: my6502_bench [--out results.json] [--min-time seconds] [--quick]
+ **/
+
+namespace {
+
+  using namespace my6502;
+  using Clock = std::chrono::steady_clock;
+
+  constexpr Word PROGRAM_START = 0x4000;
+  constexpr Word PROGRAM_LIMIT = 0xE000;
+  constexpr Word SUBROUTINE    = 0xF000;
+  constexpr Word DATA          = 0x3000;
+
+  struct Workload {
+    const char *name;
+    const char *group;
+    std::vector<Byte> pattern;
+  };
+
+  /** a prepared workload **/
+  struct Program {
+    CPU start;
+    Word end;          // address after the last instruction
+    u32 instructions;  // per pass
+    s32 cycles;        // per pass
+  };
+
+  struct Result {
+    std::string name;
+    std::string group;
+    std::string engine;
+    u32 instructions;
+    s32 cycles;
+    double seconds;    // best time of one pass
+    double hostCycles; // of the best pass, 0 without a host clock
+  };
+
+  /** the host clock, 0 without one **/
+  std::uint64_t HostCycles() {
+#if MY6502_BENCH_HOST_CYCLES
+    return __rdtsc();
+#else
+    return 0;
+#endif
+  }
+
+  /** the best time of one pass **/
+  struct Timed {
+    double seconds;
+    double hostCycles;
+  };
+
+  /** the registers and data every workload expects, no indexed access
+   *  crosses a page **/
+  Program Prepare(Mem &mem, const Workload &workload) {
+    Program program{};
+    program.start.Reset(PROGRAM_START, mem);
+    program.start.indexRegX = 0x01;
+    program.start.indexRegY = 0x01;
+    // ($20,X) and ($20),Y both point at DATA
+    mem[0x0020] = DATA & 0xFF;
+    mem[0x0021] = DATA >> 8;
+    mem[0x0022] = DATA >> 8;
+    for (u32 i = 0; i < 0x100; i++) {
+      mem[DATA + i] = static_cast<Byte>(i);
+    }
+    mem[SUBROUTINE]     = CPU::INS_LDY_IMMEDIATE;
+    mem[SUBROUTINE + 1] = 0x01;
+    mem[SUBROUTINE + 2] = CPU::INS_RTS;
+
+    u32 address = PROGRAM_START;
+    while (address + workload.pattern.size() <= PROGRAM_LIMIT) {
+      for (Byte b : workload.pattern) {
+        mem[address++] = b;
+      }
+    }
+    program.end = static_cast<Word>(address);
+
+    // one reference pass on the interpreter gives the cycles of a pass
+    CPU cpu = program.start;
+    while (cpu.programCounter != program.end) {
+      program.cycles += cpu.Execute(1, mem).cyclesUsed;
+      program.instructions++;
+    }
+    return program;
+  }
+
+  /** best time per pass, each of the repeats runs for at least minTime **/
+  Timed Time(const std::function<void()> &pass, double minTime) {
+    Timed best{1e30, 0};
+    for (int repeat = 0; repeat < 3; repeat++) {
+      u32 passes = 0;
+      double elapsed = 0;
+      const Clock::time_point t0 = Clock::now();
+      const std::uint64_t c0 = HostCycles();
+      do {
+        pass();
+        passes++;
+        elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+      } while (elapsed < minTime);
+      if (elapsed / passes < best.seconds) {
+        best = {elapsed / passes, static_cast<double>(HostCycles() - c0) / passes};
+      }
+    }
+    return best;
+  }
+
+  /** a pass must use the cycles of the reference pass and stop at the end **/
+  void Check(const Program &program, const CPU &cpu, s32 cyclesUsed, const char *engine) {
+    if (cyclesUsed != program.cycles || cpu.programCounter != program.end) {
+      fprintf(stderr, "%s: pass used %d cycles and stopped at $%04X, expected %d and $%04X\n",
+        engine, cyclesUsed, cpu.programCounter, program.cycles, program.end);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  std::vector<Workload> MicroWorkloads() {
+    return {
+      {"lda-ldx-ldy #imm",   "load",  {CPU::INS_LDA_IMMEDIATE, 0x01, CPU::INS_LDX_IMMEDIATE, 0x01,
+                                       CPU::INS_LDY_IMMEDIATE, 0x01}},
+      {"lda zp",             "load",  {CPU::INS_LDA_ZEROPAGE, 0x40}},
+      {"lda zp,x",           "load",  {CPU::INS_LDA_ZEROPX, 0x40}},
+      {"ldx zp,y",           "load",  {CPU::INS_LDX_ZEROPY, 0x40, CPU::INS_LDX_IMMEDIATE, 0x01}},
+      {"lda abs",            "load",  {CPU::INS_LDA_ABS, 0x00, DATA >> 8}},
+      {"lda abs,x",          "load",  {CPU::INS_LDA_ABSX, 0x00, DATA >> 8}},
+      {"lda abs,y",          "load",  {CPU::INS_LDA_ABSY, 0x00, DATA >> 8}},
+      {"lda (zp,x)",         "load",  {CPU::INS_LDA_INDIRECTX, 0x1F}},
+      {"lda (zp),y",         "load",  {CPU::INS_LDA_INDIRECTY, 0x20}},
+      {"sta zp",             "store", {CPU::INS_STA_ZEROPAGE, 0x40}},
+      {"sta zp,x",           "store", {CPU::INS_STA_ZEROPAGEX, 0x40}},
+      {"sta abs",            "store", {CPU::INS_STA_ABSOLUTE, 0x00, DATA >> 8}},
+      {"sta abs,x",          "store", {CPU::INS_STA_ABSOLUTEX, 0x00, DATA >> 8}},
+      {"sta abs,y",          "store", {CPU::INS_STA_ABSOLUTEY, 0x00, DATA >> 8}},
+      {"sta (zp,x)",         "store", {CPU::INS_STA_INDIRECTX, 0x1F}},
+      {"sta (zp),y",         "store", {CPU::INS_STA_INDIRECTY, 0x20}},
+      {"stx-sty zp",         "store", {CPU::INS_STX_ZEROPAGE, 0x40, CPU::INS_STY_ZEROPAGE, 0x41}},
+      {"stx-sty abs",        "store", {CPU::INS_STX_ABSOLUTE, 0x00, DATA >> 8,
+                                       CPU::INS_STY_ABSOLUTE, 0x01, DATA >> 8}},
+      {"sty zp,x",           "store", {CPU::INS_STY_ZEROPAGEX, 0x40}},
+      {"jsr-rts",            "call",  {CPU::INS_JSR, SUBROUTINE & 0xFF, SUBROUTINE >> 8}},
+    };
+  }
+
+  std::vector<Workload> MacroWorkloads() {
+    return {
+      // a table copy: fetch through a pointer, index, store, call a helper
+      {"copy-loop-body",     "macro", {CPU::INS_LDA_IMMEDIATE, 0x12, CPU::INS_STA_ZEROPAGE, 0x40,
+                                       CPU::INS_LDX_ZEROPAGE, 0x40, CPU::INS_LDA_ABSX, 0x00, DATA >> 8,
+                                       CPU::INS_STA_ABSOLUTE, 0x00, (DATA >> 8) + 1,
+                                       CPU::INS_LDY_IMMEDIATE, 0x01, CPU::INS_LDA_INDIRECTY, 0x20,
+                                       CPU::INS_STA_ZEROPAGEX, 0x20, CPU::INS_JSR, SUBROUTINE & 0xFF,
+                                       SUBROUTINE >> 8}},
+      // register shuffling through the zero page, no calls
+      {"zero-page-shuffle",  "macro", {CPU::INS_LDA_ZEROPAGE, 0x40, CPU::INS_LDX_ZEROPAGE, 0x41,
+                                       CPU::INS_STA_ZEROPAGE, 0x41, CPU::INS_STX_ZEROPAGE, 0x40,
+                                       CPU::INS_LDY_ZEROPX, 0x41, CPU::INS_STY_ZEROPAGE, 0x42,
+                                       CPU::INS_LDX_IMMEDIATE, 0x01}},
+    };
+  }
+
+  Byte OpenBus(void *, Word address) { return static_cast<Byte>(address >> 8); }
+  void IgnoreWrite(void *, Word, Byte) {}
+
+  /** one pass per engine, every engine starts from the same memory **/
+  void RunEngines(const Workload &workload, double minTime, std::vector<Result> &results) {
+    auto mem = std::make_unique<Mem>();
+    const Program program = Prepare(*mem, workload);
+    auto record = [&](const char *engine, Timed best) {
+      results.push_back({workload.name, workload.group, engine,
+        program.instructions, program.cycles, best.seconds, best.hostCycles});
+    };
+
+    record("interpreter", Time([&] {
+      CPU cpu = program.start;
+      Check(program, cpu, cpu.Execute(program.cycles, *mem).cyclesUsed, "interpreter");
+    }, minTime));
+    if (std::strcmp(workload.group, "macro") != 0) {
+      return;
+    }
+
+    PagedMem paged(*mem);
+    record("paged", Time([&] {
+      CPU cpu = program.start;
+      Check(program, cpu, cpu.Execute(program.cycles, paged).cyclesUsed, "paged");
+    }, minTime));
+
+    // one device page past the program keeps every access on the page table
+    Bus bus(*mem);
+    bus.MapDevice(PROGRAM_LIMIT >> 8, PROGRAM_LIMIT >> 8, &OpenBus, &IgnoreWrite, nullptr);
+    record("bus", Time([&] {
+      CPU cpu = program.start;
+      Check(program, cpu, cpu.Execute(program.cycles, bus).cyclesUsed, "bus");
+    }, minTime));
+
+    // what recording costs the emulating thread, the recorder has no file
+    // open so there is no drain competing for the host
+    TraceRecorder recorder(*mem);
+    record("trace", Time([&] {
+      CPU cpu = program.start;
+      Check(program, cpu, cpu.Execute(program.cycles, *mem, recorder).cyclesUsed, "trace");
+    }, minTime));
+
+    BlockCache cache;
+    record("blockcache", Time([&] {
+      CPU cpu = program.start;
+      Check(program, cpu, cache.Execute(cpu, program.cycles, *mem), "blockcache");
+    }, minTime));
+
+    // fused from a profile of one pass on the interpreter
+    SequenceProfile sequences;
+    CPU profiled = program.start;
+    profiled.Execute(program.cycles, *mem, sequences);
+    BlockCache fused;
+    fused.Fuse(Superinstructions::Hot(sequences));
+    record("fused", Time([&] {
+      CPU cpu = program.start;
+      Check(program, cpu, fused.Execute(cpu, program.cycles, *mem), "fused");
+    }, minTime));
+
+    if (Jit::IsSupported()) {
+      Jit jit;
+      record("jit", Time([&] {
+        CPU cpu = program.start;
+        Check(program, cpu, jit.Execute(cpu, program.cycles, *mem), "jit");
+      }, minTime));
+    }
+  }
+
+  double InstructionsPerHostCycle(const Result &r) {
+    return r.hostCycles > 0 ? r.instructions / r.hostCycles : 0;
+  }
+
+  bool WriteJson(const char *path, const std::vector<Result> &results) {
+    FILE *out = fopen(path, "w");
+    if (out == nullptr) {
+      return false;
+    }
+    fprintf(out, "{\n  \"build_type\": \"%s\",\n  \"results\": [\n", MY6502_BENCH_BUILD_TYPE);
+    for (size_t i = 0; i < results.size(); i++) {
+      const Result &r = results[i];
+      const double ns = r.seconds * 1e9 / r.instructions;
+      fprintf(out, "    {\"name\": \"%s\", \"group\": \"%s\", \"engine\": \"%s\", "
+        "\"instructions\": %u, \"cycles\": %d, \"emulated_mhz\": %.3f, "
+        "\"mips\": %.3f, \"ns_per_instruction\": %.4f, \"ipc\": %.4f, "
+        "\"instructions_per_host_cycle\": %.4f}%s\n",
+        r.name.c_str(), r.group.c_str(), r.engine.c_str(), r.instructions, r.cycles,
+        r.cycles / r.seconds / 1e6, r.instructions / r.seconds / 1e6, ns,
+        static_cast<double>(r.instructions) / r.cycles, InstructionsPerHostCycle(r),
+        i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    return fclose(out) == 0;
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *outPath = "my6502_bench.json";
+  double minTime = 0.2;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      outPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      minTime = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--quick") == 0) {
+      minTime = 0.002;
+    } else {
+      fprintf(stderr, "usage: %s [--out results.json] [--min-time seconds] [--quick]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (std::strcmp(MY6502_BENCH_BUILD_TYPE, "Debug") == 0) {
+    fprintf(stderr, "warning: Debug build, configure with -DCMAKE_BUILD_TYPE=Release\n");
+  }
+
+  std::vector<Result> results;
+  for (const Workload &workload : MicroWorkloads()) {
+    RunEngines(workload, minTime, results);
+  }
+  for (const Workload &workload : MacroWorkloads()) {
+    RunEngines(workload, minTime, results);
+  }
+
+  printf("%-20s %-6s %-12s %10s %10s %8s %6s %8s\n",
+    "workload", "group", "engine", "MHz", "MIPS", "ns/ins", "IPC", "ins/clk");
+  for (const Result &r : results) {
+    printf("%-20s %-6s %-12s %10.2f %10.2f %8.2f %6.3f %8.4f\n",
+      r.name.c_str(), r.group.c_str(), r.engine.c_str(),
+      r.cycles / r.seconds / 1e6, r.instructions / r.seconds / 1e6,
+      r.seconds * 1e9 / r.instructions, static_cast<double>(r.instructions) / r.cycles,
+      InstructionsPerHostCycle(r));
+  }
+  if (!WriteJson(outPath, results)) {
+    fprintf(stderr, "could not write %s\n", outPath);
+    return EXIT_FAILURE;
+  }
+  printf("results written to %s\n", outPath);
+  return EXIT_SUCCESS;
+}
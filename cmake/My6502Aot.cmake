@@ -0,0 +1,32 @@
+# Ahead of time translation of ROM images with my6502_aot, see include/emu6502_aot.h
+set(MY6502_AOT_MAIN ${CMAKE_CURRENT_LIST_DIR}/../tools/my6502_aot_main.cpp)
+
+# my6502_aot_translate(<target> IMAGE <file> FORMAT <raw|prg|hex|nes> [ADDRESS <hex>] [NAME <symbol>])
+# adds the translation unit of the image to target, it defines the
+# my6502::StaticCode::Program NAME, my6502_program unless given
+function(my6502_aot_translate target)
+  cmake_parse_arguments(AOT "" "IMAGE;FORMAT;ADDRESS;NAME" "" ${ARGN})
+  if(NOT AOT_NAME)
+    set(AOT_NAME my6502_program)
+  endif()
+  set(options --name ${AOT_NAME})
+  if(AOT_ADDRESS)
+    list(APPEND options --address ${AOT_ADDRESS})
+  endif()
+  get_filename_component(image ${AOT_IMAGE} ABSOLUTE)
+  set(source ${CMAKE_CURRENT_BINARY_DIR}/${target}_${AOT_NAME}.cpp)
+  add_custom_command(OUTPUT ${source}
+    COMMAND my6502_aot ${image} ${AOT_FORMAT} ${source} ${options}
+    DEPENDS my6502_aot ${image}
+    COMMENT "Translating ${AOT_IMAGE}"
+    VERBATIM)
+  target_sources(${target} PRIVATE ${source})
+  target_link_libraries(${target} PRIVATE my6502)
+endfunction()
+
+# my6502_add_aot_executable(<target> IMAGE <file> FORMAT <raw|prg|hex|nes> [ADDRESS <hex>])
+# a native executable running the image, see tools/my6502_aot_main.cpp
+function(my6502_add_aot_executable target)
+  add_executable(${target} ${MY6502_AOT_MAIN})
+  my6502_aot_translate(${target} ${ARGN})
+endfunction()
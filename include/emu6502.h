@@ -1,7 +1,9 @@
 #pragma once
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <cstdint>
 
 namespace my6502 {
   // TODO: use value uint_8t etc
@@ -12,24 +14,76 @@ namespace my6502 {
   using s32 = signed int;
 
   struct Mem;
+  struct PagedMem;
+  struct Bus;
   struct CPU;
   struct StatusFlags;
+  struct StopConditions;
+  struct ExecResult;
+  struct InterruptController;
+
+  /** Why a run of the CPU returned **/
+  enum class StopReason : Byte {
+    Cycles,        // the budget ran out
+    IllegalOpcode, // the next opcode has no handler, address is its PC
+    Halt,          // the next opcode locks up a 6502 until reset, KIL, address is its PC
+    Interrupt,     // CLI or RTI cleared I while irqLine is set, the IRQ is due, see emu6502_irq.h
+    // only from CPU::RunUntil, see emu6502_debug.h
+    Instructions,  // StopConditions::instructions ran
+    Breakpoint,    // the next instruction is at a breakpoint
+    ReadWatch,     // the last instruction read a watched address, address is that
+    WriteWatch,    // the last instruction wrote a watched address, address is that
+    Predicate      // StopConditions::predicate returned true
+  };
 }
 
 
 struct my6502::Mem {
   static constexpr u32 MAX_MEM = 1024 * 64;
+  static constexpr u32 PAGE_SIZE = 256;
+  static constexpr u32 NUM_PAGES = MAX_MEM / PAGE_SIZE;
   Byte Data[MAX_MEM];
+  /* bumped on every write access to a page, lets caches of decoded code
+     notice that the bytes they were built from changed */
+  u32 pageVersion[NUM_PAGES];
+  /* pageVersion of every page when it was last cleared, a page whose
+     version moved on since is dirty */
+  u32 clearedVersion[NUM_PAGES];
+  /* false until the first Initialize, which clears every page */
+  bool cleared = false;
 
+	/** a byte through operator[], assigning to it is a write and bumps
+	 *  pageVersion, reading it is not **/
+	struct Cell {
+		Mem &mem;
+		u32 address;
+		Cell &operator=(Byte value) { mem.Write(address, value); return *this; }
+		Cell &operator=(const Cell &other) { return *this = static_cast<Byte>(other); }
+		operator Byte() const { return mem.Data[address]; }
+	};
+
+	/* zeroes the memory, only the pages written since the last call
+	   need clearing, all writes go through operator[] or bump pageVersion */
 	void Initialize() {
-		for (u32 i = 0; i < MAX_MEM; i++) {
-			Data[i] = 0;
+		if (!cleared) {
+			memset(Data, 0, MAX_MEM);
+			for (u32 page = 0; page < NUM_PAGES; page++) {
+				clearedVersion[page] = ++pageVersion[page];
+			}
+			cleared = true;
+			return;
+		}
+		for (u32 page = 0; page < NUM_PAGES; page++) {
+			if (pageVersion[page] != clearedVersion[page]) {
+				memset(Data + page * PAGE_SIZE, 0, PAGE_SIZE);
+				clearedVersion[page] = ++pageVersion[page];
+			}
 		}
 	}
 
  	/* write access */
-	Byte& operator[](u32 address)  {
-		return Data[address];
+	Cell operator[](u32 address)  {
+		return Cell{*this, address};
 	}
         
 	/* readable access */
@@ -37,6 +91,11 @@ struct my6502::Mem {
 		return Data[address];
 	}
 
+	void Write(u32 address, Byte value) {
+		pageVersion[(address >> 8) & (NUM_PAGES - 1)]++;
+		Data[address] = value;
+	}
+
 };
 
 struct my6502::StatusFlags {
@@ -49,7 +108,22 @@ struct my6502::StatusFlags {
   Byte negativeFlag : 1;  
 };
 
-struct my6502::CPU {
+/** What a run of the CPU did. A run that stops at an opcode stops in
+ *  front of it, programCounter points at the opcode and nothing of it
+ *  was executed or charged. **/
+struct my6502::ExecResult {
+  StopReason reason;
+  s32 cyclesUsed;             // instructions under CPU::Timing::Fast
+  std::uint64_t instructions; // retired
+  Word address;
+};
+
+/** The registers come first and all of the state fits in one cache
+ *  line, a CPU is aligned to it so CPUs side by side in an array, run
+ *  by different threads, never share a line. CPU::Execute copies it into
+ *  locals of its dispatch loop and writes it back when it returns. **/
+struct alignas(64) my6502::CPU {
+  static constexpr u32 CACHE_LINE = 64;
 
   Word programCounter;
   Byte stackPointer;
@@ -70,26 +144,45 @@ struct my6502::CPU {
     StatusFlags Flag;
   };
 
-  void Reset(Mem& memory) {
+  /* Z and N while they are deferred, see DeferredFlags: Z is set when
+     the low byte is 0, N when bit 7 or bit 8 is set, bit 8 only stands
+     for Z and N both set which no result byte can express */
+  Word flagResult;
+
+  /* set by InterruptController while an IRQ source holds the line, CLI
+     and RTI stop the run when they unmask it, see emu6502_irq.h */
+  bool irqLine;
+
+  static constexpr Word NMI_VECTOR = 0xFFFA;
+  static constexpr Word IRQ_VECTOR = 0xFFFE; // BRK too
+
+  template <typename Memory>
+  void Reset(Memory &memory) {
     Reset(0xFFFC, memory);
   }
 
-  void Reset(Word ResetVector, Mem &memory) {
+  template <typename Memory>
+  void Reset(Word ResetVector, Memory &memory) {
     programCounter = ResetVector;
     stackPointer = 0xFF;
     Flag.carryFlag = Flag.zeroFlag = Flag.interruptDisable = Flag.decimalMode = Flag.breakCommand = Flag.overflowFlag = Flag.negativeFlag = 0;
     accumulator = indexRegX = indexRegY = 0;
+    irqLine = false;
 		memory.Initialize();
   }
 
-  Byte FetchByte(s32& cycles, const Mem &memory) {
+  // the bus helpers take any memory with Mem's operator[], Mem, PagedMem or Bus
+
+  template <typename Memory>
+  Byte FetchByte(s32& cycles, const Memory &memory) {
     Byte Data = memory[programCounter];
     programCounter++;
     cycles--;
 		return Data;
   }
 
-  Word FetchWord(s32 &cycles, const Mem &memory) {
+  template <typename Memory>
+  Word FetchWord(s32 &cycles, const Memory &memory) {
 		// 6502 is little endian
     Word Data = memory[programCounter];
     programCounter++;
@@ -100,52 +193,101 @@ struct my6502::CPU {
 		return Data;
   }  
 
-  Byte ReadByte(Word address, s32 &cycles, const Mem &memory) {
+  template <typename Memory>
+  Byte ReadByte(Word address, s32 &cycles, const Memory &memory) {
     Byte Data = memory[address];
     cycles--;
     return Data;
   }
 
-  Word ReadWord(Word address, s32 &cycles, const Mem &memory) {
+  template <typename Memory>
+  Word ReadWord(Word address, s32 &cycles, const Memory &memory) {
     Byte loByte = ReadByte(address, cycles, memory);
     Byte hiByte = ReadByte(address + 1, cycles, memory);
     return loByte | (hiByte << 8);
   }
 
   /* write 1 byte to memory*/
-  void WriteByte(Byte value, Word address, s32 &cycles, Mem &memory) {
+  template <typename Memory>
+  void WriteByte(Byte value, Word address, s32 &cycles, Memory &memory) {
     memory[address] = value;
     cycles--;
   }
 
   /* write 2 byte to memory */
+  template <typename Memory>
  	void WriteWord(Word value,
 								 Word address,
 								 s32& cycles,
-                 Mem &memory) {
+                 Memory &memory) {
 		memory[address]			= value & 0xFF;
 		memory[address + 1] = (value >> 8);
 		cycles -= 2;
 	}
 
-  /* return the stackpointer as a full 16-bit address (in the first page) */
+  /* return the stackpointer as a full 16-bit address (in page one) */
   Word SPToAddress() const {
-    return 0x1000 | stackPointer;
+    return 0x0100 | stackPointer;
   }
 
   /* push the PC-1 onto the stack */
-  void PushPCToStack( s32& cycles, Mem& memory) {
+  template <typename Memory>
+  void PushPCToStack( s32& cycles, Memory& memory) {
     WriteWord(programCounter - 1, SPToAddress() - 1, cycles, memory);
 		stackPointer -= 2;
   }
 
-  Word PopWordFromStack( s32& cycles, Mem& memory) {
+  template <typename Memory>
+  Word PopWordFromStack( s32& cycles, Memory& memory) {
 		Word valueFromStack = ReadWord(SPToAddress() + 1, cycles, memory);
     stackPointer += 2;
     cycles--;
     return valueFromStack;
   }
 
+  template <typename Memory>
+  void PushByteToStack(Byte value, s32 &cycles, Memory &memory) {
+    WriteByte(value, SPToAddress(), cycles, memory);
+    stackPointer--;
+  }
+
+  template <typename Memory>
+  Byte PopByteFromStack(s32 &cycles, Memory &memory) {
+    stackPointer++;
+    return ReadByte(SPToAddress(), cycles, memory);
+  }
+
+  /* the processor status as the 6502 pushes it, NV-BDIZC with bit 5
+     always set and B only set by BRK and PHP */
+  Byte StatusToPush(bool Break) const {
+    return Flag.carryFlag | (Flag.zeroFlag << 1) | (Flag.interruptDisable << 2) | (Flag.decimalMode << 3)
+         | (Break ? 0x10 : 0x00) | 0x20 | (Flag.overflowFlag << 6) | (Flag.negativeFlag << 7);
+  }
+
+  /* takes back a status pushed by StatusToPush, B is not a flag of the
+     processor and keeps its value, the deferred Z and N follow */
+  void StatusFromStack(Byte status) {
+    Flag.carryFlag = status & 0x01;
+    Flag.zeroFlag = (status >> 1) & 1;
+    Flag.interruptDisable = (status >> 2) & 1;
+    Flag.decimalMode = (status >> 3) & 1;
+    Flag.overflowFlag = (status >> 6) & 1;
+    Flag.negativeFlag = (status >> 7) & 1;
+    DeferFlags();
+  }
+
+  /* the interrupt sequence of BRK, IRQ and NMI: push the PC and the
+     status, set I and continue at the address in the vector, 6 bus
+     cycles, Z and N have to be resolved */
+  template <typename Memory>
+  void EnterInterrupt(Word Vector, bool Break, s32 &cycles, Memory &memory) {
+    PushByteToStack(programCounter >> 8, cycles, memory);
+    PushByteToStack(programCounter & 0xFF, cycles, memory);
+    PushByteToStack(StatusToPush(Break), cycles, memory);
+    Flag.interruptDisable = 1;
+    programCounter = ReadWord(Vector, cycles, memory);
+  }
+
   // LDA
   static constexpr Byte INS_LDA_IMMEDIATE = 0xA9;
 	static constexpr Byte INS_LDA_ZEROPAGE	= 0xA5;
@@ -185,6 +327,79 @@ struct my6502::CPU {
 
   static constexpr Byte INS_JSR = 0x20;
   static constexpr Byte INS_RTS = 0x60;
+  static constexpr Byte INS_JMP_ABSOLUTE = 0x4C;
+  static constexpr Byte INS_BPL = 0x10;
+  static constexpr Byte INS_BMI = 0x30;
+  static constexpr Byte INS_BVC = 0x50;
+  static constexpr Byte INS_BVS = 0x70;
+  static constexpr Byte INS_BCC = 0x90;
+  static constexpr Byte INS_BCS = 0xB0;
+  static constexpr Byte INS_BNE = 0xD0;
+  static constexpr Byte INS_BEQ = 0xF0;
+  static constexpr Byte INS_BRK = 0x00;
+  static constexpr Byte INS_RTI = 0x40;
+  static constexpr Byte INS_CLI = 0x58;
+  static constexpr Byte INS_SEI = 0x78;
+
+  /** Addressing mode of an opcode, as recorded in the opcode table **/
+  enum class AddrMode : Byte {
+    Implied,
+    Immediate,
+    ZeroPage,
+    ZeroPageX,
+    ZeroPageY,
+    Absolute,
+    AbsoluteX,
+    AbsoluteY,
+    IndirectX,
+    IndirectY,
+    Accumulator, // ASL A and friends
+    Relative,    // branches
+    Indirect     // JMP ($1234)
+  };
+
+  /** What crossing a page boundary costs on top of the base cycles **/
+  enum class PageCross : Byte {
+    None,    // no extra cycle, or it is always taken and part of the base
+    OnCross, // one extra cycle when the effective address crosses a page
+    Branch   // one extra cycle when taken, one more when the target is on another page
+  };
+
+  /** How Execute accounts for time. Exact charges every instruction the
+   *  cycles of the opcode table, page crossing and branch penalties
+   *  included, the budget and the result are cycles. Fast does no cycle
+   *  accounting, every instruction costs 1, the budget and the result
+   *  are instructions. Both leave the CPU and memory in the same state
+   *  after the same instructions. **/
+  enum class Timing : Byte {
+    Exact,
+    Fast
+  };
+
+  /** executes one instruction whose opcode byte has already been fetched,
+   *  cycles are passed by value and the cycles left are returned **/
+  template <typename Memory>
+  using Handler = s32 (*)(CPU &cpu, s32 cycles, Memory &memory);
+  using OpHandler = Handler<Mem>;
+
+  /** One entry of the 256 entry dispatch table **/
+  template <typename Memory>
+  struct BasicOpcode {
+    Handler<Memory> handler;
+    AddrMode mode;
+    Byte cycles;         // base cycles including the opcode fetch, 0 if not handled
+    PageCross pageCross;
+  };
+  using Opcode = BasicOpcode<Mem>;
+
+  /** return the dispatch table entry for an opcode **/
+  static const Opcode &Decode(Byte Ins);
+
+  /** true when an indexed address costs the extra page crossing cycle,
+   *  its high byte differs from that of the base address **/
+  static bool PageCrossed(Word address, Word effectiveAddress) {
+    return ((address ^ effectiveAddress) & 0xFF00) != 0;
+  }
 
   /** Sets the correct process status after a load register instruction **/
 	void LoadRegisterSetStatus(Byte Register) {
@@ -192,34 +407,81 @@ struct my6502::CPU {
 		Flag.negativeFlag = (Register & 0b10000000) > 0;
   }
 
-  /** return the number of cycles used **/
-  s32 Execute(s32 cycles, Mem &memory);
-  /** Addressing mode - zero page **/
-  Word AddrZeroPage(s32 &cycles, const Mem &memory);
-  /** Addressing mode - zero page with x offset **/
-  Word AddrZeroPageX(s32 &cycles, const Mem &memory);
-  /** Addressing mode - zero page with y offset **/
-	Word AddrZeroPageY(s32& cycles, const Mem& memory);  
-  /** Addressing mode - absolute **/
-  Word AddrAbsolute(s32 &cycles, const Mem &memory);
-  /** Addressing mode - absolute with x offset **/
-  Word AddrAbsoluteX(s32 &cycles, const Mem &memory);
-  /** Addressing mode - absolute with x offset
-   *  - always take a cycle for the x page boundary
-   *  - See STA Absolute, X **/
-  Word AddrAbsoluteX_5(s32 &cycles, const Mem &memory);
-  /** Addressing mode - absolute with y offset **/
-  Word AddrAbsoluteY(s32 &cycles, const Mem &memory);
-  /** Addressing mode - absolute with y offset
-   *  - always take a cycle for the y page boundary
-   *  - See STA Absolute, Y **/
-  Word AddrAbsoluteY_5(s32 &cycles, const Mem &memory);
-  /** Addressing mode - indirect x | indexed indirect **/
-  Word AddrIndirectX(s32 &cycles, const Mem &memory);
-  /** Addressing mode - indirect y | indirect indexed **/
-  Word AddrIndirectY(s32 &cycles, const Mem &memory);
-  /** Addressing mode - indirect y | indirect indexed
-   *  - always take a cycle for the y page boundary
-   *  - See STA Indirect, Y **/
-  Word AddrIndirectY_6(s32 &cycles, const Mem &memory);
+  /** Same as LoadRegisterSetStatus while the flags are deferred, only
+   *  records the result, Z and N are worked out when they are read **/
+  void SetResultFlags(Byte Register) {
+    flagResult = Register;
+  }
+
+  /** Defers Z and N for its lifetime. The engines hold one while they
+   *  run instructions, so a load costs one store instead of updating two
+   *  bitfields, processorStatus is exact again once it is destroyed.
+   *  Code that reads Z or N in between,
+   *  e.g. PHP, BRK or branches, calls ResolveFlags first. **/
+  struct DeferredFlags {
+    CPU &cpu;
+    explicit DeferredFlags(CPU &cpu) : cpu(cpu) {
+      cpu.DeferFlags();
+    }
+    ~DeferredFlags() { cpu.ResolveFlags(); }
+    DeferredFlags(const DeferredFlags &) = delete;
+    DeferredFlags &operator=(const DeferredFlags &) = delete;
+  };
+
+  /** starts deferring Z and N from processorStatus **/
+  void DeferFlags() {
+    flagResult = Flag.zeroFlag ? (Flag.negativeFlag ? 0x100 : 0x00) : (Flag.negativeFlag ? 0x80 : 0x01);
+  }
+
+  /** writes the deferred Z and N into processorStatus **/
+  void ResolveFlags() {
+    Flag.zeroFlag = (flagResult & 0xFF) == 0;
+    Flag.negativeFlag = (flagResult & 0x180) != 0;
+  }
+
+  /** processorStatus as ResolveFlags would leave it, while Z and N are
+   *  deferred, without changing the CPU **/
+  Byte ResolvedStatus() const {
+    return ResolvedStatus(processorStatus, flagResult);
+  }
+
+  /** the same for a processorStatus and flagResult kept elsewhere **/
+  static Byte ResolvedStatus(Byte status, Word flagResult) {
+    StatusFlags flags;
+    memcpy(&flags, &status, sizeof(status));
+    flags.zeroFlag = (flagResult & 0xFF) == 0;
+    flags.negativeFlag = (flagResult & 0x180) != 0;
+    memcpy(&status, &flags, sizeof(status));
+    return status;
+  }
+
+  /** runs until the cycles are used up or an opcode without a handler
+   *  comes up, never throws. A loop that comes back to where it started
+   *  without a write, a device read or any change to the CPU can only
+   *  go on spinning until the run ends, e.g. LDA flag; BEQ back waiting
+   *  for an interrupt handler to set flag: Execute and the Execute of
+   *  PagedMem and Bus skip its iterations in one go and charge their
+   *  cycles and instructions, the run ends as if it had spun. **/
+  ExecResult Execute(s32 cycles, Mem &memory) noexcept;
+  /** same in a timing mode, Execute<Timing::Exact> is Execute(cycles,
+   *  memory), Execute<Timing::Fast> runs budget instructions and counts
+   *  them in cyclesUsed **/
+  template <Timing Mode>
+  ExecResult Execute(s32 budget, Mem &memory) noexcept;
+  /** runs until the cycles are used up or until one of the conditions
+   *  holds, see emu6502_debug.h. A breakpoint at the programCounter the
+   *  run starts from does not stop it, a run resumes from a breakpoint. **/
+  ExecResult RunUntil(s32 cycles, Mem &memory, const StopConditions &until) noexcept;
+  /** same on copy on write memory, see emu6502_paged.h **/
+  ExecResult Execute(s32 cycles, PagedMem &memory) noexcept;
+  /** same on memory with devices, see emu6502_bus.h **/
+  ExecResult Execute(s32 cycles, Bus &memory) noexcept;
+  /** same with every instruction and bus access reported to an
+   *  instrumentation policy, NullProfile or Profile, see emu6502_profile.h,
+   *  or TraceRecorder, see emu6502_trace.h **/
+  template <typename Policy>
+  ExecResult Execute(s32 cycles, Mem &memory, Policy &policy) noexcept;
+
 };
+
+static_assert(sizeof(my6502::CPU) == my6502::CPU::CACHE_LINE, "the state of a CPU is one cache line");
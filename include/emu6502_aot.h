@@ -0,0 +1,156 @@
+#pragma once
+#include <emu6502.h>
+#include <emu6502_image.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace my6502 {
+  struct StaticCode;
+  struct StaticRecompiler;
+}
+
+/** Runs a program translated ahead of time by my6502_aot, see
+ *  StaticRecompiler. Every basic block the recompiler found is a C++
+ *  function in the translation unit it wrote, looked up by the PC it
+ *  starts at. A block only runs while its bytes in memory are still
+ *  the bytes it was translated from: it checks the Mem::pageVersion of
+ *  its pages on entry and compares its bytes again once they moved on.
+ *  Code the recompiler did not reach or could not translate, RTS to an
+ *  address no block starts at and code that has been written over all
+ *  run on CPU::Execute. Cycle counts and the final state are those of
+ *  CPU::Execute. **/
+struct my6502::StaticCode {
+  /** runs the block, returns the cycles left and counts the
+   *  instructions it retired **/
+  using BlockFn = s32 (*)(CPU &cpu, s32 cycles, Mem &memory, std::uint64_t &instructions);
+
+  struct Block {
+    Word address;
+    Word size;            // bytes of code, from address on
+    s32 maxLeadCycles;    // worst case cycles of all but the last instruction
+    BlockFn code;
+    const Byte *bytes;    // the code it was translated from
+  };
+
+  /** the bytes of the image, to load the program without the file **/
+  struct Segment {
+    Word address;
+    u32 size;
+    const Byte *data;
+  };
+
+  /** what a translation unit of my6502_aot defines **/
+  struct Program {
+    const Block *blocks;
+    u32 blockCount;
+    const Segment *segments;
+    u32 segmentCount;
+    Word entry;           // the reset vector of the image
+  };
+
+  /** The registers a block works on, in locals the compiler can keep in
+   *  host registers across the stores to memory, Z and N deferred **/
+  struct Registers {
+    Byte a, x, y, s;
+    Word nz;
+
+    explicit Registers(CPU &cpu)
+      : a(cpu.accumulator), x(cpu.indexRegX), y(cpu.indexRegY), s(cpu.stackPointer) {
+      cpu.DeferFlags();
+      nz = cpu.flagResult;
+    }
+    /** leaves the block for pc **/
+    void StoreTo(CPU &cpu, Word pc) const {
+      cpu.accumulator = a;
+      cpu.indexRegX = x;
+      cpu.indexRegY = y;
+      cpu.stackPointer = s;
+      cpu.flagResult = nz;
+      cpu.ResolveFlags();
+      cpu.programCounter = pc;
+    }
+  };
+
+  explicit StaticCode(const Program &program);
+
+  /** copies the segments of the program into memory, after CPU::Reset **/
+  void LoadInto(Mem &memory) const;
+
+  /** same contract as CPU::Execute **/
+  ExecResult Execute(CPU &cpu, s32 cycles, Mem &memory);
+
+  /** blocks run as translated code **/
+  std::uint64_t blocksRun = 0;
+  /** instructions run on CPU::Execute **/
+  std::uint64_t interpreted = 0;
+  /** block entries that found their code written over **/
+  std::uint64_t staleBlocks = 0;
+
+private:
+  static constexpr u32 NONE = ~0u;
+
+  /** a block and the page versions its bytes were last seen at **/
+  struct Entry {
+    const Block *block;
+    Byte firstPage;
+    Byte lastPage;
+    u32 firstPageVersion;
+    u32 lastPageVersion;
+    bool checked;       // the versions are those of memory
+  };
+
+  /** true when the bytes of entry are unchanged in memory **/
+  bool Current(Entry &entry, const Mem &memory);
+
+  const Program &program;
+  std::vector<Entry> entries;
+  std::vector<u32> entryAt;   // indexed by PC, NONE without a block
+  const Mem *checkedMemory = nullptr;
+};
+
+/** Translates the code of an image to C++ for StaticCode. The code
+ *  reachable from the reset vector, the NMI and IRQ vectors is followed
+ *  through JSR and the return addresses after it, JMP absolute and both
+ *  ways out of a branch, it is cut into basic
+ *  blocks that end at JSR, RTS, an opcode that is not translated or
+ *  MAX_BLOCK_INSTRUCTIONS. Only the loads, stores, JSR and RTS are
+ *  translated, BRK, RTI, CLI, SEI and the opcodes CPU::Execute stops at
+ *  are left to it. A block leaves early after a store into its own
+ *  bytes. **/
+struct my6502::StaticRecompiler {
+  static constexpr u32 MAX_BLOCK_INSTRUCTIONS = 64; // a block spans at most two pages
+
+  struct Block {
+    Word address;
+    Word size;
+    u32 instructions;
+    s32 maxLeadCycles;
+  };
+
+  /** walks the code of image, false if nothing is open **/
+  bool Translate(const Image &image);
+
+  /** the blocks found, by address **/
+  const std::vector<Block> &Blocks() const { return blocks; }
+  /** a translation unit defining the StaticCode::Program name **/
+  std::string Source(const char *name) const;
+
+private:
+  /** bytes of the image, copied out of memory by Source **/
+  struct Range {
+    Word address;
+    u32 size;
+  };
+
+  /** decodes the block at address, queues where it goes on **/
+  void Walk(Word address, std::vector<Word> &pending);
+  void EmitBlock(std::string &out, const Block &block) const;
+
+  std::vector<Byte> memory;      // the image loaded as by Image::LoadInto
+  std::vector<bool> inImage;     // by address, bytes the image covers
+  std::vector<bool> walked;      // by address, blocks start there
+  std::vector<Block> blocks;
+  std::vector<Range> segments;
+  Word entry = 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <emu6502.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace my6502 {
+  struct Batch;
+}
+
+/** Runs many independent CPU/Mem instances together.
+ *  The registers of all instances are kept as structure of arrays and
+ *  their memories are interleaved byte by byte, address a of instance i
+ *  lives at a * Lanes() + i. The instances that sit at the same PC about
+ *  to run the same opcode step in lockstep: the instruction is decoded
+ *  once and carried out LANES instances at a time, reading the opcode,
+ *  the operands and same-address data as one contiguous row and gathering
+ *  indexed and indirect data with AVX2 when the host has it. Groups
+ *  smaller than MIN_LOCKSTEP_INSTANCES, i.e. instances whose path
+ *  diverged from the others, and opcodes without a lane kernel are split
+ *  off and finish their budget in CPU::Execute. Every instance ends with
+ *  exactly the state and cycles CPU::Execute would give it. **/
+struct my6502::Batch {
+  static constexpr u32 LANES = 8;
+  static constexpr u32 MIN_LOCKSTEP_INSTANCES = 4;
+  /** gathers use 32 bit offsets into the interleaved memory **/
+  static constexpr u32 MAX_INSTANCES = 0x7FFFFFFF / Mem::MAX_MEM - LANES;
+
+  explicit Batch(u32 instances);
+
+  u32 Size() const { return instances; }
+  /** instances rounded up to a multiple of LANES **/
+  u32 Lanes() const { return lanes; }
+
+  /** copy an instance into the batch **/
+  void Load(u32 instance, const CPU &cpu, const Mem &memory);
+  /** copy an instance out of the batch, every page of the memory counts as written **/
+  void Save(u32 instance, CPU &cpu, Mem &memory) const;
+  /** registers of an instance as a CPU **/
+  CPU State(u32 instance) const;
+  Byte Read(u32 instance, Word address) const { return memory[address * lanes + instance]; }
+
+  /** runs every instance for the budget with the contract of
+   *  CPU::Execute, cyclesUsed holds what each instance used **/
+  void Execute(s32 cycles);
+
+  /** true when lanes are gathered with AVX2 on this host **/
+  static bool UsesAVX2();
+
+  // one entry per lane
+  std::vector<Word> programCounter;
+  std::vector<Byte> stackPointer;
+  std::vector<Byte> accumulator;
+  std::vector<Byte> indexRegX;
+  std::vector<Byte> indexRegY;
+  std::vector<Byte> processorStatus;
+  std::vector<s32> cyclesUsed;
+  std::vector<StopReason> stopReason; // see ExecResult, the address is the programCounter
+
+  /** instructions executed in lockstep, summed over the instances **/
+  std::uint64_t lockstepInstructions = 0;
+  /** instances split off to CPU::Execute **/
+  std::uint64_t splits = 0;
+
+private:
+  /** mark the lockstep group, every unfinished instance at the PC
+   *  about to run the opcode, returns its size **/
+  u32 FindGroup(Byte Ins, Word pc, u32 firstLane);
+  /** run one instruction for every instance of the group **/
+  void Step(Byte Ins, Word pc, u32 firstLane);
+  /** finish the budget of an instance in CPU::Execute, cycles is the
+   *  budget of Execute(cycles) **/
+  void RunScalar(u32 instance, s32 cycles);
+  void SetState(u32 instance, const CPU &cpu);
+
+  u32 instances;
+  u32 lanes;
+  std::vector<Byte> memory;  // interleaved, plus padding for 4 byte gathers
+  std::vector<s32> cyclesLeft;
+  std::vector<u32> group;    // all ones for the lanes in the lockstep group
+  std::unique_ptr<Mem> scratch; // an instance split off to CPU::Execute
+  // per lane temporaries of Step
+  std::vector<u32> operandLo, operandHi, effectiveAddress, loaded, pageCrossed, gatherOffsets;
+  std::vector<Byte> returnBytes;
+};
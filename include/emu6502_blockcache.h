@@ -0,0 +1,118 @@
+#pragma once
+#include <emu6502.h>
+#include <emu6502_profile.h>
+#include <memory>
+#include <vector>
+
+namespace my6502 {
+  struct DecodedIns;
+  struct Superinstructions;
+  struct BlockCache;
+}
+
+/** An instruction decoded ahead of time, operand bytes and base cycles
+ *  are resolved so executing it does not touch the opcode stream **/
+struct my6502::DecodedIns {
+  /** executes the instruction, returns the cycles left **/
+  using Handler = s32 (*)(CPU &cpu, const DecodedIns &ins, s32 cycles, Mem &memory);
+
+  Handler handler;
+  Word operand;  // immediate value, zero page address or absolute address
+  Word nextPC;   // address of the following instruction
+  Byte opcode;
+  Byte cycles;   // base cycles, page crossing is added when executed
+  bool writesMemory;
+  /* the instructions handler runs, from this one on, more than 1 for a
+     superinstruction, its parts follow it decoded as usual */
+  Byte length;
+  /* pageVersion of the page of the leaf routine a fused JSR runs */
+  u32 codeVersion;
+};
+
+/** The sequences a BlockCache fuses into superinstructions, one
+ *  DecodedIns whose handler runs them all with one dispatch and takes
+ *  their cycles off the budget at once. A load and the load or store
+ *  right after it make a pair, a JSR to a leaf routine in one page, a
+ *  few loads and stores and RTS, runs the routine and its return with
+ *  it. The state and the cycles are those of the single instructions,
+ *  a fused call stops where its routine has been written over. Picked
+ *  from the SequenceProfile of a workload, see Hot. **/
+struct my6502::Superinstructions {
+  std::vector<bool> pairs; // 64 Ki, the pair at first << 8 | second is fused
+  bool leafCalls = false;
+
+  Superinstructions();
+
+  /** true when there is a fused handler for first followed by second **/
+  static bool Fusable(Byte first, Byte second);
+  /** the fusable pairs, and leaf calls, the profile saw make up at
+   *  least share of the instructions **/
+  static Superinstructions Hot(const SequenceProfile &profile, double share = 0.01);
+  /** the number of pairs fused **/
+  u32 Pairs() const;
+};
+
+/** Caches basic blocks of decoded instructions keyed by their start PC.
+ *  A block remembers the Mem::pageVersion of the pages it was decoded
+ *  from, any write to those pages (WriteByte, WriteWord or the host
+ *  writing through Mem::operator[]) invalidates it, so self modifying
+ *  code is never run stale. Like CPU::Execute it runs on a local copy of
+ *  the CPU with Z and N deferred, but every block still costs a lookup
+ *  and every instruction an indirect call: it only beats the interpreter
+ *  on long straight blocks. Code that calls a subroutine every few
+ *  instructions runs slower than on CPU::Execute (about 0.9 times on the
+ *  copy-loop-body benchmark, 1.5 times faster on zero-page-shuffle),
+ *  unless leaf calls are fused, see Fuse. **/
+struct my6502::BlockCache {
+  static constexpr u32 MAX_BLOCK_INSTRUCTIONS = 32;
+
+  struct Block {
+    std::vector<DecodedIns> instructions;
+    s32 maxLeadCycles;  // worst case cycles of all but the last instruction
+    Byte firstPage;
+    Byte lastPage;
+    u32 firstPageVersion;
+    u32 lastPageVersion;
+  };
+
+  BlockCache();
+
+  /** decodes the superinstructions from now on, drops every block **/
+  void Fuse(const Superinstructions &superinstructions);
+
+  /** same contract as CPU::Execute, returns the number of cycles used,
+   *  stops in front of an opcode the interpreter has no handler for **/
+  s32 Execute(CPU &cpu, s32 cycles, Mem &memory);
+
+  /** drop every block decoded from the page **/
+  void InvalidatePage(Byte page);
+  /** drop every block **/
+  void Clear();
+
+  /** the valid block at the address, decoding it if needed,
+   *  nullptr if there is no handled instruction at the address **/
+  const Block *Lookup(Word address, const Mem &memory);
+  /** run every instruction of the block, stops early if the block
+   *  writes over its own code, returns the cycles left **/
+  static s32 RunBlock(const Block &block, CPU &cpu, s32 cycles, Mem &memory);
+  /** true when a page the block was decoded from has been written **/
+  static bool IsStale(const Block &block, const Mem &memory);
+
+  /** number of blocks decoded, including re-decodes after invalidation **/
+  u32 blocksDecoded = 0;
+  /** number of superinstructions decoded **/
+  u32 superinstructionsDecoded = 0;
+
+private:
+  std::unique_ptr<Block> Decode(Word address, const Mem &memory);
+  /** appends the leaf routine the JSR at the back of block calls and
+   *  fuses it into the JSR, false if it is no leaf **/
+  bool FuseLeafCall(Block &block, const Mem &memory);
+  /** fuses the pairs of block **/
+  void FusePairs(Block &block);
+
+  Superinstructions fused;
+
+  const Mem *cachedMemory = nullptr;
+  std::vector<std::unique_ptr<Block>> blocks; // indexed by start PC
+};
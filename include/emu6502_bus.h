@@ -0,0 +1,98 @@
+#pragma once
+#include <emu6502.h>
+
+namespace my6502 {
+  struct Bus;
+}
+
+/** Memory with devices, a drop in for Mem in CPU::Execute and Reset.
+ *  A table of 256 pages decides where each access goes: RAM and ROM
+ *  pages hold a direct pointer into a Mem, so they cost one table load
+ *  and no call, ROM pages may also point into an image, see
+ *  emu6502_image.h, I/O pages call the read and write handlers of the
+ *  device mapped there. Every page starts out as RAM, while nothing
+ *  else is mapped CPU::Execute runs straight on the Mem. **/
+struct my6502::Bus {
+  static constexpr u32 MAX_MEM = Mem::MAX_MEM;
+  static constexpr u32 PAGE_SIZE = Mem::PAGE_SIZE;
+  static constexpr u32 NUM_PAGES = Mem::NUM_PAGES;
+
+  /** a device register read, may have side effects **/
+  using ReadFn = Byte (*)(void *device, Word address);
+  using WriteFn = void (*)(void *device, Word address, Byte value);
+
+  /** a write through operator[], RAM or a device depending on the page **/
+  struct Cell {
+    Bus &bus;
+    Word address;
+    Cell &operator=(Byte value) { bus.Write(address, value); return *this; }
+    operator Byte() const { return static_cast<const Bus &>(bus)[address]; }
+  };
+
+  /** every page maps the same page of ram **/
+  explicit Bus(Mem &ram);
+
+  /** pages first..last read and write ram **/
+  void MapRAM(Byte first, Byte last);
+  /** pages first..last read ram, writes to them are dropped **/
+  void MapROM(Byte first, Byte last);
+  /** pages first..last read rom instead, which holds their bytes and is
+   *  not copied, it has to outlive the mapping, writes are dropped **/
+  void MapROM(Byte first, Byte last, const Byte *rom);
+  /** pages first..last call the handlers of device, with the full address **/
+  void MapDevice(Byte first, Byte last, ReadFn read, WriteFn write, void *device);
+
+  /* the cycles left of the CPU::Execute running on the bus, null
+     between runs, a Scheduler tells the time by it, see emu6502_scheduler.h */
+  const s32 *cyclesLeft = nullptr;
+  /* cycles a Scheduler cut off the running budget, CPU::Execute takes
+     them off after the instruction */
+  s32 budgetCut = 0;
+
+  /** zeroes the RAM, devices keep their state **/
+  void Initialize() { ram.Initialize(); }
+  Mem &Ram() { return ram; }
+  /** true while every page is RAM **/
+  bool RamOnly() const { return mappedPages == 0; }
+  /** true when reading address reads RAM or ROM, no device **/
+  bool Direct(Word address) const { return readPages[address >> 8] != nullptr; }
+
+  /* write access */
+  Cell operator[](u32 address) {
+    return Cell{*this, static_cast<Word>(address)};
+  }
+
+  /* readable access */
+  Byte operator[](u32 address) const {
+    const u32 Page = (address >> 8) & (NUM_PAGES - 1);
+    if (const Byte *direct = readPages[Page]) {
+      return direct[address & (PAGE_SIZE - 1)];
+    }
+    return devices[Page].read(devices[Page].device, static_cast<Word>(address));
+  }
+
+  void Write(Word address, Byte value) {
+    const u32 Page = address >> 8;
+    if (Byte *direct = writePages[Page]) {
+      ram.pageVersion[Page]++;
+      direct[address] = value;
+    } else if (devices[Page].write != nullptr) {
+      devices[Page].write(devices[Page].device, address, value);
+    }
+  }
+
+private:
+  struct Device {
+    ReadFn read;
+    WriteFn write;
+    void *device;
+  };
+
+  // the bytes of RAM and ROM pages, nullptr where a device is mapped
+  const Byte *readPages[NUM_PAGES];
+  // ram.Data for RAM pages, nullptr for ROM and devices
+  Byte *writePages[NUM_PAGES];
+  Device devices[NUM_PAGES];
+  u32 mappedPages = 0; // ROM and device pages
+  Mem &ram;
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <emu6502.h>
+#include <cstdint>
+
+namespace my6502 {
+  struct StopConditions;
+}
+
+/** When CPU::RunUntil stops besides the cycle budget.
+ *  Breakpoints are one bit per address, looking one up before every
+ *  instruction is a load and a shift. Watchpoints are one bit per
+ *  address too, behind a count of watched addresses per page: while no
+ *  watchpoint is set RunUntil runs on the memory itself, otherwise on a
+ *  view of it that only looks at the bitmaps for watched pages. About
+ *  25 KiB, best kept for many runs rather than built for each. **/
+struct my6502::StopConditions {
+  /** called before every instruction with Z and N resolved, true stops **/
+  using Predicate = bool (*)(const CPU &cpu, void *context);
+
+  static constexpr u32 WORDS = Mem::MAX_MEM / 64;
+
+  std::uint64_t instructions = UINT64_MAX; // stop after this many instructions
+  Predicate predicate = nullptr;
+  void *context = nullptr;                 // handed to predicate
+
+  void SetBreakpoint(Word address) { Set(breakpoints, address); }
+  void ClearBreakpoint(Word address) { Clear(breakpoints, address); }
+  bool IsBreakpoint(Word address) const { return Test(breakpoints, address); }
+
+  /** reads of address by an instruction, its operand bytes included, stop the run **/
+  void WatchReads(Word address) { Watch(readWatches, readWatchesOnPage, address); }
+  /** writes to address stop the run **/
+  void WatchWrites(Word address) { Watch(writeWatches, writeWatchesOnPage, address); }
+  /** removes both watchpoints of address **/
+  void Unwatch(Word address) {
+    Unwatch(readWatches, readWatchesOnPage, address);
+    Unwatch(writeWatches, writeWatchesOnPage, address);
+  }
+  /** true when the read or write of address stops the run **/
+  bool IsReadWatched(Word address) const {
+    return readWatchesOnPage[address >> 8] != 0 && Test(readWatches, address);
+  }
+  bool IsWriteWatched(Word address) const {
+    return writeWatchesOnPage[address >> 8] != 0 && Test(writeWatches, address);
+  }
+  /** true while any watchpoint is set **/
+  bool Watching() const { return watched != 0; }
+
+private:
+  static void Set(std::uint64_t *bits, Word address) { bits[address >> 6] |= std::uint64_t{1} << (address & 63); }
+  static void Clear(std::uint64_t *bits, Word address) { bits[address >> 6] &= ~(std::uint64_t{1} << (address & 63)); }
+  static bool Test(const std::uint64_t *bits, Word address) { return (bits[address >> 6] >> (address & 63)) & 1; }
+
+  void Watch(std::uint64_t *bits, Word *onPage, Word address) {
+    if (!Test(bits, address)) {
+      Set(bits, address);
+      onPage[address >> 8]++;
+      watched++;
+    }
+  }
+  void Unwatch(std::uint64_t *bits, Word *onPage, Word address) {
+    if (Test(bits, address)) {
+      Clear(bits, address);
+      onPage[address >> 8]--;
+      watched--;
+    }
+  }
+
+  std::uint64_t breakpoints[WORDS] = {};
+  std::uint64_t readWatches[WORDS] = {};
+  std::uint64_t writeWatches[WORDS] = {};
+  Word readWatchesOnPage[Mem::NUM_PAGES] = {};
+  Word writeWatchesOnPage[Mem::NUM_PAGES] = {};
+  u32 watched = 0;
+};
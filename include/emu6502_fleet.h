@@ -0,0 +1,104 @@
+#pragma once
+#include <emu6502.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace my6502 {
+  struct Fleet;
+}
+
+/** Runs independent jobs on every core.
+ *  Every worker owns a deque of jobs, a CPU and a Mem allocated by its
+ *  own thread, each on cache lines of its own. A worker takes the newest
+ *  job of its own deque and, once that is empty, steals the oldest job
+ *  of another worker's deque, so a worker that got the long jobs does
+ *  not hold up the others. Results are handed back through a lock free
+ *  completion queue that Poll and Wait drain on the caller's thread. **/
+struct my6502::Fleet {
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  struct Job {
+    u32 id = 0;
+    CPU cpu{};                          // initial registers
+    std::shared_ptr<const Mem> image;   // copied into the worker's Mem, may be shared by many jobs
+    s32 cycles = 0;
+    bool keepMemory = false;            // hand the final memory back in the result
+  };
+
+  struct Result {
+    u32 id = 0;
+    CPU cpu{};                          // final registers
+    s32 cyclesUsed = 0;
+    bool completed = false;             // false when an unhandled instruction stopped the job
+    std::unique_ptr<Mem> memory;        // only with Job::keepMemory
+  };
+
+  /** starts the workers, one per hardware thread when workers is 0 **/
+  explicit Fleet(u32 workers = 0);
+  /** finishes every submitted job, then stops the workers **/
+  ~Fleet();
+  Fleet(const Fleet &) = delete;
+  Fleet &operator=(const Fleet &) = delete;
+
+  u32 Workers() const { return static_cast<u32>(workers.size()); }
+
+  // Submit, Poll and Wait are called from one thread, the owner of the fleet
+
+  /** queue a job, the workers take turns receiving them **/
+  void Submit(Job job);
+  /** queue a job on the deque of one worker **/
+  void Submit(Job job, u32 worker);
+
+  /** take a finished job's result without waiting **/
+  bool Poll(Result &result);
+  /** wait for every submitted job and return the results not yet polled **/
+  std::vector<Result> Wait();
+
+  /** jobs taken from another worker's deque **/
+  std::uint64_t Steals() const;
+
+private:
+  struct Completion {
+    Result result;
+    std::atomic<Completion *> next{nullptr};
+  };
+
+  struct alignas(CACHE_LINE) Worker {
+    std::mutex lock;                    // only contended while somebody steals
+    std::deque<Job> jobs;
+    std::atomic<std::uint64_t> steals{0};
+    std::thread thread;
+  };
+
+  void Run(u32 index);
+  bool Take(u32 index, Job &job);
+  /** queue the result, the last job to finish wakes Wait **/
+  void Complete(Completion *completion);
+  void Push(Completion *completion);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  u32 nextWorker = 0;
+
+  // idle workers sleep until a job is queued
+  alignas(CACHE_LINE) std::atomic<std::int64_t> queued{0};
+  std::mutex sleepLock;
+  std::condition_variable wake;
+  bool stopping = false;
+
+  // submitted but not finished, Wait sleeps until it is 0
+  alignas(CACHE_LINE) std::atomic<std::int64_t> outstanding{0};
+  std::mutex doneLock;
+  std::condition_variable done;
+
+  // multi producer, single consumer intrusive queue, workers push at
+  // head, the caller pops at tail, stub keeps it never empty
+  alignas(CACHE_LINE) std::atomic<Completion *> head;
+  alignas(CACHE_LINE) Completion *tail;
+  Completion stub;
+};
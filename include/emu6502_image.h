@@ -0,0 +1,75 @@
+#pragma once
+#include <emu6502.h>
+#include <cstdint>
+#include <vector>
+
+namespace my6502 {
+  struct Image;
+}
+
+/** A program image file, loaded into a Mem or mapped on a Bus.
+ *  Raw binaries, C64 PRG files, Intel HEX and the PRG ROM of iNES files
+ *  are understood. Open maps the file, or takes a buffer, without copying
+ *  it and splits it into segments, runs of bytes with their load
+ *  address. Segments of binary formats point into the file, Intel HEX
+ *  is decoded in one pass into a 64 KiB buffer of the image. Both
+ *  LoadInto and MapInto come after CPU::Reset, which clears the RAM. **/
+struct my6502::Image {
+  enum class Format : Byte {
+    Raw,      // the bytes as they are, at the address given to Open
+    PRG,      // a two byte load address, then the bytes
+    IntelHex, // data, segment and linear address records, addresses up to $FFFF
+    INES      // iNES, the first PRG bank at $8000, the last at $C000
+  };
+
+  struct Segment {
+    Word address;
+    u32 size;
+    const Byte *data;
+  };
+
+  static constexpr Word RESET_VECTOR = 0xFFFC;
+
+  Image() = default;
+  ~Image();
+  Image(const Image &) = delete;
+  Image &operator=(const Image &) = delete;
+
+  /** maps an image file, address is the load address of a Raw image,
+   *  false if the file is no image of that format or does not fit **/
+  bool Open(const char *path, Format format, Word address = 0);
+  /** an image in memory, data is not copied and has to outlive it **/
+  bool Open(const Byte *data, std::uint64_t size, Format format, Word address = 0);
+  void Close();
+
+  /** true after a successful Open **/
+  bool IsOpen() const { return opened; }
+  const std::vector<Segment> &Segments() const { return segments; }
+  /** where the program starts: the load address of Raw and PRG, the
+   *  start address record of Intel HEX or else its first data, the
+   *  reset vector in the ROM of iNES **/
+  Word Entry() const { return entry; }
+
+  /** copies every segment with one memcpy, every page written counts as
+   *  written, and points the reset vector at Entry unless the image
+   *  has one, false if nothing is open **/
+  bool LoadInto(Mem &memory) const;
+  /** maps every whole page of the segments read only on bus without
+   *  copying, the image has to outlive the mapping, pages a segment
+   *  only covers in part are copied into the RAM and mapped as ROM,
+   *  the reset vector is set as by LoadInto, false if nothing is open **/
+  bool MapInto(Bus &bus) const;
+
+private:
+  bool Parse(const Byte *bytes, std::uint64_t size, Format format, Word address);
+  bool ParseIntelHex(const Byte *bytes, std::uint64_t size);
+  bool CoversResetVector() const;
+
+  const Byte *data = nullptr;
+  std::uint64_t length = 0;
+  bool mapped = false;         // data is a mapping of a file, not a caller's buffer
+  bool opened = false;
+  std::vector<Segment> segments;
+  std::vector<Byte> decoded;   // the 64 KiB of an Intel HEX image
+  Word entry = 0;
+};
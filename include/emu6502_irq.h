@@ -0,0 +1,84 @@
+#pragma once
+#include <emu6502.h>
+#include <emu6502_scheduler.h>
+#include <cstdint>
+
+namespace my6502 {
+  struct InterruptController;
+}
+
+/** Delivers IRQ and NMI to a CPU without looking for them between
+ *  instructions. Interrupt sources and devices are scheduled on the
+ *  cycle clock of scheduler, Run executes straight stretches of
+ *  CPU::Execute up to the next scheduled event, brings the devices
+ *  that are due up to date and only takes interrupts between stretches:
+ *  it pushes the PC and the status with B clear, sets I and continues
+ *  at the vector at $FFFA for NMI or $FFFE for IRQ, 7 cycles. An IRQ
+ *  is level triggered, its source holds the line until Release, and
+ *  waits while I is set, CLI and RTI end their stretch when they clear
+ *  I with the line held. An NMI is edge triggered, every Raise is taken
+ *  once. Like a 6502 the controller looks at the lines at instruction
+ *  boundaries, an event is taken after the instruction running at its
+ *  cycle. **/
+struct my6502::InterruptController {
+  enum class Line : Byte {
+    IRQ,
+    NMI
+  };
+  using Source = u32;
+  static constexpr u32 MAX_SOURCES = 32;
+  /** the cycles the interrupt sequence takes **/
+  static constexpr s32 INTERRUPT_CYCLES = 7;
+
+  /** a new source driving line, at most MAX_SOURCES **/
+  Source AddSource(Line line);
+
+  /** source raises its line at cycle at of Now, and every period
+   *  cycles from then on unless period is 0, replaces an earlier schedule **/
+  void Schedule(Source source, std::uint64_t at, u32 period = 0);
+  /** drops the schedule of source, the line stays as it is **/
+  void Cancel(Source source);
+
+  /** source raises its line now, raised from a device while Run
+   *  executes on a Bus the stretch ends after the current instruction **/
+  void Raise(Source source);
+  /** source lets go of the IRQ line, the acknowledge of its device **/
+  void Release(Source source);
+  bool Raised(Source source) const { return (irqRaised >> source) & 1; }
+
+  /** CPU cycles run so far **/
+  std::uint64_t Now() const { return scheduler.Now(); }
+
+  /** runs with the contract of CPU::Execute and takes the interrupts
+   *  that come up, the cycles of the interrupt sequences count **/
+  ExecResult Run(CPU &cpu, s32 cycles, Mem &memory);
+  ExecResult Run(CPU &cpu, s32 cycles, Bus &memory);
+
+  std::uint64_t irqsTaken = 0;
+  std::uint64_t nmisTaken = 0;
+  /** the CPU::Execute calls Run made **/
+  std::uint64_t stretches = 0;
+
+  /** the clock of Run, devices that raise interrupts are added here **/
+  Scheduler scheduler;
+
+private:
+  /** the schedule of a source, a device of the scheduler **/
+  struct Timed {
+    InterruptController *controller;
+    Source source;
+    u32 period;
+    std::uint64_t at;
+    Scheduler::Device device;
+  };
+
+  template <typename Memory>
+  ExecResult RunOn(CPU &cpu, s32 cycles, Memory &memory);
+  static std::uint64_t Fire(void *timed, std::uint64_t now);
+
+  Timed timed[MAX_SOURCES];
+  u32 sources = 0;
+  u32 nmiSources = 0;        // one bit per source on the NMI line
+  u32 irqRaised = 0;         // one bit per source holding the IRQ line
+  bool nmiPending = false;
+};
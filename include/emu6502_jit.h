@@ -0,0 +1,93 @@
+#pragma once
+#include <emu6502.h>
+#include <emu6502_blockcache.h>
+#include <memory>
+#include <vector>
+
+namespace my6502 {
+  struct Jit;
+}
+
+/** Dynamic recompiler for hot blocks.
+ *  Blocks come from a BlockCache that fuses leaf calls, a JSR to a leaf
+ *  routine is translated together with the routine. They run there
+ *  until they have run HOT_THRESHOLD times, then they are translated to
+ *  native x86-64 code kept in an executable code cache. Compiling costs
+ *  a few microseconds a block: a program must run its code some dozens
+ *  of times before the JIT pays off, until then it runs about as fast
+ *  as the BlockCache. Blocks that cannot be translated,
+ *  and every block on other hosts, keep running through the BlockCache,
+ *  which falls back to CPU::Execute. A code cache the host does not let
+ *  us make writable or executable switches the translation off for good,
+ *  every block then runs through the BlockCache. Cycle counts are exactly
+ *  those of CPU::Execute. **/
+struct my6502::Jit {
+  static constexpr u32 HOT_THRESHOLD = 16;
+  static constexpr u32 CODE_CACHE_SIZE = 8 * 1024 * 1024;
+  /** a block whose code is rewritten more often stays interpreted **/
+  static constexpr u32 MAX_RECOMPILES = 4;
+
+  /** native code of a block, returns the cycles left **/
+  using NativeBlock = s32 (*)(CPU *cpu, Mem *memory, s32 cycles);
+
+  Jit();
+  ~Jit();
+  Jit(const Jit &) = delete;
+  Jit &operator=(const Jit &) = delete;
+
+  /** same contract as CPU::Execute, returns the number of cycles used,
+   *  stops in front of an opcode the interpreter has no handler for **/
+  s32 Execute(CPU &cpu, s32 cycles, Mem &memory);
+
+  /** true when native code can be generated on this host **/
+  static bool IsSupported();
+
+  /** drop every block and all native code **/
+  void Clear();
+
+  /** differential test mode: every native block is also run by
+   *  CPU::Execute on a copy of the machine and the full register and
+   *  flag state is compared. On a mismatch the interpreter's result
+   *  is kept and the native block is thrown away. **/
+  bool differential = false;
+
+  u32 blocksCompiled = 0;
+  u32 nativeBlocksRun = 0;
+  u32 mismatches = 0;
+  Word firstMismatchPC = 0;
+
+private:
+  struct Entry {
+    NativeBlock code;
+    s32 maxLeadCycles;
+    u32 runs;
+    u32 recompiles;
+    bool untranslatable;
+    Byte firstPage;
+    Byte lastPage;
+    u32 firstPageVersion;
+    u32 lastPageVersion;
+  };
+
+  /** translate the block, nullptr if an instruction can not be translated **/
+  NativeBlock Compile(const BlockCache::Block &block);
+  s32 RunDifferential(NativeBlock code, Word address, CPU &cpu, s32 cycles, Mem &memory);
+  /** drop all native code, keeps the decoded blocks **/
+  void FlushCode();
+  /** unmap the code cache, Compile translates nothing after **/
+  void DropCodeCache();
+  /** make the pages Compile wrote executable again, before any native
+   *  code runs. Drops the code cache and returns false if the host
+   *  does not let us **/
+  bool Seal();
+  static Entry NewEntry(const BlockCache::Block &block, NativeBlock code);
+
+  BlockCache cache;
+  std::vector<Entry> entries; // indexed by start PC
+  const Mem *cachedMemory = nullptr;
+  std::unique_ptr<Mem> referenceMemory; // interpreter's copy in differential mode
+  Byte *codeCache = nullptr;
+  u32 codeUsed = 0;
+  u32 writableBegin = 0; // the host pages of the code cache left writable
+  u32 writableEnd = 0;
+};
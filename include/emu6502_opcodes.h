@@ -0,0 +1,190 @@
+#pragma once
+#include <emu6502.h>
+#include <array>
+#include <string>
+
+namespace my6502 {
+  /** The instructions of the NMOS 6502, Invalid for the opcodes that are
+   *  not documented **/
+  enum class Mnemonic : Byte {
+    ADC, AND, ASL, BCC, BCS, BEQ, BIT, BMI, BNE, BPL, BRK, BVC, BVS, CLC,
+    CLD, CLI, CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR, INC, INX, INY, JMP,
+    JSR, LDA, LDX, LDY, LSR, NOP, ORA, PHA, PHP, PLA, PLP, ROL, ROR, RTI,
+    RTS, SBC, SEC, SED, SEI, STA, STX, STY, TAX, TAY, TSX, TXA, TXS, TYA,
+    Invalid
+  };
+  struct OpcodeInfo;
+}
+
+/** What an opcode is, independent of whether an engine implements it **/
+struct my6502::OpcodeInfo {
+  Mnemonic mnemonic;
+  CPU::AddrMode mode;
+  Byte bytes;               // opcode plus operand bytes
+  Byte cycles;              // base cycles including the opcode fetch
+  CPU::PageCross pageCross; // what crossing a page adds to cycles
+
+  constexpr bool Valid() const { return mnemonic != Mnemonic::Invalid; }
+};
+
+namespace my6502 {
+
+  /** three letter name of an instruction, "???" for Invalid **/
+  const char *MnemonicName(Mnemonic mnemonic);
+
+  /** opcode plus operand bytes of an addressing mode **/
+  constexpr Byte InstructionBytes(CPU::AddrMode mode) {
+    switch (mode) {
+    case CPU::AddrMode::Implied:
+    case CPU::AddrMode::Accumulator:
+      return 1;
+    case CPU::AddrMode::Absolute:
+    case CPU::AddrMode::AbsoluteX:
+    case CPU::AddrMode::AbsoluteY:
+    case CPU::AddrMode::Indirect:
+      return 3;
+    default:
+      return 2;
+    }
+  }
+
+  /** The metadata of all 256 opcodes. Dispatch, cycle accounting, the
+   *  engines, the disassembler and the tests are all built from it. **/
+  constexpr std::array<OpcodeInfo, 256> MakeOpcodeInfoTable() {
+    using M = Mnemonic;
+    using A = CPU::AddrMode;
+    using P = CPU::PageCross;
+    std::array<OpcodeInfo, 256> table{};
+    for (OpcodeInfo &info : table) {
+      info = {M::Invalid, A::Implied, 1, 0, P::None};
+    }
+    struct Row { Byte opcode; M mnemonic; A mode; Byte cycles; P pageCross; };
+    constexpr Row Rows[] = {
+      {0x69, M::ADC, A::Immediate, 2, P::None}, {0x65, M::ADC, A::ZeroPage, 3, P::None},
+      {0x75, M::ADC, A::ZeroPageX, 4, P::None}, {0x6D, M::ADC, A::Absolute, 4, P::None},
+      {0x7D, M::ADC, A::AbsoluteX, 4, P::OnCross}, {0x79, M::ADC, A::AbsoluteY, 4, P::OnCross},
+      {0x61, M::ADC, A::IndirectX, 6, P::None}, {0x71, M::ADC, A::IndirectY, 5, P::OnCross},
+
+      {0x29, M::AND, A::Immediate, 2, P::None}, {0x25, M::AND, A::ZeroPage, 3, P::None},
+      {0x35, M::AND, A::ZeroPageX, 4, P::None}, {0x2D, M::AND, A::Absolute, 4, P::None},
+      {0x3D, M::AND, A::AbsoluteX, 4, P::OnCross}, {0x39, M::AND, A::AbsoluteY, 4, P::OnCross},
+      {0x21, M::AND, A::IndirectX, 6, P::None}, {0x31, M::AND, A::IndirectY, 5, P::OnCross},
+
+      {0x0A, M::ASL, A::Accumulator, 2, P::None}, {0x06, M::ASL, A::ZeroPage, 5, P::None},
+      {0x16, M::ASL, A::ZeroPageX, 6, P::None}, {0x0E, M::ASL, A::Absolute, 6, P::None},
+      {0x1E, M::ASL, A::AbsoluteX, 7, P::None},
+
+      {0x90, M::BCC, A::Relative, 2, P::Branch}, {0xB0, M::BCS, A::Relative, 2, P::Branch},
+      {0xF0, M::BEQ, A::Relative, 2, P::Branch}, {0x30, M::BMI, A::Relative, 2, P::Branch},
+      {0xD0, M::BNE, A::Relative, 2, P::Branch}, {0x10, M::BPL, A::Relative, 2, P::Branch},
+      {0x50, M::BVC, A::Relative, 2, P::Branch}, {0x70, M::BVS, A::Relative, 2, P::Branch},
+
+      {0x24, M::BIT, A::ZeroPage, 3, P::None}, {0x2C, M::BIT, A::Absolute, 4, P::None},
+      {0x00, M::BRK, A::Implied, 7, P::None},
+
+      {0x18, M::CLC, A::Implied, 2, P::None}, {0xD8, M::CLD, A::Implied, 2, P::None},
+      {0x58, M::CLI, A::Implied, 2, P::None}, {0xB8, M::CLV, A::Implied, 2, P::None},
+
+      {0xC9, M::CMP, A::Immediate, 2, P::None}, {0xC5, M::CMP, A::ZeroPage, 3, P::None},
+      {0xD5, M::CMP, A::ZeroPageX, 4, P::None}, {0xCD, M::CMP, A::Absolute, 4, P::None},
+      {0xDD, M::CMP, A::AbsoluteX, 4, P::OnCross}, {0xD9, M::CMP, A::AbsoluteY, 4, P::OnCross},
+      {0xC1, M::CMP, A::IndirectX, 6, P::None}, {0xD1, M::CMP, A::IndirectY, 5, P::OnCross},
+      {0xE0, M::CPX, A::Immediate, 2, P::None}, {0xE4, M::CPX, A::ZeroPage, 3, P::None},
+      {0xEC, M::CPX, A::Absolute, 4, P::None},
+      {0xC0, M::CPY, A::Immediate, 2, P::None}, {0xC4, M::CPY, A::ZeroPage, 3, P::None},
+      {0xCC, M::CPY, A::Absolute, 4, P::None},
+
+      {0xC6, M::DEC, A::ZeroPage, 5, P::None}, {0xD6, M::DEC, A::ZeroPageX, 6, P::None},
+      {0xCE, M::DEC, A::Absolute, 6, P::None}, {0xDE, M::DEC, A::AbsoluteX, 7, P::None},
+      {0xCA, M::DEX, A::Implied, 2, P::None}, {0x88, M::DEY, A::Implied, 2, P::None},
+
+      {0x49, M::EOR, A::Immediate, 2, P::None}, {0x45, M::EOR, A::ZeroPage, 3, P::None},
+      {0x55, M::EOR, A::ZeroPageX, 4, P::None}, {0x4D, M::EOR, A::Absolute, 4, P::None},
+      {0x5D, M::EOR, A::AbsoluteX, 4, P::OnCross}, {0x59, M::EOR, A::AbsoluteY, 4, P::OnCross},
+      {0x41, M::EOR, A::IndirectX, 6, P::None}, {0x51, M::EOR, A::IndirectY, 5, P::OnCross},
+
+      {0xE6, M::INC, A::ZeroPage, 5, P::None}, {0xF6, M::INC, A::ZeroPageX, 6, P::None},
+      {0xEE, M::INC, A::Absolute, 6, P::None}, {0xFE, M::INC, A::AbsoluteX, 7, P::None},
+      {0xE8, M::INX, A::Implied, 2, P::None}, {0xC8, M::INY, A::Implied, 2, P::None},
+
+      {0x4C, M::JMP, A::Absolute, 3, P::None}, {0x6C, M::JMP, A::Indirect, 5, P::None},
+      {0x20, M::JSR, A::Absolute, 6, P::None},
+
+      {0xA9, M::LDA, A::Immediate, 2, P::None}, {0xA5, M::LDA, A::ZeroPage, 3, P::None},
+      {0xB5, M::LDA, A::ZeroPageX, 4, P::None}, {0xAD, M::LDA, A::Absolute, 4, P::None},
+      {0xBD, M::LDA, A::AbsoluteX, 4, P::OnCross}, {0xB9, M::LDA, A::AbsoluteY, 4, P::OnCross},
+      {0xA1, M::LDA, A::IndirectX, 6, P::None}, {0xB1, M::LDA, A::IndirectY, 5, P::OnCross},
+      {0xA2, M::LDX, A::Immediate, 2, P::None}, {0xA6, M::LDX, A::ZeroPage, 3, P::None},
+      {0xB6, M::LDX, A::ZeroPageY, 4, P::None}, {0xAE, M::LDX, A::Absolute, 4, P::None},
+      {0xBE, M::LDX, A::AbsoluteY, 4, P::OnCross},
+      {0xA0, M::LDY, A::Immediate, 2, P::None}, {0xA4, M::LDY, A::ZeroPage, 3, P::None},
+      {0xB4, M::LDY, A::ZeroPageX, 4, P::None}, {0xAC, M::LDY, A::Absolute, 4, P::None},
+      {0xBC, M::LDY, A::AbsoluteX, 4, P::OnCross},
+
+      {0x4A, M::LSR, A::Accumulator, 2, P::None}, {0x46, M::LSR, A::ZeroPage, 5, P::None},
+      {0x56, M::LSR, A::ZeroPageX, 6, P::None}, {0x4E, M::LSR, A::Absolute, 6, P::None},
+      {0x5E, M::LSR, A::AbsoluteX, 7, P::None},
+
+      {0xEA, M::NOP, A::Implied, 2, P::None},
+
+      {0x09, M::ORA, A::Immediate, 2, P::None}, {0x05, M::ORA, A::ZeroPage, 3, P::None},
+      {0x15, M::ORA, A::ZeroPageX, 4, P::None}, {0x0D, M::ORA, A::Absolute, 4, P::None},
+      {0x1D, M::ORA, A::AbsoluteX, 4, P::OnCross}, {0x19, M::ORA, A::AbsoluteY, 4, P::OnCross},
+      {0x01, M::ORA, A::IndirectX, 6, P::None}, {0x11, M::ORA, A::IndirectY, 5, P::OnCross},
+
+      {0x48, M::PHA, A::Implied, 3, P::None}, {0x08, M::PHP, A::Implied, 3, P::None},
+      {0x68, M::PLA, A::Implied, 4, P::None}, {0x28, M::PLP, A::Implied, 4, P::None},
+
+      {0x2A, M::ROL, A::Accumulator, 2, P::None}, {0x26, M::ROL, A::ZeroPage, 5, P::None},
+      {0x36, M::ROL, A::ZeroPageX, 6, P::None}, {0x2E, M::ROL, A::Absolute, 6, P::None},
+      {0x3E, M::ROL, A::AbsoluteX, 7, P::None},
+      {0x6A, M::ROR, A::Accumulator, 2, P::None}, {0x66, M::ROR, A::ZeroPage, 5, P::None},
+      {0x76, M::ROR, A::ZeroPageX, 6, P::None}, {0x6E, M::ROR, A::Absolute, 6, P::None},
+      {0x7E, M::ROR, A::AbsoluteX, 7, P::None},
+
+      {0x40, M::RTI, A::Implied, 6, P::None}, {0x60, M::RTS, A::Implied, 6, P::None},
+
+      {0xE9, M::SBC, A::Immediate, 2, P::None}, {0xE5, M::SBC, A::ZeroPage, 3, P::None},
+      {0xF5, M::SBC, A::ZeroPageX, 4, P::None}, {0xED, M::SBC, A::Absolute, 4, P::None},
+      {0xFD, M::SBC, A::AbsoluteX, 4, P::OnCross}, {0xF9, M::SBC, A::AbsoluteY, 4, P::OnCross},
+      {0xE1, M::SBC, A::IndirectX, 6, P::None}, {0xF1, M::SBC, A::IndirectY, 5, P::OnCross},
+
+      {0x38, M::SEC, A::Implied, 2, P::None}, {0xF8, M::SED, A::Implied, 2, P::None},
+      {0x78, M::SEI, A::Implied, 2, P::None},
+
+      {0x85, M::STA, A::ZeroPage, 3, P::None}, {0x95, M::STA, A::ZeroPageX, 4, P::None},
+      {0x8D, M::STA, A::Absolute, 4, P::None}, {0x9D, M::STA, A::AbsoluteX, 5, P::None},
+      {0x99, M::STA, A::AbsoluteY, 5, P::None}, {0x81, M::STA, A::IndirectX, 6, P::None},
+      {0x91, M::STA, A::IndirectY, 6, P::None},
+      {0x86, M::STX, A::ZeroPage, 3, P::None}, {0x96, M::STX, A::ZeroPageY, 4, P::None},
+      {0x8E, M::STX, A::Absolute, 4, P::None},
+      {0x84, M::STY, A::ZeroPage, 3, P::None}, {0x94, M::STY, A::ZeroPageX, 4, P::None},
+      {0x8C, M::STY, A::Absolute, 4, P::None},
+
+      {0xAA, M::TAX, A::Implied, 2, P::None}, {0xA8, M::TAY, A::Implied, 2, P::None},
+      {0xBA, M::TSX, A::Implied, 2, P::None}, {0x8A, M::TXA, A::Implied, 2, P::None},
+      {0x9A, M::TXS, A::Implied, 2, P::None}, {0x98, M::TYA, A::Implied, 2, P::None},
+    };
+    for (const Row &row : Rows) {
+      table[row.opcode] = {row.mnemonic, row.mode, InstructionBytes(row.mode), row.cycles, row.pageCross};
+    }
+    return table;
+  }
+
+  inline constexpr std::array<OpcodeInfo, 256> OpcodeInfoTable = MakeOpcodeInfoTable();
+
+  /** one instruction as assembler text, e.g. "LDA ($20),Y" or
+   *  "BNE $8010", ".byte $02" for an invalid opcode. bytes holds the
+   *  opcode and its operand bytes, address is where they are **/
+  std::string Disassemble(Word address, const Byte *bytes);
+
+  /** the instruction at address of any memory **/
+  template <typename Memory>
+  std::string Disassemble(const Memory &memory, Word address) {
+    Byte bytes[3];
+    for (u32 i = 0; i < 3; i++) {
+      bytes[i] = memory[static_cast<Word>(address + i)];
+    }
+    return Disassemble(address, bytes);
+  }
+}
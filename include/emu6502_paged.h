@@ -0,0 +1,78 @@
+#pragma once
+#include <emu6502.h>
+
+namespace my6502 {
+  struct PagedMem;
+}
+
+/** Copy on write memory, a drop in for Mem in CPU::Execute and Reset.
+ *  The 64 KiB are 256 pages of 256 bytes reached through a page table.
+ *  Pages and page tables are reference counted and shared between a
+ *  memory and its forks, a fork only takes a reference to the table.
+ *  The first write to a shared table copies the 256 page pointers, the
+ *  first write to a shared page copies its 256 bytes, nothing else is
+ *  ever copied. The reference counts are not atomic, a memory and all
+ *  of its forks stay on the thread that made them, CopyTo hands the
+ *  contents to another thread. **/
+struct my6502::PagedMem {
+  static constexpr u32 MAX_MEM = Mem::MAX_MEM;
+  static constexpr u32 PAGE_SIZE = Mem::PAGE_SIZE;
+  static constexpr u32 NUM_PAGES = Mem::NUM_PAGES;
+
+  /** every page reads as zero **/
+  PagedMem();
+  /** the contents of a flat memory **/
+  explicit PagedMem(const Mem &memory);
+  /** a fork, shares every page with other **/
+  PagedMem(const PagedMem &other);
+  PagedMem(PagedMem &&other) noexcept;
+  PagedMem &operator=(const PagedMem &other);
+  PagedMem &operator=(PagedMem &&other) noexcept;
+  ~PagedMem();
+
+  /** a child memory sharing every page, constant time **/
+  PagedMem Fork() const { return PagedMem(*this); }
+
+  /** zeroes the memory by dropping every page, constant time **/
+  void Initialize();
+
+  /* write access, copies the page first while it is shared */
+  Byte& operator[](u32 address) {
+    const u32 Page = (address >> 8) & (NUM_PAGES - 1);
+    Block *page = table->pages[Page];
+    if (table->refs != 1 || page->refs != 1) {
+      page = Unshare(Page);
+    }
+    return page->data[address & (PAGE_SIZE - 1)];
+  }
+
+  /* readable access */
+  Byte operator[](u32 address) const {
+    return table->pages[(address >> 8) & (NUM_PAGES - 1)]->data[address & (PAGE_SIZE - 1)];
+  }
+
+  /** copy the contents into a flat memory, every page of it counts as written **/
+  void CopyTo(Mem &memory) const;
+
+  /** true when both memories read the page from the same bytes **/
+  bool SharesPage(const PagedMem &other, u32 page) const {
+    return table->pages[page] == other.table->pages[page];
+  }
+
+private:
+  struct Block {
+    u32 refs;
+    Byte data[PAGE_SIZE];
+  };
+  struct Table {
+    u32 refs;
+    Block *pages[NUM_PAGES];
+  };
+
+  /** make the table and the page private to this memory **/
+  Block *Unshare(u32 page);
+  static Table *Zeroed();
+  static void Release(Table *table);
+
+  Table *table;
+};
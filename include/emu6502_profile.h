@@ -0,0 +1,112 @@
+#pragma once
+#include <emu6502.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace my6502 {
+  struct NullProfile;
+  struct Profile;
+  struct SequenceProfile;
+}
+
+/** Instrumentation policy of CPU::Execute(cycles, memory, policy).
+ *  A policy is told about every instruction before and after it runs,
+ *  every indexed access that paid the page crossing cycle and every read
+ *  and write on the bus.
+ *  The hooks of NullProfile are empty inline functions, the compiler
+ *  drops them and CPU::Execute with it is the plain interpreter. **/
+struct my6502::NullProfile {
+  /** false skips PageCross, Read and Write, the handlers then run on
+   *  the memory itself **/
+  static constexpr bool observesBus = false;
+
+  /** opcode was fetched from pc **/
+  void Instruction(Word, Byte) {}
+  /** opcode took the extra cycle for an indexed access crossing a page **/
+  void PageCross(Byte) {}
+  void Read(Word) {}
+  void Write(Word) {}
+  /** the instruction finished in cycles, cpu holds its results, Z and N
+   *  are still deferred, see CPU::ResolvedStatus **/
+  void Retired(const CPU &, s32) {}
+};
+
+/** Counts where an emulated program spends its time: executions per
+ *  opcode and per address, page crossing penalties per opcode and bus
+ *  reads and writes per memory page. Counters only ever grow until
+ *  Clear, one profile can collect over many calls to CPU::Execute. **/
+struct my6502::Profile {
+  using Counter = std::uint64_t;
+  static constexpr bool observesBus = true;
+
+  std::vector<Counter> opcodes;     // 256, executions per opcode
+  std::vector<Counter> addresses;   // 64 KiB, executions per instruction address
+  std::vector<Counter> pageCrosses; // 256, page crossing cycles paid per opcode
+  std::vector<Counter> pageReads;   // 256, bus reads per page, opcode fetches included
+  std::vector<Counter> pageWrites;  // 256, bus writes per page
+
+  Profile();
+
+  void Instruction(Word pc, Byte opcode) {
+    opcodes[opcode]++;
+    addresses[pc]++;
+  }
+  void PageCross(Byte opcode) { pageCrosses[opcode]++; }
+  void Read(Word address) { pageReads[address >> 8]++; }
+  void Write(Word address) { pageWrites[address >> 8]++; }
+  void Retired(const CPU &, s32) {}
+
+  /** zeroes every counter **/
+  void Clear();
+  /** total number of instructions counted **/
+  Counter Instructions() const;
+  /** the count addresses executed most often with their counts, most
+   *  frequent first **/
+  std::vector<std::pair<Word, Counter>> Hottest(u32 count) const;
+};
+
+/** Counts the sequences a BlockCache can fuse into superinstructions,
+ *  see Superinstructions in emu6502_blockcache.h: how often every
+ *  opcode ran right after every other and the calls of leaf routines,
+ *  JSR to an RTS at most MAX_LEAF_INSTRUCTIONS later without a JSR in
+ *  between. The bus is not observed. **/
+struct my6502::SequenceProfile {
+  using Counter = std::uint64_t;
+  static constexpr bool observesBus = false;
+  /** the routine, its RTS included **/
+  static constexpr u32 MAX_LEAF_INSTRUCTIONS = 4;
+
+  std::vector<Counter> pairs; // 64 Ki, executions of second right after first at first << 8 | second
+  Counter leafCalls = 0;
+  Counter instructions = 0;
+
+  SequenceProfile();
+
+  void Instruction(Word, Byte opcode) {
+    if (instructions++ != 0) {
+      pairs[(previous << 8) | opcode]++;
+    }
+    previous = opcode;
+    if (opcode == CPU::INS_JSR) {
+      sinceCall = 0;
+    } else if (sinceCall < MAX_LEAF_INSTRUCTIONS) {
+      sinceCall++;
+      if (opcode == CPU::INS_RTS) {
+        leafCalls++;
+        sinceCall = MAX_LEAF_INSTRUCTIONS;
+      }
+    }
+  }
+  void PageCross(Byte) {}
+  void Read(Word) {}
+  void Write(Word) {}
+  void Retired(const CPU &, s32) {}
+
+  /** zeroes every counter **/
+  void Clear();
+
+private:
+  u32 previous = 0;
+  u32 sinceCall = MAX_LEAF_INSTRUCTIONS; // instructions since the last JSR, as long as it may be a leaf call
+};
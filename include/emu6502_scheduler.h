@@ -0,0 +1,115 @@
+#pragma once
+#include <emu6502.h>
+#include <emu6502_bus.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace my6502 {
+  struct Scheduler;
+}
+
+/** Keeps the devices of a machine up to date without ticking them.
+ *  A device is only brought up to date when it has to be: when the CPU
+ *  reads or writes its I/O pages, or when the event it asked for is
+ *  due, e.g. a timer running out. Its CatchUpFn then advances it over
+ *  all the cycles since it last ran and returns the cycle of its next
+ *  event. Events sit on a timing wheel of SLOTS cycles, one slot per
+ *  cycle and a bitmap of the slots in use, events further out wait in
+ *  an overflow list until the wheel reaches them. Scheduling, moving
+ *  and finding the next event cost a few instructions.
+ *  The clock is run by InterruptController::Run, which executes the
+ *  CPU in stretches up to NextEvent. While a stretch runs on a Bus, Now
+ *  reads the cycle off the budget the CPU has left, so a device sees
+ *  the cycle of the instruction touching it, the same as when it was
+ *  ticked every cycle. A device write that moves its next event into
+ *  the running stretch ends the stretch there. **/
+struct my6502::Scheduler {
+  using Device = u32;
+  /** advances device from where it was up to cycle now, returns the
+   *  cycle of its next event after now, NEVER without one **/
+  using CatchUpFn = std::uint64_t (*)(void *device, std::uint64_t now);
+
+  static constexpr std::uint64_t NEVER = UINT64_MAX;
+  static constexpr u32 SLOTS = 256;
+
+  Scheduler();
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  /** a device without registers on the bus, first event at firstEvent **/
+  Device Add(CatchUpFn catchUp, void *device, std::uint64_t firstEvent = NEVER);
+  /** a device with its registers on pages first..last of bus. It is
+   *  brought up to date before every access, after a write catchUp is
+   *  asked again for its next event. **/
+  Device Map(Bus &bus, Byte first, Byte last, Bus::ReadFn read, Bus::WriteFn write,
+             CatchUpFn catchUp, void *device, std::uint64_t firstEvent = NEVER);
+
+  /** brings device up to Now and schedules its next event **/
+  void Sync(Device device);
+  /** moves the next event of device to cycle at, NEVER drops it **/
+  void Reschedule(Device device, std::uint64_t at);
+  /** ends the running stretch after the current instruction, e.g.
+   *  when a device raised an interrupt **/
+  void EndStretch();
+
+  /** the current cycle, during a stretch the cycle of the running
+   *  instruction **/
+  std::uint64_t Now() const;
+  /** the cycle of the earliest event, NEVER without one **/
+  std::uint64_t NextEvent() const;
+  /** brings every device whose event is due by Now up to date, in the
+   *  order of their events **/
+  void RunDue();
+
+  /** the CPU spent cycles outside CPU::Execute, e.g. taking an interrupt **/
+  void Elapse(s32 cycles) { now += static_cast<std::uint64_t>(cycles); }
+  /** starts a stretch of CPU::Execute(budget, memory) on memory, bus
+   *  is null when it is no Bus **/
+  void BeginStretch(s32 budget, Bus *bus);
+  /** ends it after it used cyclesUsed, returns the cycles it really
+   *  ran, without the budget EndStretch and Reschedule cut off **/
+  s32 FinishStretch(s32 cyclesUsed);
+
+  /** CatchUpFn calls **/
+  std::uint64_t catchUps = 0;
+
+private:
+  static constexpr u32 NONE = ~0u;
+  static constexpr u32 WORDS = SLOTS / 64;
+
+  struct Client {
+    Scheduler *scheduler;
+    Device id;
+    CatchUpFn catchUp;
+    void *device;
+    Bus::ReadFn read;
+    Bus::WriteFn write;
+    std::uint64_t at;  // NEVER while not scheduled
+    u32 next;          // the next client in the same slot
+    bool onWheel;
+  };
+
+  static Byte ReadThrough(void *client, Word address);
+  static void WriteThrough(void *client, Word address, Byte value);
+
+  void Insert(Client &client);
+  void Remove(Client &client);
+  /** moves the overflow events that are in reach of the wheel onto it **/
+  void Refill();
+  /** cuts the running stretch short to end at cycle at **/
+  void CutStretch(std::uint64_t at);
+
+  std::vector<std::unique_ptr<Client>> clients;
+  u32 slots[SLOTS];             // the first client of every slot
+  std::uint64_t inUse[WORDS];   // one bit per slot that has clients
+  std::vector<u32> overflow;    // clients whose event is SLOTS or more after base
+  std::uint64_t overflowMin = NEVER;
+  std::uint64_t base = 0;       // the cycle of the first slot the wheel covers
+  std::uint64_t now = 0;        // where the running stretch started
+  // the running stretch
+  std::uint64_t stretchEnd = 0;
+  Bus *bus = nullptr;
+  s32 cut = 0;
+  bool running = false;
+};
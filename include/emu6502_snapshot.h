@@ -0,0 +1,60 @@
+#pragma once
+#include <emu6502.h>
+#include <cstdint>
+#include <vector>
+
+namespace my6502 {
+  struct Snapshot;
+}
+
+/** The state of a CPU and its Mem in a versioned binary format.
+ *  A 64 byte header holds the registers and a bitmap of the pages that
+ *  are stored, the stored pages follow in address order, 256 bytes each,
+ *  pages that are all zero are left out. Every field is little endian
+ *  and the status is stored NV1BDIZC, as the 6502 pushes it, so a
+ *  snapshot restores on any host. Open maps a snapshot file, or takes
+ *  a buffer, without copying it, Restore then copies each stored page
+ *  straight from the mapping into the memory. Take and Restore are only
+ *  called between two CPU::Execute, while processorStatus is exact. **/
+struct my6502::Snapshot {
+  static constexpr u32 VERSION = 2; // 1 stored the status in the host's bit field order
+  static constexpr u32 HEADER_SIZE = 64;
+
+  /** serializes cpu and memory into out, which is reused between calls **/
+  static void Take(const CPU &cpu, const Mem &memory, std::vector<Byte> &out);
+  /** same into a file, false if it cannot be written **/
+  static bool Save(const char *path, const CPU &cpu, const Mem &memory);
+
+  Snapshot() = default;
+  ~Snapshot();
+  Snapshot(const Snapshot &) = delete;
+  Snapshot &operator=(const Snapshot &) = delete;
+
+  /** maps a snapshot file, false if it is no snapshot of this VERSION **/
+  bool Open(const char *path);
+  /** a snapshot in memory, data is not copied and has to outlive it **/
+  bool Open(const Byte *data, std::uint64_t size);
+  void Close();
+
+  /** true after a successful Open **/
+  bool IsOpen() const { return data != nullptr; }
+  /** number of pages stored, the others are zero **/
+  u32 StoredPages() const { return storedPages; }
+  /** the 256 bytes of page, nullptr when the page is all zero **/
+  const Byte *Page(u32 page) const { return pages[page]; }
+
+  /** puts the registers into cpu and the pages into memory, every page
+   *  of memory counts as written, false if nothing is open **/
+  bool Restore(CPU &cpu, Mem &memory) const;
+
+private:
+  const Byte *data = nullptr;
+  std::uint64_t length = 0;
+  bool mapped = false;   // data is a mapping of a file, not a caller's buffer
+  u32 storedPages = 0;
+  Word programCounter = 0;
+  Byte stackPointer = 0;
+  Byte accumulator = 0, indexRegX = 0, indexRegY = 0;
+  Byte processorStatus = 0;
+  const Byte *pages[Mem::NUM_PAGES] = {};
+};
@@ -0,0 +1,158 @@
+#pragma once
+#include <emu6502.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace my6502 {
+  struct TraceRecord;
+  struct TraceRecorder;
+  struct TraceReader;
+}
+
+/** One executed instruction as stored in a trace file, 16 bytes.
+ *  Registers are those after the instruction, the cycle count is the
+ *  running total of the trace when the instruction finished. **/
+struct my6502::TraceRecord {
+  u32 cyclesLow;     // running cycle count, bits 0..31
+  Word cyclesHigh;   // bits 32..47
+  Word pc;           // address of the opcode
+  Byte opcode;
+  Byte operands[2];  // the two bytes after the opcode, whatever the length
+  Byte accumulator;
+  Byte indexRegX;
+  Byte indexRegY;
+  Byte stackPointer;
+  Byte processorStatus;
+
+  std::uint64_t Cycles() const {
+    return cyclesLow | (static_cast<std::uint64_t>(cyclesHigh) << 32);
+  }
+};
+
+static_assert(sizeof(my6502::TraceRecord) == 16, "trace records are 16 bytes on disk");
+
+/** Instrumentation policy that records every instruction into a trace
+ *  file, see CPU::Execute(cycles, memory, policy).
+ *  The emulating thread only packs the registers into two words of a
+ *  single producer, single consumer ring buffer, and hands the records
+ *  to the drain in batches of PUBLISH_INTERVAL. The background thread
+ *  resolves the deferred Z and N flags and the high bits of the cycle
+ *  count, writes the records into the file, which is memory mapped and
+ *  grows as needed, and keeps a sparse index of the cycle count of every
+ *  INDEX_INTERVAL-th record that Close appends behind the records. When
+ *  the ring has no room for the next batch the emulating thread waits for
+ *  the drain, no record is ever dropped. Needs a POSIX host, Open fails
+ *  elsewhere. **/
+struct my6502::TraceRecorder {
+  static constexpr u32 INDEX_INTERVAL = 4096;
+  static constexpr u32 DEFAULT_RING_RECORDS = 1 << 14;
+  static constexpr u32 PUBLISH_INTERVAL = 64;
+  static constexpr bool observesBus = false;
+
+  /** operands are read from memory, the Mem passed to CPU::Execute;
+   *  ringRecords is rounded up to a power of two **/
+  explicit TraceRecorder(const Mem &memory, u32 ringRecords = DEFAULT_RING_RECORDS);
+  ~TraceRecorder();
+  TraceRecorder(const TraceRecorder &) = delete;
+  TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+  /** starts a new trace file, false if it cannot be created **/
+  bool Open(const char *path);
+  /** drains the ring, writes the index and closes the file, false if
+   *  the file could not be completed **/
+  bool Close();
+  /** number of instructions recorded since Open **/
+  std::uint64_t Records() const { return head; }
+
+  void Instruction(Word pc, Byte opcode) {
+    started = pc | static_cast<u32>(opcode) << 16
+      | static_cast<std::uint64_t>(memory.Data[static_cast<Word>(pc + 1)]) << 24
+      | static_cast<std::uint64_t>(memory.Data[static_cast<Word>(pc + 2)]) << 32;
+  }
+  void Retired(const CPU &cpu, s32 cycles) {
+    // two stores instead of one per field, see Pending
+    cyclesLow += static_cast<u32>(cycles);
+    Pending &slot = ring[head & ringMask];
+    slot.instruction = started | static_cast<std::uint64_t>(cpu.flagResult) << 40
+      | static_cast<std::uint64_t>(cpu.stackPointer) << 56;
+    slot.registers = cyclesLow | static_cast<std::uint64_t>(cpu.accumulator) << 32
+      | static_cast<std::uint64_t>(cpu.indexRegX) << 40
+      | static_cast<std::uint64_t>(cpu.indexRegY) << 48
+      | static_cast<std::uint64_t>(cpu.processorStatus) << 56;
+    if ((++head & publishMask) == 0) {
+      Publish();
+    }
+  }
+
+private:
+  /* a record as the emulating thread leaves it in the ring, Z and N are
+     still deferred to flagResult and the cycle count has no high bits.
+     instruction: pc, opcode, operands, flagResult, stackPointer from
+     bit 0, 16, 24, 40, 56; registers: the cycle count, accumulator, X,
+     Y, processorStatus from bit 0, 32, 40, 48, 56 */
+  struct Pending {
+    std::uint64_t instruction;
+    std::uint64_t registers;
+  };
+
+  /** hands the records so far to the drain, waits until the ring has
+   *  room for the next batch **/
+  void Publish();
+  void Drain();
+  bool Reserve(std::uint64_t bytes);
+  void Unmap();
+
+  const Mem &memory;
+  std::vector<Pending> ring;
+  std::uint64_t ringMask;
+  std::uint64_t publishMask; // a batch is at most half the ring
+  std::uint64_t started = 0; // the instruction word of the running instruction
+  u32 cyclesLow = 0;         // running cycle count, the drain adds the high bits
+  // producer side
+  std::uint64_t head = 0;      // records pushed
+  std::uint64_t freeUntil = 0; // last seen value of drained
+  alignas(64) std::atomic<std::uint64_t> published{0};
+  alignas(64) std::atomic<std::uint64_t> drained{0};
+  std::atomic<bool> stop{false};
+  // drain thread side
+  std::thread drainer;
+  std::vector<std::uint64_t> index;
+  int fd = -1;
+  Byte *map = nullptr;
+  std::uint64_t mapped = 0;    // bytes of the file mapped
+  bool failed = false;
+};
+
+/** Reads a trace file written by TraceRecorder, the file is memory
+ *  mapped, record n is found in constant time, a cycle with a binary
+ *  search of the sparse index and a scan of at most INDEX_INTERVAL
+ *  records. **/
+struct my6502::TraceReader {
+  TraceReader() = default;
+  ~TraceReader();
+  TraceReader(const TraceReader &) = delete;
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  /** false if path is not a complete trace file **/
+  bool Open(const char *path);
+  void Close();
+
+  /** number of recorded instructions **/
+  std::uint64_t Size() const { return records; }
+  /** instruction n, n < Size() **/
+  const TraceRecord &operator[](std::uint64_t n) const { return first[n]; }
+  /** the first instruction that finished at or after cycle, Size() if
+   *  the trace ends before **/
+  std::uint64_t FindCycle(std::uint64_t cycle) const;
+
+private:
+  const Byte *map = nullptr;
+  std::uint64_t length = 0;
+  const TraceRecord *first = nullptr;
+  std::uint64_t records = 0;
+  const std::uint64_t *index = nullptr;
+  std::uint64_t indexEntries = 0;
+  u32 indexInterval = 0;
+};
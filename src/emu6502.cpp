@@ -1,240 +1,781 @@
 #include <emu6502.h>
+#include <emu6502_bus.h>
+#include <emu6502_debug.h>
+#include <emu6502_opcodes.h>
+#include <emu6502_paged.h>
+#include <emu6502_profile.h>
+#include <emu6502_trace.h>
+#include <array>
+#include <climits>
+#include <type_traits>
+#include <utility>
+
+/* labels as values are a GCC/Clang extension, other compilers always get
+ * the portable dispatch loop */
+#if defined(MY6502_THREADED_DISPATCH) && defined(__GNUC__)
+#define MY6502_USE_THREADED_DISPATCH 1
+#else
+#define MY6502_USE_THREADED_DISPATCH 0
+#endif
+
+#define MY6502_OPCODE_ROW(X, hi)                                          \
+  X(hi##0) X(hi##1) X(hi##2) X(hi##3) X(hi##4) X(hi##5) X(hi##6) X(hi##7) \
+  X(hi##8) X(hi##9) X(hi##A) X(hi##B) X(hi##C) X(hi##D) X(hi##E) X(hi##F)
+/** expands X(nn) for every opcode 00..FF, nn in hex without the 0x **/
+#define MY6502_FOR_EACH_OPCODE(X)                                         \
+  MY6502_OPCODE_ROW(X, 0) MY6502_OPCODE_ROW(X, 1) MY6502_OPCODE_ROW(X, 2) \
+  MY6502_OPCODE_ROW(X, 3) MY6502_OPCODE_ROW(X, 4) MY6502_OPCODE_ROW(X, 5) \
+  MY6502_OPCODE_ROW(X, 6) MY6502_OPCODE_ROW(X, 7) MY6502_OPCODE_ROW(X, 8) \
+  MY6502_OPCODE_ROW(X, 9) MY6502_OPCODE_ROW(X, A) MY6502_OPCODE_ROW(X, B) \
+  MY6502_OPCODE_ROW(X, C) MY6502_OPCODE_ROW(X, D) MY6502_OPCODE_ROW(X, E) \
+  MY6502_OPCODE_ROW(X, F)
 
 namespace my6502 {
 
-	s32 CPU::Execute(s32 cycles, Mem &memory) {
+namespace {
 
-		/** Load a register from the memory address **/
-		auto LoadRegister = [&cycles, &memory, this](Word address, Byte &register_param) {
-			register_param = ReadByte(address, cycles, memory);
-			LoadRegisterSetStatus(register_param);
+	using AddrMode  = CPU::AddrMode;
+	using PageCross = CPU::PageCross;
+	using Timing    = CPU::Timing;
+	using Register  = Byte CPU::*;
+
+	/** Memory seen through an instrumentation policy, every read and
+	 *  write is reported before it goes to the memory **/
+	template <typename Memory, typename Policy>
+	struct Probe {
+		struct Cell {
+			Probe &probe;
+			Word address;
+			Cell &operator=(Byte value) {
+				probe.policy.Write(address);
+				probe.memory[address] = value;
+				return *this;
+			}
 		};
-  
+
+		Memory &memory;
+		Policy &policy;
+
+		Cell operator[](u32 address) {
+			return Cell{*this, static_cast<Word>(address)};
+		}
+		Byte operator[](u32 address) const {
+			policy.Read(static_cast<Word>(address));
+			return static_cast<const Memory &>(memory)[address];
+		}
+	};
+
+	/** tells the policy about a page crossing cycle Ins paid, nothing to
+	 *  tell without one **/
+	template <Byte Ins, typename Memory>
+	void NotePageCross(Memory &, bool) {}
+
+	template <Byte Ins, typename Memory, typename Policy>
+	void NotePageCross(Probe<Memory, Policy> &memory, bool crossed) {
+		if (OpcodeInfoTable[Ins].pageCross == PageCross::OnCross && crossed) {
+			memory.policy.PageCross(Ins);
+		}
+	}
+
+	/** lets a Scheduler read the cycles left of a run on a Bus and cut
+	 *  them short, nothing to do on other memory **/
+	template <typename Memory>
+	struct BudgetOf {
+		BudgetOf(Memory &, const s32 &) {}
+		s32 Cut(s32 cycles) const { return cycles; }
+	};
+
+	template <>
+	struct BudgetOf<Bus> {
+		Bus &bus;
+		BudgetOf(Bus &bus, const s32 &cycles) : bus(bus) { bus.cyclesLeft = &cycles; }
+		~BudgetOf() { bus.cyclesLeft = nullptr; }
+		BudgetOf(const BudgetOf &) = delete;
+		BudgetOf &operator=(const BudgetOf &) = delete;
+		/** the cycles left once the cuts made during the last instruction are taken off **/
+		s32 Cut(s32 cycles) const {
+			cycles -= bus.budgetCut;
+			bus.budgetCut = 0;
+			return cycles;
+		}
+	};
+
+	/* The bus helpers of CPU count into a scratch counter, every handler
+	 * charges the cycles OpcodeInfoTable gives its opcode, the opcode
+	 * fetch has already been charged by the dispatch loop. With
+	 * Timing::Fast that fetch is all an instruction costs. */
+
+	template <Byte Ins, Timing Time>
+	constexpr s32 Charge(s32 cycles, bool crossed) {
+		if constexpr (Time == Timing::Fast) {
+			return cycles;
+		} else {
+			constexpr OpcodeInfo Info = OpcodeInfoTable[Ins];
+			const s32 penalty = (Info.pageCross == PageCross::OnCross && crossed) ? 1 : 0;
+			return cycles - (Info.cycles - 1) - penalty;
+		}
+	}
+
+	/** reads the operand, returns the address it points at and whether
+	 *  indexing crossed a page **/
+	template <AddrMode Mode, typename Memory>
+	Word EffectiveAddress(CPU &cpu, const Memory &memory, bool &crossed) {
+		s32 busCycles = 0;
+		if constexpr (Mode == AddrMode::ZeroPage) {
+			return cpu.FetchByte(busCycles, memory);
+		} else if constexpr (Mode == AddrMode::ZeroPageX) {
+			return static_cast<Byte>(cpu.FetchByte(busCycles, memory) + cpu.indexRegX);
+		} else if constexpr (Mode == AddrMode::ZeroPageY) {
+			return static_cast<Byte>(cpu.FetchByte(busCycles, memory) + cpu.indexRegY);
+		} else if constexpr (Mode == AddrMode::Absolute) {
+			return cpu.FetchWord(busCycles, memory);
+		} else if constexpr (Mode == AddrMode::AbsoluteX || Mode == AddrMode::AbsoluteY) {
+			Word absAddr = cpu.FetchWord(busCycles, memory);
+			Word effectiveAddr = absAddr + (Mode == AddrMode::AbsoluteX ? cpu.indexRegX : cpu.indexRegY);
+			crossed = CPU::PageCrossed(absAddr, effectiveAddr);
+			return effectiveAddr;
+		} else if constexpr (Mode == AddrMode::IndirectX) {
+			Byte zPAddress = cpu.FetchByte(busCycles, memory) + cpu.indexRegX;
+			return cpu.ReadWord(zPAddress, busCycles, memory);
+		} else {
+			static_assert(Mode == AddrMode::IndirectY, "addressing mode has no effective address");
+			Byte zPAddress = cpu.FetchByte(busCycles, memory);
+			Word effectiveAddr = cpu.ReadWord(zPAddress, busCycles, memory);
+			Word effectiveAddrY = effectiveAddr + cpu.indexRegY;
+			crossed = CPU::PageCrossed(effectiveAddr, effectiveAddrY);
+			return effectiveAddrY;
+		}
+	}
+
+	/** LDA/LDX/LDY, the addressing mode comes from the opcode table **/
+	template <Byte Ins, Register Reg, typename Memory, Timing Time>
+	s32 LoadRegister(CPU &cpu, s32 cycles, Memory &memory) {
+		constexpr AddrMode Mode = OpcodeInfoTable[Ins].mode;
+		bool crossed = false;
+		if constexpr (Mode == AddrMode::Immediate) {
+			s32 busCycles = 0;
+			cpu.*Reg = cpu.FetchByte(busCycles, memory);
+		} else {
+			Word address = EffectiveAddress<Mode>(cpu, memory, crossed);
+			cpu.*Reg = static_cast<const Memory &>(memory)[address];
+		}
+		cpu.SetResultFlags(cpu.*Reg);
+		NotePageCross<Ins>(memory, crossed);
+		return Charge<Ins, Time>(cycles, crossed);
+	}
+
+	/** STA/STX/STY **/
+	template <Byte Ins, Register Reg, typename Memory, Timing Time>
+	s32 StoreRegister(CPU &cpu, s32 cycles, Memory &memory) {
+		s32 busCycles = 0;
+		bool crossed = false;
+		Word address = EffectiveAddress<OpcodeInfoTable[Ins].mode>(cpu, memory, crossed);
+		cpu.WriteByte(cpu.*Reg, address, busCycles, memory);
+		NotePageCross<Ins>(memory, crossed);
+		return Charge<Ins, Time>(cycles, crossed);
+	}
+
+	template <Byte Ins, typename Memory, Timing Time>
+	s32 JumpToSubroutine(CPU &cpu, s32 cycles, Memory &memory) {
+		s32 busCycles = 0;
+		Word SubAddr = cpu.FetchWord(busCycles, memory);
+		cpu.PushPCToStack(busCycles, memory);
+		cpu.programCounter = SubAddr;
+		return Charge<Ins, Time>(cycles, false);
+	}
+
+	template <Byte Ins, typename Memory, Timing Time>
+	s32 ReturnFromSubroutine(CPU &cpu, s32 cycles, Memory &memory) {
+		s32 busCycles = 0;
+		Word ReturnAddress = cpu.PopWordFromStack(busCycles, memory);
+		cpu.programCounter = ReturnAddress + 1;
+		return Charge<Ins, Time>(cycles, false);
+	}
+
+	/** JMP absolute **/
+	template <Byte Ins, typename Memory, Timing Time>
+	s32 Jump(CPU &cpu, s32 cycles, Memory &memory) {
+		s32 busCycles = 0;
+		cpu.programCounter = cpu.FetchWord(busCycles, memory);
+		return Charge<Ins, Time>(cycles, false);
+	}
+
+	/** the condition of branch Name, Z and N are deferred **/
+	template <Mnemonic Name>
+	bool BranchTaken(const CPU &cpu) {
+		if constexpr (Name == Mnemonic::BPL) {
+			return (cpu.flagResult & 0x180) == 0;
+		} else if constexpr (Name == Mnemonic::BMI) {
+			return (cpu.flagResult & 0x180) != 0;
+		} else if constexpr (Name == Mnemonic::BVC) {
+			return !cpu.Flag.overflowFlag;
+		} else if constexpr (Name == Mnemonic::BVS) {
+			return cpu.Flag.overflowFlag;
+		} else if constexpr (Name == Mnemonic::BCC) {
+			return !cpu.Flag.carryFlag;
+		} else if constexpr (Name == Mnemonic::BCS) {
+			return cpu.Flag.carryFlag;
+		} else if constexpr (Name == Mnemonic::BNE) {
+			return (cpu.flagResult & 0xFF) != 0;
+		} else {
+			static_assert(Name == Mnemonic::BEQ, "not a branch");
+			return (cpu.flagResult & 0xFF) == 0;
+		}
+	}
+
+	/** BPL, BMI, BVC, BVS, BCC, BCS, BNE and BEQ, a taken branch costs a
+	 *  cycle more, one more when it lands on another page than the
+	 *  instruction after it **/
+	template <Byte Ins, typename Memory, Timing Time>
+	s32 Branch(CPU &cpu, s32 cycles, Memory &memory) {
+		s32 busCycles = 0;
+		const auto Offset = static_cast<signed char>(cpu.FetchByte(busCycles, memory));
+		cycles = Charge<Ins, Time>(cycles, false);
+		if (BranchTaken<OpcodeInfoTable[Ins].mnemonic>(cpu)) {
+			const Word Next = cpu.programCounter;
+			cpu.programCounter = static_cast<Word>(Next + Offset);
+			if constexpr (Time == Timing::Exact) {
+				cycles -= (Next >> 8) == (cpu.programCounter >> 8) ? 1 : 2;
+			}
+		}
+		return cycles;
+	}
+
+	/** returned by a handler in place of the cycles left, the run stops **/
+	constexpr s32 STOPPED = INT_MIN;
+	/** returned by CLI and RTI in place of the cycles left when they let
+	 *  a pending IRQ through, the run stops after them **/
+	constexpr s32 UNMASKED = INT_MIN + 1;
+
+	/** the opcodes that can clear I, PLP is not implemented yet **/
+	constexpr bool Unmasks(Byte Ins) {
+		return Ins == CPU::INS_CLI || Ins == CPU::INS_RTI;
+	}
+
+	/** BRK, the byte after the opcode is skipped, the status is pushed with B set **/
+	template <Byte Ins, typename Memory, Timing Time>
+	s32 ForceBreak(CPU &cpu, s32 cycles, Memory &memory) {
+		s32 busCycles = 0;
+		cpu.ResolveFlags();
+		cpu.programCounter++;
+		cpu.EnterInterrupt(CPU::IRQ_VECTOR, true, busCycles, memory);
+		return Charge<Ins, Time>(cycles, false);
+	}
+
+	template <Byte Ins, typename Memory, Timing Time>
+	s32 ReturnFromInterrupt(CPU &cpu, s32 cycles, Memory &memory) {
+		s32 busCycles = 0;
+		cpu.StatusFromStack(cpu.PopByteFromStack(busCycles, memory));
+		Word ReturnAddress = cpu.PopByteFromStack(busCycles, memory);
+		ReturnAddress |= cpu.PopByteFromStack(busCycles, memory) << 8;
+		cpu.programCounter = ReturnAddress;
+		if (cpu.irqLine && !cpu.Flag.interruptDisable) {
+			return UNMASKED;
+		}
+		return Charge<Ins, Time>(cycles, false);
+	}
+
+	/** CLI and SEI **/
+	template <Byte Ins, bool Disable, typename Memory, Timing Time>
+	s32 SetInterruptDisable(CPU &cpu, s32 cycles, Memory &) {
+		cpu.Flag.interruptDisable = Disable;
+		if (!Disable && cpu.irqLine) {
+			return UNMASKED;
+		}
+		return Charge<Ins, Time>(cycles, false);
+	}
+
+	/** the handler of every opcode that has none, the dispatch loops stop
+	 *  in front of it **/
+	template <typename Memory>
+	s32 NotHandled(CPU &, s32, Memory &) {
+		return STOPPED;
+	}
+
+	/** the opcodes that lock up an NMOS 6502 until reset, every $x2 but
+	 *  LDX #$A2 and the two byte NOPs $82, $C2 and $E2 **/
+	constexpr bool Halts(Byte Ins) {
+		return (Ins & 0x0F) == 0x02 && Ins != 0x82 && Ins != 0xA2 && Ins != 0xC2 && Ins != 0xE2;
+	}
+
+	/** the result of a run stopped by the opcode Ins just fetched, the
+	 *  programCounter goes back onto it **/
+	ExecResult Stopped(CPU &cpu, s32 cyclesUsed, std::uint64_t instructions, Byte Ins) {
+		cpu.programCounter--;
+		return {Halts(Ins) ? StopReason::Halt : StopReason::IllegalOpcode, cyclesUsed, instructions, cpu.programCounter};
+	}
+
+	/** the result of a run stopped after the CLI or RTI Ins that let the
+	 *  IRQ through, cyclesUsed is what the run used before it **/
+	template <Timing Time>
+	ExecResult Unmasked(CPU &cpu, s32 cyclesUsed, std::uint64_t instructions, Byte Ins) {
+		const s32 Cost = Time == Timing::Fast ? 1 : OpcodeInfoTable[Ins].cycles;
+		return {StopReason::Interrupt, cyclesUsed + Cost, instructions + 1, cpu.programCounter};
+	}
+
+	/** the handler of an opcode, picked by its mnemonic in the opcode table **/
+	template <Byte Ins, typename Memory, Timing Time>
+	constexpr CPU::Handler<Memory> HandlerFor() {
+		constexpr Mnemonic Name = OpcodeInfoTable[Ins].mnemonic;
+		if constexpr (Name == Mnemonic::LDA) {
+			return &LoadRegister<Ins, &CPU::accumulator, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::LDX) {
+			return &LoadRegister<Ins, &CPU::indexRegX, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::LDY) {
+			return &LoadRegister<Ins, &CPU::indexRegY, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::STA) {
+			return &StoreRegister<Ins, &CPU::accumulator, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::STX && Ins != 0x96) { // STX zp,Y is not implemented yet
+			return &StoreRegister<Ins, &CPU::indexRegX, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::STY) {
+			return &StoreRegister<Ins, &CPU::indexRegY, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::JSR) {
+			return &JumpToSubroutine<Ins, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::RTS) {
+			return &ReturnFromSubroutine<Ins, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::JMP && Ins != 0x6C) { // JMP ($1234) is not implemented yet
+			return &Jump<Ins, Memory, Time>;
+		} else if constexpr (OpcodeInfoTable[Ins].mode == AddrMode::Relative) {
+			return &Branch<Ins, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::BRK) {
+			return &ForceBreak<Ins, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::RTI) {
+			return &ReturnFromInterrupt<Ins, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::CLI) {
+			return &SetInterruptDisable<Ins, false, Memory, Time>;
+		} else if constexpr (Name == Mnemonic::SEI) {
+			return &SetInterruptDisable<Ins, true, Memory, Time>;
+		} else {
+			return nullptr;
+		}
+	}
+
+	/** Build the dispatch table from the opcode table, one table per
+	 *  memory type the interpreter runs on and timing mode **/
+	template <typename Memory, Timing Time, std::size_t... Ins>
+	constexpr std::array<CPU::BasicOpcode<Memory>, 256> MakeOpcodeTable(std::index_sequence<Ins...>) {
+		constexpr CPU::Handler<Memory> Handlers[] = {HandlerFor<static_cast<Byte>(Ins), Memory, Time>()...};
+		std::array<CPU::BasicOpcode<Memory>, 256> table{};
+		for (u32 op = 0; op < 256; op++) {
+			const OpcodeInfo &info = OpcodeInfoTable[op];
+			if (Handlers[op] == nullptr) {
+				table[op] = {&NotHandled<Memory>, AddrMode::Implied, 0, PageCross::None};
+			} else {
+				table[op] = {Handlers[op], info.mode, info.cycles, info.pageCross};
+			}
+		}
+		return table;
+	}
+
+	template <typename Memory, Timing Time = Timing::Exact>
+	constexpr std::array<CPU::BasicOpcode<Memory>, 256> OpcodeTable =
+		MakeOpcodeTable<Memory, Time>(std::make_index_sequence<256>());
+
+	template <Timing Time = Timing::Exact, typename Memory, typename Policy>
+	ExecResult Dispatch(CPU &cpu, s32 cycles, Memory &memory, Policy &policy);
+
+	/** true when reading address cannot call a device **/
+	template <typename Memory>
+	bool Direct(const Memory &, Word) {
+		return true;
+	}
+
+	bool Direct(const Bus &bus, Word address) {
+		return bus.Direct(address);
+	}
+
+	/** Memory seen by the trial run of a loop, see SkipIdleLoop. Writes
+	 *  and reads a device would answer are not done, only noted. **/
+	template <typename Memory>
+	struct Untouched {
+		struct Cell {
+			const Untouched &untouched;
+			Cell &operator=(Byte) {
+				untouched.touched = true;
+				return *this;
+			}
+		};
+
+		const Memory &memory;
+		mutable bool touched = false;
+
+		Cell operator[](u32) {
+			return Cell{*this};
+		}
+		Byte operator[](u32 address) const {
+			if (!Direct(memory, static_cast<Word>(address))) {
+				touched = true;
+				return 0;
+			}
+			return memory[address];
+		}
+	};
+
+	/** the plain runs look for idle loops, instrumented ones see every instruction **/
+	template <typename Memory, typename Policy>
+	constexpr bool SkipsIdleLoops = std::is_same_v<Policy, NullProfile>
+		&& (std::is_same_v<Memory, Mem> || std::is_same_v<Memory, PagedMem> || std::is_same_v<Memory, Bus>);
+
+	/** the opcodes after which a run looks for an idle loop when they went back **/
+	constexpr bool Jumps(Byte Ins) {
+		return OpcodeInfoTable[Ins].mnemonic == Mnemonic::JMP || OpcodeInfoTable[Ins].mode == AddrMode::Relative;
+	}
+
+	constexpr u32 MAX_IDLE_LOOP_INSTRUCTIONS = 16;
+	/** rejected of a run that has not tried a loop yet **/
+	constexpr u32 NO_LOOP = 0x10000;
+
+	/** what SkipIdleLoop skipped **/
+	struct IdleSkip {
+		s32 cycles;
+		std::uint64_t instructions;
+	};
+
+	/** Called when an instruction jumped back to the programCounter:
+	 *  runs one iteration of the loop from there on a copy of the CPU.
+	 *  When the copy comes back with the same registers and status and
+	 *  did not write or read a device, every iteration does the same,
+	 *  the iterations that end before the budget does are skipped. A
+	 *  loop that does not is rejected for the rest of the run. The CPU
+	 *  comes by value, the state of the dispatch loop stays its own. **/
+	template <Timing Time, typename Memory>
+	IdleSkip SkipIdleLoop(const CPU cpu, s32 cycles, const Memory &memory, u32 &rejected) {
+		const Word Start = cpu.programCounter;
+		if (cycles <= 0 || Start == rejected) {
+			return {0, 0}; // the run ends here anyway
+		}
+		CPU trial = cpu;
+		trial.ResolveFlags();
+		Untouched<Memory> untouched{memory};
+		NullProfile none;
+		s32 period = 0;
+		u32 count = 0;
+		do {
+			const ExecResult Step = Dispatch<Time>(trial, 1, untouched, none);
+			period += Step.cyclesUsed;
+			count++;
+			if (Step.reason != StopReason::Cycles || untouched.touched || count > MAX_IDLE_LOOP_INSTRUCTIONS) {
+				rejected = Start;
+				return {0, 0};
+			}
+		} while (trial.programCounter != Start);
+		if (trial.accumulator != cpu.accumulator || trial.indexRegX != cpu.indexRegX
+		    || trial.indexRegY != cpu.indexRegY || trial.stackPointer != cpu.stackPointer
+		    || trial.processorStatus != cpu.ResolvedStatus()) {
+			rejected = Start;
+			return {0, 0};
+		}
+		// the last iteration runs on, the run stops in it as it would have
+		const s32 Iterations = (cycles - 1) / period;
+		return {Iterations * period, static_cast<std::uint64_t>(Iterations) * count};
+	}
+
+	/** The CPU a dispatch loop on plain memory runs on: a copy in a
+	 *  local of the loop, Z and N deferred, written back when the loop
+	 *  returns. Nothing outside the loop can point at the copy, so where
+	 *  the handlers are inlined the registers stay in host registers
+	 *  across the stores to memory instead of being reloaded after every
+	 *  one of them. Memory whose accesses may call out, PagedMem copying
+	 *  a page or a device on a Bus, runs on the CPU itself: the
+	 *  registers would have to be saved around every such call. **/
+	template <typename Memory>
+	struct Core {
+		CPU &cpu;
+		CPU state;
+		explicit Core(CPU &cpu) : cpu(cpu), state(cpu) {
+			state.DeferFlags();
+		}
+		~Core() {
+			state.ResolveFlags();
+			cpu = state;
+		}
+		Core(const Core &) = delete;
+		Core &operator=(const Core &) = delete;
+		CPU &State() { return state; }
+	};
+
+	template <>
+	struct Core<PagedMem> {
+		CPU::DeferredFlags deferred;
+		explicit Core(CPU &cpu) : deferred(cpu) {}
+		CPU &State() { return deferred.cpu; }
+	};
+
+	template <>
+	struct Core<Bus> : Core<PagedMem> {
+		using Core<PagedMem>::Core;
+	};
+
+#if MY6502_USE_THREADED_DISPATCH
+	/** Direct threaded interpreter: every opcode has its own label which
+	 *  calls its handler from the table (the call is resolved at compile
+	 *  time and inlined) and then jumps straight to the next opcode's
+	 *  label, so there is no central dispatch branch to mispredict. **/
+	template <Timing Time, typename Memory, typename Policy>
+	ExecResult Dispatch(CPU &target, s32 cycles, Memory &memory, Policy &policy) {
+    Core<Memory> core(target);
+    CPU &cpu = core.State();
+#define MY6502_DISPATCH()                                               \
+    if (cycles <= 0) {                                                  \
+      goto done;                                                        \
+    }                                                                   \
+    {                                                                   \
+      pc = cpu.programCounter;                                          \
+      insCycles = cycles;                                               \
+      const Byte Ins = cpu.FetchByte(cycles, memory);                   \
+      policy.Instruction(pc, Ins);                                      \
+      goto *Labels[Ins];                                                \
+    }
+#define MY6502_OPCODE_LABEL(n) &&op_##n,
+#define MY6502_OPCODE_BODY(n)                                           \
+    op_##n:                                                             \
+      if constexpr (OpcodeTable<Memory, Time>[0x##n].cycles == 0) {     \
+        return Stopped(cpu, cyclesRequested - insCycles, instructions, 0x##n); \
+      }                                                                 \
+      cycles = OpcodeTable<Memory, Time>[0x##n].handler(cpu, cycles, memory); \
+      if constexpr (Unmasks(0x##n)) {                                   \
+        if (cycles == UNMASKED) {                                       \
+          policy.Retired(cpu, Time == Timing::Fast ? 1 : OpcodeInfoTable[0x##n].cycles); \
+          return Unmasked<Time>(cpu, cyclesRequested - insCycles, instructions, 0x##n); \
+        }                                                               \
+      }                                                                 \
+      policy.Retired(cpu, insCycles - cycles);                          \
+      cycles = budget.Cut(cycles);                                      \
+      instructions++;                                                   \
+      if constexpr (SkipsIdleLoops<Memory, Policy> && Jumps(0x##n)) {  \
+        if (cpu.programCounter <= pc) {                                 \
+          const IdleSkip Skipped = SkipIdleLoop<Time>(cpu, cycles, memory, rejected); \
+          cycles -= Skipped.cycles;                                     \
+          instructions += Skipped.instructions;                         \
+        }                                                               \
+      }                                                                 \
+      MY6502_DISPATCH();
+
+    static void *const Labels[256] = {
+      MY6502_FOR_EACH_OPCODE(MY6502_OPCODE_LABEL)
+    };
+    const s32 cyclesRequested = cycles;
+    s32 insCycles = cycles; // cycles left when the current instruction started
+    Word pc = cpu.programCounter; // where it started
+    std::uint64_t instructions = 0;
+    u32 rejected = NO_LOOP;
+    const BudgetOf<Memory> budget(memory, cycles);
+    MY6502_DISPATCH();
+    MY6502_FOR_EACH_OPCODE(MY6502_OPCODE_BODY)
+  done:
+    return {StopReason::Cycles, cyclesRequested - cycles, instructions, 0};
+
+#undef MY6502_OPCODE_BODY
+#undef MY6502_OPCODE_LABEL
+#undef MY6502_DISPATCH
+  }
+#else
+	template <Timing Time, typename Memory, typename Policy>
+	ExecResult Dispatch(CPU &target, s32 cycles, Memory &memory, Policy &policy) {
+    Core<Memory> core(target);
+    CPU &cpu = core.State();
     const s32 cyclesRequested = cycles;
+    std::uint64_t instructions = 0;
+    u32 rejected = NO_LOOP;
+    const BudgetOf<Memory> budget(memory, cycles);
     while (cycles > 0) {
-      Byte Ins = FetchByte(cycles, memory);
-      switch (Ins) {
-      case INS_LDA_IMMEDIATE: {
-        accumulator = FetchByte(cycles, memory);
-        LoadRegisterSetStatus(accumulator);
-      } break;
-      case INS_LDX_IMMEDIATE: {
-        indexRegX = FetchByte(cycles, memory);
-        LoadRegisterSetStatus(indexRegX);
-      } break;
-      case INS_LDY_IMMEDIATE: {
-        indexRegY = FetchByte(cycles, memory);
-        LoadRegisterSetStatus(indexRegY);
-      } break;
-      case INS_LDA_ZEROPAGE: {
-				Word address = AddrZeroPage(cycles, memory);
-				LoadRegister(address, accumulator);
-      } break;
-      case INS_LDX_ZEROPAGE: {
-        Word address = AddrZeroPage(cycles, memory);
-				LoadRegister(address, indexRegX);
-      } break;
-      case INS_LDY_ZEROPAGE: {
-				Word address = AddrZeroPage(cycles, memory);
-				LoadRegister(address, indexRegY);
-      } break;
-      case INS_LDA_ZEROPX: {
-        Word address = AddrZeroPageX(cycles, memory);            
-				LoadRegister(address, accumulator);
-      } break;
-      case INS_LDY_ZEROPX: {
-        Word address = AddrZeroPageX(cycles, memory);            
-				LoadRegister(address, indexRegY);
-      } break;
-			case INS_LDX_ZEROPY: {
-        Word address = AddrZeroPageY(cycles, memory);            
-				LoadRegister(address, indexRegX);
-      } break;        
-      case INS_JSR: {
-        Word SubAddr = FetchWord(cycles, memory);
-				PushPCToStack(cycles, memory);
-        programCounter = SubAddr;
-        cycles--;
-      } break;
-			case INS_RTS: {
-				Word ReturnAddress = PopWordFromStack(cycles, memory);
-				programCounter = ReturnAddress + 1;
-				cycles -= 2;
-			} break;
-      case INS_LDA_ABS: {
-        Word address = AddrAbsolute(cycles, memory);
-				LoadRegister(address, accumulator);
-      } break;
-      case INS_LDX_ABS: {
-				Word address = AddrAbsolute(cycles, memory);
-				LoadRegister(address, indexRegX);
-      } break;
-      case INS_LDY_ABS: {
-				Word address = AddrAbsolute(cycles, memory);
-				LoadRegister(address, indexRegY);
-      } break;
-      case INS_LDA_ABSX: {
-				Word address = AddrAbsoluteX(cycles, memory);
-				LoadRegister(address, accumulator);
-      } break;
-      case INS_LDY_ABSX: {
-				Word address = AddrAbsoluteX(cycles, memory);
-				LoadRegister(address, indexRegY);
-      } break;        
-      case INS_LDA_ABSY: {
-				Word address = AddrAbsoluteY(cycles, memory);
-				LoadRegister(address, accumulator);
-      } break;
-      case INS_LDX_ABSY: {
-				Word address = AddrAbsoluteY(cycles, memory);
-				LoadRegister(address, indexRegX);
-      } break;        
-      case INS_LDA_INDIRECTX: {
-				Word address = AddrIndirectX(cycles, memory);
-				LoadRegister(address, accumulator);
-      } break;
-      case INS_STA_INDIRECTX: {
-				Word address = AddrIndirectX(cycles, memory);
-				WriteByte(accumulator, address, cycles, memory);
-      } break;        
-      case INS_LDA_INDIRECTY: {
-				Word address = AddrIndirectY(cycles, memory);
-				LoadRegister(address, accumulator);
-      } break;
-      case INS_STA_INDIRECTY: {
-				Word address = AddrIndirectY_6(cycles, memory);
-				WriteByte(accumulator, address, cycles, memory);
-      } break;        
-      case INS_STA_ZEROPAGE: {
-        Word address = AddrZeroPage(cycles, memory);
-				WriteByte(accumulator, address, cycles, memory);
-      } break;
-      case INS_STX_ZEROPAGE: {
-        Word address = AddrZeroPage(cycles, memory);
-				WriteByte(indexRegX, address, cycles, memory);
-      } break;
-      case INS_STY_ZEROPAGE: {
-        Word address = AddrZeroPage(cycles, memory);
-				WriteByte(indexRegY, address, cycles, memory);
-      } break;
-      case INS_STA_ABSOLUTE: {
-        Word address = AddrAbsolute(cycles, memory);
-				WriteByte(accumulator, address, cycles, memory);
-      } break;
-      case INS_STX_ABSOLUTE: {
-        Word address = AddrAbsolute(cycles, memory);
-				WriteByte(indexRegX, address, cycles, memory);
-      } break;
-      case INS_STY_ABSOLUTE: {
-        Word address = AddrAbsolute(cycles, memory);
-				WriteByte(indexRegY, address, cycles, memory);
-      } break;
-      case INS_STA_ZEROPAGEX: {
-        Word address = AddrZeroPageX(cycles, memory);
-				WriteByte(accumulator, address, cycles, memory);
-      } break;
-      case INS_STY_ZEROPAGEX: {
-        Word address = AddrZeroPageX(cycles, memory);
-				WriteByte(indexRegY, address, cycles, memory);
-      } break;
-      case INS_STA_ABSOLUTEX: {
-        Word address = AddrAbsoluteX_5(cycles, memory);
-        WriteByte(accumulator, address, cycles, memory);
-      } break;
-      case INS_STA_ABSOLUTEY: {
-        Word address = AddrAbsoluteY_5(cycles, memory);
-        WriteByte(accumulator, address, cycles, memory);
-      } break;
-      default: {
-        printf("Instruction %d not handled \n", Ins);
-        throw -1;
-      } break;
+      const Word pc = cpu.programCounter;
+      const s32 insCycles = cycles;
+      Byte Ins = cpu.FetchByte(cycles, memory);
+      policy.Instruction(pc, Ins);
+      cycles = OpcodeTable<Memory, Time>[Ins].handler(cpu, cycles, memory);
+      if (cycles <= UNMASKED) {
+        if (cycles == STOPPED) {
+          return Stopped(cpu, cyclesRequested - insCycles, instructions, Ins);
+        }
+        policy.Retired(cpu, Time == Timing::Fast ? 1 : OpcodeInfoTable[Ins].cycles);
+        return Unmasked<Time>(cpu, cyclesRequested - insCycles, instructions, Ins);
+      }
+      policy.Retired(cpu, insCycles - cycles);
+      cycles = budget.Cut(cycles);
+      instructions++;
+      if constexpr (SkipsIdleLoops<Memory, Policy>) {
+        if (cpu.programCounter <= pc && Jumps(Ins)) {
+          const IdleSkip Skipped = SkipIdleLoop<Time>(cpu, cycles, memory, rejected);
+          cycles -= Skipped.cycles;
+          instructions += Skipped.instructions;
+        }
       }
     }
-    return cyclesRequested - cycles;
+    return {StopReason::Cycles, cyclesRequested - cycles, instructions, 0};
   }
+#endif
+
+	/** Memory seen by RunUntil while watchpoints are set, the first
+	 *  access to a watched address is kept **/
+	template <typename Memory>
+	struct Watched {
+		struct Cell {
+			Watched &watched;
+			Word address;
+			Cell &operator=(Byte value) {
+				if (watched.until.IsWriteWatched(address)) {
+					watched.Hit(StopReason::WriteWatch, address);
+				}
+				watched.memory[address] = value;
+				return *this;
+			}
+		};
 
+		Memory &memory;
+		const StopConditions &until;
+		mutable bool hit = false;
+		mutable StopReason reason = StopReason::Cycles;
+		mutable Word address = 0;
+
+		Cell operator[](u32 address) {
+			return Cell{*this, static_cast<Word>(address)};
+		}
+		Byte operator[](u32 address) const {
+			if (until.IsReadWatched(static_cast<Word>(address))) {
+				Hit(StopReason::ReadWatch, static_cast<Word>(address));
+			}
+			return static_cast<const Memory &>(memory)[address];
+		}
+		void Hit(StopReason why, Word where) const {
+			if (!hit) {
+				hit = true;
+				reason = why;
+				address = where;
+			}
+		}
+	};
 
-	Word CPU::AddrZeroPage(s32& cycles, const Mem& memory) {
-		Byte zeroPageAddr = FetchByte(cycles, memory);
-		return zeroPageAddr;
+	/** the opcode is fetched from the memory itself, only what the
+	 *  instruction reads counts for a watchpoint **/
+	template <typename Memory>
+	Byte FetchOpcode(CPU &cpu, s32 &cycles, const Memory &memory) {
+		return cpu.FetchByte(cycles, memory);
 	}
 
-	Word CPU::AddrZeroPageX(s32& cycles, const Mem& memory) {
-		Byte zeroPageAddr = FetchByte(cycles, memory);
-		zeroPageAddr += indexRegX;
-		cycles--;          
-		return zeroPageAddr;
+	template <typename Memory>
+	Byte FetchOpcode(CPU &cpu, s32 &cycles, const Watched<Memory> &memory) {
+		return cpu.FetchByte(cycles, memory.memory);
 	}
 
-	Word CPU::AddrZeroPageY(s32& cycles, const Mem& memory) {
-		Byte zeroPageAddr = FetchByte(cycles, memory);
-		zeroPageAddr += indexRegY;
-		cycles--;          
-		return zeroPageAddr;
-	}        
+	/** true when the last instruction hit a watchpoint, never without one **/
+	template <typename Memory>
+	bool WatchHit(const Memory &, ExecResult &) {
+		return false;
+	}
 
-	Word CPU::AddrAbsolute(s32& cycles, const Mem& memory) {
- 		Word absAddr = FetchWord(cycles, memory);              
-		return absAddr;
+	template <typename Memory>
+	bool WatchHit(Watched<Memory> &memory, ExecResult &result) {
+		if (memory.hit) {
+			result.reason = memory.reason;
+			result.address = memory.address;
+		}
+		return memory.hit;
 	}
-	
-	Word CPU::AddrAbsoluteX(s32& cycles, const Mem& memory) {
-		Word absAddr = FetchWord(cycles, memory);
-		Word absAddrX = absAddr + indexRegX;
-		if ((absAddrX - absAddr) >= 0xFF) {
-			cycles--;
+
+	/** the dispatch loop of RunUntil, checks the conditions before every
+	 *  instruction and the watchpoints after it **/
+	template <typename Memory>
+	ExecResult RunLoop(CPU &target, s32 cycles, Memory &memory, const StopConditions &until) {
+		Core<Memory> core(target);
+		CPU &cpu = core.State();
+		ExecResult result{StopReason::Cycles, 0, 0, 0};
+		const s32 cyclesRequested = cycles;
+		for (;;) {
+			if (cycles <= 0) {
+				result.reason = StopReason::Cycles;
+				break;
+			}
+			if (result.instructions == until.instructions) {
+				result.reason = StopReason::Instructions;
+				break;
+			}
+			if (until.IsBreakpoint(cpu.programCounter) && result.instructions != 0) {
+				result.reason = StopReason::Breakpoint;
+				break;
+			}
+			if (until.predicate != nullptr) {
+				cpu.ResolveFlags();
+				if (until.predicate(cpu, until.context)) {
+					result.reason = StopReason::Predicate;
+					break;
+				}
+			}
+			const s32 insCycles = cycles;
+			const Byte Ins = FetchOpcode(cpu, cycles, memory);
+			cycles = OpcodeTable<Memory>[Ins].handler(cpu, cycles, memory);
+			if (cycles == STOPPED) {
+				return Stopped(cpu, cyclesRequested - insCycles, result.instructions, Ins);
+			}
+			if (cycles == UNMASKED) {
+				return Unmasked<Timing::Exact>(cpu, cyclesRequested - insCycles, result.instructions, Ins);
+			}
+			result.instructions++;
+			if (WatchHit(memory, result)) {
+				break;
+			}
 		}
-		return absAddrX;
+		result.cyclesUsed = cyclesRequested - cycles;
+		return result;
 	}
 
-	Word CPU::AddrAbsoluteX_5(s32& cycles, const Mem& memory) {
-		Word absAddr = FetchWord(cycles, memory);
-		Word absAddrX = absAddr + indexRegX;
-    cycles--;
-		return absAddrX;
+	/** the plain interpreter **/
+	template <Timing Time = Timing::Exact, typename Memory>
+	ExecResult Dispatch(CPU &cpu, s32 cycles, Memory &memory) {
+		NullProfile none;
+		return Dispatch<Time>(cpu, cycles, memory, none);
 	}
+}
 
-	Word CPU::AddrAbsoluteY(s32 &cycles, const Mem &memory) {
-		Word absAddr = FetchWord(cycles, memory);
-		Word absAddrY = absAddr + indexRegY;
-		if ((absAddrY - absAddr) >= 0xFF) {
-			cycles--;
-		}
-		return absAddrY;
+	const CPU::Opcode &CPU::Decode(Byte Ins) {
+		return OpcodeTable<Mem>[Ins];
+	}
+
+	ExecResult CPU::Execute(s32 cycles, Mem &memory) noexcept {
+		return Dispatch(*this, cycles, memory);
 	}
 
-	Word CPU::AddrAbsoluteY_5(s32 &cycles, const Mem &memory) {
-		Word absAddr = FetchWord(cycles, memory);
-		Word absAddrY = absAddr + indexRegY;
-    cycles--;
-		return absAddrY;
+	ExecResult CPU::Execute(s32 cycles, PagedMem &memory) noexcept {
+		return Dispatch(*this, cycles, memory);
 	}
 
-	Word CPU::AddrIndirectX(s32 &cycles, const Mem &memory) {
-		Byte zPAddress = FetchByte(cycles, memory);
-		zPAddress += indexRegX;
-		cycles--;
-		Word effectiveAddr = ReadWord(zPAddress, cycles, memory);
-		return effectiveAddr;
+	ExecResult CPU::Execute(s32 cycles, Bus &memory) noexcept {
+		// RAM only workloads need no page table
+		if (memory.RamOnly()) {
+			return Dispatch(*this, cycles, memory.Ram());
+		}
+		return Dispatch(*this, cycles, memory);
 	}
 
-	Word CPU::AddrIndirectY(s32 &cycles, const Mem &memory) {
-		Byte zPAddress = FetchByte(cycles, memory);
-		Word effectiveAddr = ReadWord(zPAddress, cycles, memory);
-		Word effectiveAddrY = effectiveAddr + indexRegY;
-		if ((effectiveAddrY - effectiveAddr) >= 0xFF) {
-			cycles--;
+	template <typename Policy>
+	ExecResult CPU::Execute(s32 cycles, Mem &memory, Policy &policy) noexcept {
+		// no bus to observe, the handlers of Execute(cycles, memory)
+		if constexpr (!Policy::observesBus) {
+			return Dispatch(*this, cycles, memory, policy);
+		} else {
+			Probe<Mem, Policy> probe{memory, policy};
+			return Dispatch(*this, cycles, probe, policy);
 		}
-		return effectiveAddrY;
 	}
 
-	Word CPU::AddrIndirectY_6(s32 &cycles, const Mem &memory) {
-		Byte zPAddress = FetchByte(cycles, memory);
-		Word effectiveAddr = ReadWord(zPAddress, cycles, memory);
-		Word effectiveAddrY = effectiveAddr + indexRegY;
-    cycles--;
-		return effectiveAddrY;
-	}     
-        
+	ExecResult CPU::RunUntil(s32 cycles, Mem &memory, const StopConditions &until) noexcept {
+		// without watchpoints the handlers of Execute(cycles, memory)
+		if (!until.Watching()) {
+			return RunLoop(*this, cycles, memory, until);
+		}
+		Watched<Mem> watched{memory, until};
+		return RunLoop(*this, cycles, watched, until);
+	}
+
+	template <CPU::Timing Time>
+	ExecResult CPU::Execute(s32 budget, Mem &memory) noexcept {
+		return Dispatch<Time>(*this, budget, memory);
+	}
+
+	template ExecResult CPU::Execute<CPU::Timing::Exact>(s32 budget, Mem &memory) noexcept;
+	template ExecResult CPU::Execute<CPU::Timing::Fast>(s32 budget, Mem &memory) noexcept;
+	template ExecResult CPU::Execute(s32 cycles, Mem &memory, NullProfile &policy) noexcept;
+	template ExecResult CPU::Execute(s32 cycles, Mem &memory, Profile &policy) noexcept;
+	template ExecResult CPU::Execute(s32 cycles, Mem &memory, SequenceProfile &policy) noexcept;
+	template ExecResult CPU::Execute(s32 cycles, Mem &memory, TraceRecorder &policy) noexcept;
 }
@@ -0,0 +1,383 @@
+#include <emu6502_aot.h>
+#include <emu6502_opcodes.h>
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <memory>
+
+namespace my6502 {
+
+namespace {
+
+	using AddrMode  = CPU::AddrMode;
+	using PageCross = CPU::PageCross;
+
+	/** true for the opcodes StaticRecompiler translates, those CPU::Execute
+	 *  has a handler for among the loads, stores, JSR and RTS **/
+	bool Translated(Byte Ins) {
+		if (CPU::Decode(Ins).cycles == 0) {
+			return false;
+		}
+		switch (OpcodeInfoTable[Ins].mnemonic) {
+		case Mnemonic::LDA: case Mnemonic::LDX: case Mnemonic::LDY:
+		case Mnemonic::STA: case Mnemonic::STX: case Mnemonic::STY:
+		case Mnemonic::JSR: case Mnemonic::RTS:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/** appends printf style text to out **/
+	void Append(std::string &out, const char *format, ...) {
+		char text[256];
+		va_list args;
+		va_start(args, format);
+		vsnprintf(text, sizeof(text), format, args);
+		va_end(args);
+		out += text;
+	}
+
+	/** the register of the Registers of a block an opcode loads or stores **/
+	const char *RegisterOf(Mnemonic mnemonic) {
+		switch (mnemonic) {
+		case Mnemonic::LDX: case Mnemonic::STX:
+			return "r.x";
+		case Mnemonic::LDY: case Mnemonic::STY:
+			return "r.y";
+		default:
+			return "r.a";
+		}
+	}
+
+	/** the code leaving a block after its first retired instructions **/
+	void AppendExit(std::string &out, u32 retired, const char *pc) {
+		Append(out, "instructions += %u; r.StoreTo(cpu, %s); return cycles;", retired, pc);
+	}
+}
+
+	StaticCode::StaticCode(const Program &program) : program(program), entryAt(Mem::MAX_MEM, NONE) {
+		entries.reserve(program.blockCount);
+		for (u32 i = 0; i < program.blockCount; i++) {
+			const Block &block = program.blocks[i];
+			const Word lastByte = block.address + block.size - 1;
+			entries.push_back({&block, static_cast<Byte>(block.address >> 8), static_cast<Byte>(lastByte >> 8), 0, 0, false});
+			entryAt[block.address] = i;
+		}
+	}
+
+	void StaticCode::LoadInto(Mem &memory) const {
+		for (u32 i = 0; i < program.segmentCount; i++) {
+			const Segment &segment = program.segments[i];
+			memcpy(memory.Data + segment.address, segment.data, segment.size);
+			for (u32 page = segment.address >> 8; page <= (segment.address + segment.size - 1) >> 8; page++) {
+				memory.pageVersion[page]++;
+			}
+		}
+	}
+
+	bool StaticCode::Current(Entry &entry, const Mem &memory) {
+		if (entry.checked && memory.pageVersion[entry.firstPage] == entry.firstPageVersion
+		    && memory.pageVersion[entry.lastPage] == entry.lastPageVersion) {
+			return true;
+		}
+		// the pages were written, maybe not the bytes of the block
+		if (memcmp(memory.Data + entry.block->address, entry.block->bytes, entry.block->size) != 0) {
+			entry.checked = false;
+			staleBlocks++;
+			return false;
+		}
+		entry.firstPageVersion = memory.pageVersion[entry.firstPage];
+		entry.lastPageVersion = memory.pageVersion[entry.lastPage];
+		entry.checked = true;
+		return true;
+	}
+
+	ExecResult StaticCode::Execute(CPU &cpu, s32 cycles, Mem &memory) {
+		if (checkedMemory != &memory) {
+			for (Entry &entry : entries) {
+				entry.checked = false;
+			}
+			checkedMemory = &memory;
+		}
+		ExecResult result{StopReason::Cycles, 0, 0, 0};
+		s32 left = cycles;
+		while (left > 0) {
+			const u32 Index = entryAt[cpu.programCounter];
+			// same rule as BlockCache: the interpreter must not stop inside the block
+			if (Index != NONE && entries[Index].block->maxLeadCycles < left && Current(entries[Index], memory)) {
+				blocksRun++;
+				left = entries[Index].block->code(cpu, left, memory, result.instructions);
+				continue;
+			}
+			const ExecResult Step = cpu.Execute(1, memory);
+			left -= Step.cyclesUsed;
+			result.instructions += Step.instructions;
+			interpreted += Step.instructions;
+			if (Step.reason != StopReason::Cycles) {
+				result.reason = Step.reason;
+				result.address = Step.address;
+				break;
+			}
+		}
+		result.cyclesUsed = cycles - left;
+		return result;
+	}
+
+	bool StaticRecompiler::Translate(const Image &image) {
+		if (!image.IsOpen()) {
+			return false;
+		}
+		auto loaded = std::make_unique<Mem>();
+		image.LoadInto(*loaded);
+		memory.assign(loaded->Data, loaded->Data + Mem::MAX_MEM);
+		inImage.assign(Mem::MAX_MEM, false);
+		walked.assign(Mem::MAX_MEM, false);
+		blocks.clear();
+		segments.clear();
+
+		// the image as runs of bytes, segments that touch are merged
+		std::vector<Image::Segment> sorted = image.Segments();
+		std::sort(sorted.begin(), sorted.end(),
+		          [](const Image::Segment &a, const Image::Segment &b) { return a.address < b.address; });
+		for (const Image::Segment &segment : sorted) {
+			if (segment.size == 0) {
+				continue;
+			}
+			std::fill(inImage.begin() + segment.address, inImage.begin() + segment.address + segment.size, true);
+			if (!segments.empty() && segment.address <= segments.back().address + segments.back().size) {
+				const u32 End = std::max(segments.back().address + segments.back().size, segment.address + segment.size);
+				segments.back().size = End - segments.back().address;
+			} else {
+				segments.push_back({segment.address, segment.size});
+			}
+		}
+
+		const auto VectorAt = [this](Word vector) {
+			return static_cast<Word>(memory[vector] | (memory[vector + 1] << 8));
+		};
+		entry = VectorAt(Image::RESET_VECTOR);
+		std::vector<Word> pending{entry};
+		for (const Word Vector : {CPU::NMI_VECTOR, CPU::IRQ_VECTOR}) {
+			if (inImage[Vector] && inImage[Vector + 1]) {
+				pending.push_back(VectorAt(Vector));
+			}
+		}
+		while (!pending.empty()) {
+			const Word Address = pending.back();
+			pending.pop_back();
+			Walk(Address, pending);
+		}
+		std::sort(blocks.begin(), blocks.end(), [](const Block &a, const Block &b) { return a.address < b.address; });
+		return true;
+	}
+
+	void StaticRecompiler::Walk(Word address, std::vector<Word> &pending) {
+		if (walked[address] || !inImage[address]) {
+			return;
+		}
+		walked[address] = true;
+		Block block{address, 0, 0, 0};
+		s32 maxCycles = 0;
+		u32 pc = address;
+		while (block.instructions < MAX_BLOCK_INSTRUCTIONS) {
+			const Byte Ins = memory[pc];
+			const OpcodeInfo &info = OpcodeInfoTable[Ins];
+			bool covered = pc + info.bytes <= Mem::MAX_MEM;
+			for (u32 i = 1; covered && i < info.bytes; i++) {
+				covered = inImage[pc + i];
+			}
+			const Word Operand = memory[(pc + 1) & 0xFFFF] | (memory[(pc + 2) & 0xFFFF] << 8);
+			if (!Translated(Ins) || !covered) {
+				if (block.instructions != 0) {
+					pending.push_back(static_cast<Word>(pc)); // a block of its own, or left to the interpreter
+				} else if (Ins == CPU::INS_CLI || Ins == CPU::INS_SEI) {
+					pending.push_back(static_cast<Word>(pc + 1));
+				} else if (Ins == CPU::INS_BRK) {
+					pending.push_back(static_cast<Word>(pc + 2)); // where RTI returns to
+				} else if (Ins == CPU::INS_JMP_ABSOLUTE && covered) {
+					pending.push_back(Operand);
+				} else if (info.mode == AddrMode::Relative && covered) {
+					const Word Next = static_cast<Word>(pc + 2);
+					pending.push_back(Next); // not taken
+					pending.push_back(static_cast<Word>(Next + static_cast<signed char>(Operand & 0xFF)));
+				}
+				break;
+			}
+			block.maxLeadCycles = maxCycles;
+			maxCycles += info.cycles + (info.pageCross == PageCross::OnCross ? 1 : 0);
+			block.instructions++;
+			pc += info.bytes;
+			if (Ins == CPU::INS_JSR) {
+				pending.push_back(Operand);
+				pending.push_back(static_cast<Word>(pc)); // where RTS returns to
+				break;
+			}
+			if (Ins == CPU::INS_RTS) {
+				break; // anywhere, left to the entry table
+			}
+			if (pc == Mem::MAX_MEM || !inImage[pc]) {
+				break;
+			}
+			if (block.instructions == MAX_BLOCK_INSTRUCTIONS) {
+				pending.push_back(static_cast<Word>(pc));
+			}
+		}
+		if (block.instructions != 0) {
+			block.size = static_cast<Word>(pc - address);
+			blocks.push_back(block);
+		}
+	}
+
+	std::string StaticRecompiler::Source(const char *name) const {
+		std::string out;
+		Append(out, "// written by my6502_aot, %u blocks, do not edit\n", static_cast<u32>(blocks.size()));
+		out += "#include <emu6502_aot.h>\n\nnamespace {\n\n";
+		out += "\tusing my6502::Byte;\n\tusing my6502::Word;\n\tusing my6502::s32;\n";
+		out += "\tusing my6502::CPU;\n\tusing my6502::Mem;\n\tusing my6502::StaticCode;\n";
+		for (u32 i = 0; i < segments.size(); i++) {
+			Append(out, "\n\tconst Byte Segment%u[] = {", i);
+			for (u32 offset = 0; offset < segments[i].size; offset++) {
+				Append(out, "%s0x%02X,", offset % 16 == 0 ? "\n\t\t" : " ", memory[segments[i].address + offset]);
+			}
+			out += "\n\t};\n";
+		}
+		for (const Block &block : blocks) {
+			out += "\n";
+			EmitBlock(out, block);
+		}
+		out += "\n\tconst StaticCode::Block Blocks[] = {\n";
+		for (const Block &block : blocks) {
+			u32 segment = 0;
+			while (block.address >= segments[segment].address + segments[segment].size) {
+				segment++;
+			}
+			Append(out, "\t\t{0x%04X, %u, %d, &Block_%04X, Segment%u + %u},\n", block.address, block.size,
+			       block.maxLeadCycles, block.address, segment, block.address - segments[segment].address);
+		}
+		out += "\t};\n\n\tconst StaticCode::Segment Segments[] = {\n";
+		for (u32 i = 0; i < segments.size(); i++) {
+			Append(out, "\t\t{0x%04X, %u, Segment%u},\n", segments[i].address, segments[i].size, i);
+		}
+		out += "\t};\n}\n\n";
+		Append(out, "extern const my6502::StaticCode::Program %s = {\n", name);
+		Append(out, "\tBlocks, %u, Segments, %u, 0x%04X\n};\n", static_cast<u32>(blocks.size()),
+		       static_cast<u32>(segments.size()), entry);
+		return out;
+	}
+
+	void StaticRecompiler::EmitBlock(std::string &out, const Block &block) const {
+		const u32 End = block.address + block.size;
+		Append(out, "\ts32 Block_%04X(CPU &cpu, s32 cycles, Mem &memory, std::uint64_t &instructions) {\n", block.address);
+		out += "\t\tStaticCode::Registers r(cpu);\n";
+		u32 pc = block.address;
+		for (u32 retired = 1; retired <= block.instructions; retired++) {
+			const Byte Ins = memory[pc];
+			const OpcodeInfo &info = OpcodeInfoTable[Ins];
+			const Byte Lo = memory[(pc + 1) & 0xFFFF];
+			const Word Operand = Lo | (memory[(pc + 2) & 0xFFFF] << 8);
+			const Word Next = static_cast<Word>(pc + info.bytes);
+			const char *Reg = RegisterOf(info.mnemonic);
+			char next[8];
+			snprintf(next, sizeof(next), "0x%04X", Next);
+			Append(out, "\t\t// $%04X %s\n", pc, Disassemble(memory, static_cast<Word>(pc)).c_str());
+
+			if (info.mnemonic == Mnemonic::JSR) {
+				// PushPCToStack: the address of the last byte of JSR, low byte first, below the stack pointer
+				const Word Return = static_cast<Word>(Next - 1);
+				out += "\t\t{\n\t\t\tconst Word e = Word((0x0100 | r.s) - 1);\n";
+				Append(out, "\t\t\tcycles -= %u;\n", info.cycles);
+				Append(out, "\t\t\tmemory[e] = 0x%02X;\n\t\t\tmemory[e + 1] = 0x%02X;\n", Return & 0xFF, Return >> 8);
+				out += "\t\t\tr.s -= 2;\n\t\t\t";
+				char target[8];
+				snprintf(target, sizeof(target), "0x%04X", Operand);
+				AppendExit(out, retired, target);
+				out += "\n\t\t}\n\t}\n";
+				return;
+			}
+			if (info.mnemonic == Mnemonic::RTS) {
+				out += "\t\t{\n\t\t\tconst Word e = Word((0x0100 | r.s) + 1);\n";
+				Append(out, "\t\t\tcycles -= %u;\n", info.cycles);
+				out += "\t\t\tconst Word to = Word(memory.Data[e] | (memory.Data[e + 1] << 8));\n\t\t\tr.s += 2;\n\t\t\t";
+				AppendExit(out, retired, "Word(to + 1)");
+				out += "\n\t\t}\n\t}\n";
+				return;
+			}
+			if (info.mode == AddrMode::Immediate) {
+				Append(out, "\t\tcycles -= %u;\n\t\t%s = 0x%02X;\n\t\tr.nz = %s;\n", info.cycles, Reg, Lo, Reg);
+				pc = Next;
+				continue;
+			}
+
+			// the effective address as the interpreter works it out, zero
+			// page pointers are read without wrapping around
+			out += "\t\t{\n";
+			bool constant = false;
+			Word address = 0;
+			const char *crossed = nullptr;
+			switch (info.mode) {
+			case AddrMode::ZeroPage:
+				Append(out, "\t\t\tconst Word e = 0x%02X;\n", Lo);
+				constant = true;
+				address = Lo;
+				break;
+			case AddrMode::Absolute:
+				Append(out, "\t\t\tconst Word e = 0x%04X;\n", Operand);
+				constant = true;
+				address = Operand;
+				break;
+			case AddrMode::ZeroPageX:
+			case AddrMode::ZeroPageY:
+				Append(out, "\t\t\tconst Word e = Byte(0x%02X + r.%c);\n", Lo, info.mode == AddrMode::ZeroPageX ? 'x' : 'y');
+				break;
+			case AddrMode::AbsoluteX:
+			case AddrMode::AbsoluteY:
+				Append(out, "\t\t\tconst Word b = 0x%04X;\n\t\t\tconst Word e = Word(b + r.%c);\n", Operand,
+				       info.mode == AddrMode::AbsoluteX ? 'x' : 'y');
+				crossed = "CPU::PageCrossed(b, e)";
+				break;
+			case AddrMode::IndirectX:
+				Append(out, "\t\t\tconst Byte p = Byte(0x%02X + r.x);\n", Lo);
+				out += "\t\t\tconst Word e = Word(memory.Data[p] | (memory.Data[p + 1] << 8));\n";
+				break;
+			default: // IndirectY
+				Append(out, "\t\t\tconst Word b = Word(memory.Data[0x%02X] | (memory.Data[0x%02X + 1] << 8));\n", Lo, Lo);
+				out += "\t\t\tconst Word e = Word(b + r.y);\n";
+				crossed = "CPU::PageCrossed(b, e)";
+				break;
+			}
+			if (crossed != nullptr && info.pageCross == PageCross::OnCross) {
+				Append(out, "\t\t\tcycles -= %u + %s;\n", info.cycles, crossed);
+			} else {
+				Append(out, "\t\t\tcycles -= %u;\n", info.cycles);
+			}
+			if (info.mnemonic == Mnemonic::LDA || info.mnemonic == Mnemonic::LDX || info.mnemonic == Mnemonic::LDY) {
+				Append(out, "\t\t\t%s = memory.Data[e];\n\t\t\tr.nz = %s;\n\t\t}\n", Reg, Reg);
+				pc = Next;
+				continue;
+			}
+			// through Mem::operator[], which bumps the page version
+			Append(out, "\t\t\tmemory[e] = %s;\n", Reg);
+			// a store into the bytes of the block leaves it, the rest runs as it is now
+			const bool Own = constant && address >= block.address && address < End;
+			if (Own) {
+				out += "\t\t\t";
+				AppendExit(out, retired, next);
+				out += "\n\t\t}\n\t}\n";
+				return;
+			}
+			if (!constant) {
+				Append(out, "\t\t\tif (Word(e - 0x%04X) < %u) {\n\t\t\t\t", block.address, block.size);
+				AppendExit(out, retired, next);
+				out += "\n\t\t\t}\n";
+			}
+			out += "\t\t}\n";
+			pc = Next;
+		}
+		out += "\t\t";
+		char next[8];
+		snprintf(next, sizeof(next), "0x%04X", static_cast<Word>(pc));
+		AppendExit(out, block.instructions, next);
+		out += "\n\t}\n";
+	}
+}
@@ -0,0 +1,493 @@
+#include <emu6502_batch.h>
+#include <emu6502_opcodes.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+/* the gathers use GCC/Clang target attributes, every other host or
+ * compiler gathers one lane after the other */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MY6502_BATCH_AVX2 1
+#include <immintrin.h>
+#else
+#define MY6502_BATCH_AVX2 0
+#endif
+
+/* the lane loops are also compiled for AVX2, picked at load time (ifunc) */
+#if MY6502_BATCH_AVX2 && defined(__linux__)
+#define MY6502_BATCH_TARGETS __attribute__((target_clones("avx2", "default")))
+#else
+#define MY6502_BATCH_TARGETS
+#endif
+
+namespace my6502 {
+
+namespace {
+
+	using AddrMode  = CPU::AddrMode;
+	using PageCross = CPU::PageCross;
+	using Register  = std::vector<Byte> Batch::*;
+	constexpr u32 LANES = Batch::LANES;
+
+	/** out[k] = arena[offsets[k]] for the lanes set in the mask, 0 otherwise **/
+	using GatherFn = void (*)(const Byte *arena, const u32 *offsets, const u32 *mask, u32 *out);
+
+	void GatherLanes(const Byte *arena, const u32 *offsets, const u32 *mask, u32 *out) {
+		for (u32 k = 0; k < LANES; k++) {
+			out[k] = mask[k] ? arena[offsets[k]] : 0;
+		}
+	}
+
+#if MY6502_BATCH_AVX2
+	__attribute__((target("avx2")))
+	void GatherLanesAVX2(const Byte *arena, const u32 *offsets, const u32 *mask, u32 *out) {
+		const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(offsets));
+		const __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask));
+		// reads 4 bytes, the interleaved memory is padded for the last lane
+		__m256i bytes = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(),
+		                                            reinterpret_cast<const int *>(arena), index, lanes, 1);
+		bytes = _mm256_and_si256(bytes, _mm256_set1_epi32(0xFF));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out), bytes);
+	}
+#endif
+
+	GatherFn SelectGather() {
+#if MY6502_BATCH_AVX2
+		if (__builtin_cpu_supports("avx2")) {
+			return &GatherLanesAVX2;
+		}
+#endif
+		return &GatherLanes;
+	}
+
+	const GatherFn Gather = SelectGather();
+
+	/** the bits of processorStatus written by LoadRegisterSetStatus **/
+	struct StatusBits {
+		Byte zero;
+		Byte negative;
+	};
+
+	StatusBits ProbeStatusBits() {
+		CPU probe{};
+		StatusBits bits{};
+		probe.processorStatus = 0;
+		probe.Flag.zeroFlag = 1;
+		bits.zero = probe.processorStatus;
+		probe.processorStatus = 0;
+		probe.Flag.negativeFlag = 1;
+		bits.negative = probe.processorStatus;
+		return bits;
+	}
+
+	const StatusBits Status = ProbeStatusBits();
+
+	enum class Operation { None, LoadRegister, StoreRegister, JumpToSubroutine, ReturnFromSubroutine };
+
+	struct Kernel {
+		Operation operation;
+		Register reg;
+	};
+
+	/** how the lanes carry out an opcode, by its mnemonic in the opcode
+	 *  table, None for opcodes left to CPU::Execute **/
+	Kernel KernelFor(Byte Ins) {
+		if (CPU::Decode(Ins).cycles == 0) {
+			return {Operation::None, nullptr};
+		}
+		switch (OpcodeInfoTable[Ins].mnemonic) {
+		case Mnemonic::LDA:
+			return {Operation::LoadRegister, &Batch::accumulator};
+		case Mnemonic::LDX:
+			return {Operation::LoadRegister, &Batch::indexRegX};
+		case Mnemonic::LDY:
+			return {Operation::LoadRegister, &Batch::indexRegY};
+		case Mnemonic::STA:
+			return {Operation::StoreRegister, &Batch::accumulator};
+		case Mnemonic::STX:
+			return {Operation::StoreRegister, &Batch::indexRegX};
+		case Mnemonic::STY:
+			return {Operation::StoreRegister, &Batch::indexRegY};
+		case Mnemonic::JSR:
+			return {Operation::JumpToSubroutine, nullptr};
+		case Mnemonic::RTS:
+			return {Operation::ReturnFromSubroutine, nullptr};
+		default:
+			return {Operation::None, nullptr};
+		}
+	}
+
+	/** the address CPU::SPToAddress gives for a stack pointer **/
+	Word StackAddress(Byte stackPointer) {
+		CPU probe{};
+		probe.stackPointer = stackPointer;
+		return probe.SPToAddress();
+	}
+}
+
+	Batch::Batch(u32 instances)
+		: instances(instances), lanes((instances + LANES - 1) / LANES * LANES) {
+		assert(instances <= MAX_INSTANCES);
+		programCounter.resize(lanes);
+		stackPointer.resize(lanes);
+		accumulator.resize(lanes);
+		indexRegX.resize(lanes);
+		indexRegY.resize(lanes);
+		processorStatus.resize(lanes);
+		cyclesUsed.resize(lanes);
+		stopReason.resize(lanes);
+		cyclesLeft.resize(lanes);
+		group.resize(lanes);
+		operandLo.resize(lanes);
+		operandHi.resize(lanes);
+		effectiveAddress.resize(lanes);
+		loaded.resize(lanes);
+		pageCrossed.resize(lanes);
+		gatherOffsets.resize(lanes);
+		returnBytes.resize(lanes);
+		memory.resize(static_cast<std::size_t>(Mem::MAX_MEM) * lanes + sizeof(u32));
+	}
+
+	bool Batch::UsesAVX2() {
+		return Gather != &GatherLanes;
+	}
+
+	void Batch::Load(u32 instance, const CPU &cpu, const Mem &from) {
+		for (u32 address = 0; address < Mem::MAX_MEM; address++) {
+			memory[address * lanes + instance] = from.Data[address];
+		}
+		SetState(instance, cpu);
+	}
+
+	void Batch::Save(u32 instance, CPU &cpu, Mem &to) const {
+		for (u32 address = 0; address < Mem::MAX_MEM; address++) {
+			to.Data[address] = memory[address * lanes + instance];
+		}
+		for (u32 page = 0; page < Mem::NUM_PAGES; page++) {
+			to.pageVersion[page]++;
+		}
+		cpu = State(instance);
+	}
+
+	CPU Batch::State(u32 instance) const {
+		CPU cpu{};
+		cpu.programCounter = programCounter[instance];
+		cpu.stackPointer = stackPointer[instance];
+		cpu.accumulator = accumulator[instance];
+		cpu.indexRegX = indexRegX[instance];
+		cpu.indexRegY = indexRegY[instance];
+		cpu.processorStatus = processorStatus[instance];
+		return cpu;
+	}
+
+	void Batch::SetState(u32 instance, const CPU &cpu) {
+		programCounter[instance] = cpu.programCounter;
+		stackPointer[instance] = cpu.stackPointer;
+		accumulator[instance] = cpu.accumulator;
+		indexRegX[instance] = cpu.indexRegX;
+		indexRegY[instance] = cpu.indexRegY;
+		processorStatus[instance] = cpu.processorStatus;
+	}
+
+	void Batch::Execute(s32 cycles) {
+		for (u32 lane = 0; lane < lanes; lane++) {
+			cyclesLeft[lane] = lane < instances ? cycles : 0;
+			group[lane] = 0;
+			stopReason[lane] = StopReason::Cycles;
+		}
+		u32 first = 0; // every instance below it has used its budget
+		while (true) {
+			while (first < instances && cyclesLeft[first] <= 0) {
+				first++;
+			}
+			if (first == instances) {
+				break;
+			}
+			const Word pc = programCounter[first];
+			const Byte Ins = memory[pc * lanes + first];
+			const u32 members = FindGroup(Ins, pc, first);
+			if (members < MIN_LOCKSTEP_INSTANCES || KernelFor(Ins).operation == Operation::None) {
+				for (u32 lane = first; lane < instances; lane++) {
+					if (group[lane] != 0) {
+						RunScalar(lane, cycles);
+						group[lane] = 0;
+						splits++;
+					}
+				}
+				continue;
+			}
+			Step(Ins, pc, first);
+			lockstepInstructions += members;
+		}
+		for (u32 instance = 0; instance < instances; instance++) {
+			if (stopReason[instance] == StopReason::Cycles) {
+				cyclesUsed[instance] = cycles - cyclesLeft[instance];
+			}
+		}
+	}
+
+	void Batch::RunScalar(u32 instance, s32 cycles) {
+		if (!scratch) {
+			scratch = std::make_unique<Mem>();
+		}
+		CPU cpu{};
+		Save(instance, cpu, *scratch);
+		const ExecResult run = cpu.Execute(cyclesLeft[instance], *scratch);
+		cyclesLeft[instance] -= run.cyclesUsed;
+		stopReason[instance] = run.reason;
+		if (run.reason != StopReason::Cycles) {
+			// finished without using its budget, no lockstep group takes it again
+			cyclesUsed[instance] = cycles - cyclesLeft[instance];
+			cyclesLeft[instance] = 0;
+		}
+		Load(instance, cpu, *scratch);
+	}
+
+	MY6502_BATCH_TARGETS
+	u32 Batch::FindGroup(Byte Ins, Word pc, u32 firstLane) {
+		// everything in locals, stores through Byte pointers could alias the members
+		const u32 lanes = this->lanes;
+		const Byte *opcodes = &memory[pc * lanes];
+		const Word *programCounter = this->programCounter.data();
+		const s32 *cyclesLeft = this->cyclesLeft.data();
+		u32 *group = this->group.data();
+		u32 members = 0;
+		// from the start of the vector, the finished lanes before firstLane drop out
+		for (u32 i = firstLane - firstLane % LANES; i < lanes; i++) {
+			const u32 member = (cyclesLeft[i] > 0) & (programCounter[i] == pc) & (opcodes[i] == Ins);
+			group[i] = 0u - member;
+			members += member;
+		}
+		return members;
+	}
+
+	MY6502_BATCH_TARGETS
+	void Batch::Step(Byte Ins, Word pc, u32 firstLane) {
+		const CPU::Opcode &op = CPU::Decode(Ins);
+		const Kernel kernel = KernelFor(Ins);
+		const Byte operandBytes = OpcodeInfoTable[Ins].bytes - 1;
+		const Word nextPC = static_cast<Word>(pc + 1 + operandBytes);
+		const s32 baseCycles = op.cycles;
+		const u32 penalty = op.pageCross == PageCross::OnCross ? ~0u : 0u;
+		// everything in locals, stores through Byte pointers could alias the members
+		const u32 begin = firstLane - firstLane % LANES;
+		const u32 lanes = this->lanes;
+		Byte *mem = memory.data();
+		const u32 *mask = group.data();
+		Word *programCounter = this->programCounter.data();
+		Byte *stackPointer = this->stackPointer.data();
+		Byte *processorStatus = this->processorStatus.data();
+		s32 *cyclesLeft = this->cyclesLeft.data();
+		u32 *lo = operandLo.data();
+		u32 *hi = operandHi.data();
+		u32 *address = effectiveAddress.data();
+		u32 *value = loaded.data();
+		u32 *crossed = pageCrossed.data();
+		u32 *offsets = gatherOffsets.data();
+		Byte *bytes = returnBytes.data();
+
+		// every lane reads the same address: one contiguous row
+		auto row = [&](Word at, u32 *out) {
+			const Byte *from = &mem[at * lanes];
+			for (u32 i = begin; i < lanes; i++) {
+				out[i] = from[i];
+			}
+		};
+		// the address all members use, or -1 when they differ
+		auto uniform = [&](const u32 *addresses) -> s32 {
+			const u32 at = addresses[firstLane];
+			u32 differ = 0;
+			for (u32 i = begin; i < lanes; i++) {
+				differ |= (addresses[i] ^ at) & mask[i];
+			}
+			return differ == 0 ? static_cast<s32>(at & 0xFFFF) : -1;
+		};
+		// every lane reads its own address, LANES lanes per gather
+		auto gather = [&](const u32 *addresses, u32 *out) {
+			const s32 at = uniform(addresses);
+			if (at >= 0) {
+				row(static_cast<Word>(at), out);
+				return;
+			}
+			for (u32 i = begin; i < lanes; i++) {
+				offsets[i] = (addresses[i] & 0xFFFF) * lanes + i;
+			}
+			for (u32 lane0 = begin; lane0 < lanes; lane0 += LANES) {
+				u32 any = 0;
+				for (u32 k = 0; k < LANES; k++) {
+					any |= mask[lane0 + k];
+				}
+				if (any != 0) {
+					Gather(mem, &offsets[lane0], &mask[lane0], &out[lane0]);
+				}
+			}
+		};
+		// every member writes its own address
+		auto scatter = [&](const u32 *addresses, const Byte *values) {
+			const s32 at = uniform(addresses);
+			if (at >= 0) {
+				Byte *to = &mem[at * lanes];
+				for (u32 i = begin; i < lanes; i++) {
+					to[i] = static_cast<Byte>((values[i] & mask[i]) | (to[i] & ~mask[i]));
+				}
+				return;
+			}
+			for (u32 i = begin; i < lanes; i++) {
+				if (mask[i] != 0) {
+					mem[(addresses[i] & 0xFFFF) * lanes + i] = values[i];
+				}
+			}
+		};
+
+		row(static_cast<Word>(pc + 1), lo);
+		if (operandBytes == 2) {
+			row(static_cast<Word>(pc + 2), hi);
+		}
+
+		if (kernel.operation == Operation::JumpToSubroutine) {
+			// SPToAddress is the stack page or'ed with the stack pointer
+			const Word stackPage = StackAddress(0);
+			const Word returnAddress = static_cast<Word>(pc + 2);
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] = static_cast<Word>((stackPage | stackPointer[i]) - 1);
+				bytes[i] = static_cast<Byte>(returnAddress);
+			}
+			scatter(address, bytes);
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] += 1;
+				bytes[i] = static_cast<Byte>(returnAddress >> 8);
+			}
+			scatter(address, bytes);
+			for (u32 i = begin; i < lanes; i++) {
+				const u32 m = mask[i];
+				cyclesLeft[i] -= baseCycles & m;
+				stackPointer[i] -= static_cast<Byte>(2 & m);
+				programCounter[i] = static_cast<Word>(((lo[i] | (hi[i] << 8)) & m) | (programCounter[i] & ~m));
+			}
+			return;
+		}
+		if (kernel.operation == Operation::ReturnFromSubroutine) {
+			const Word stackPage = StackAddress(0);
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] = static_cast<Word>((stackPage | stackPointer[i]) + 1);
+			}
+			gather(address, lo);
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] += 1;
+			}
+			gather(address, hi);
+			for (u32 i = begin; i < lanes; i++) {
+				const u32 m = mask[i];
+				cyclesLeft[i] -= baseCycles & m;
+				stackPointer[i] += static_cast<Byte>(2 & m);
+				programCounter[i] = static_cast<Word>((((lo[i] | (hi[i] << 8)) + 1) & m) | (programCounter[i] & ~m));
+			}
+			return;
+		}
+
+		const Byte *index = nullptr;
+		switch (op.mode) {
+		case AddrMode::ZeroPageX: case AddrMode::AbsoluteX: case AddrMode::IndirectX:
+			index = indexRegX.data();
+			break;
+		case AddrMode::ZeroPageY: case AddrMode::AbsoluteY: case AddrMode::IndirectY:
+			index = indexRegY.data();
+			break;
+		default:
+			break;
+		}
+		switch (op.mode) {
+		case AddrMode::Immediate:
+			break;
+		case AddrMode::ZeroPage:
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] = lo[i];
+				crossed[i] = 0;
+			}
+			break;
+		case AddrMode::ZeroPageX:
+		case AddrMode::ZeroPageY:
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] = (lo[i] + index[i]) & 0xFF;
+				crossed[i] = 0;
+			}
+			break;
+		case AddrMode::Absolute:
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] = lo[i] | (hi[i] << 8);
+				crossed[i] = 0;
+			}
+			break;
+		case AddrMode::AbsoluteX:
+		case AddrMode::AbsoluteY:
+			for (u32 i = begin; i < lanes; i++) {
+				const u32 absAddr = lo[i] | (hi[i] << 8);
+				address[i] = (absAddr + index[i]) & 0xFFFF;
+				crossed[i] = 0u - static_cast<u32>(CPU::PageCrossed(static_cast<Word>(absAddr), static_cast<Word>(address[i])));
+			}
+			break;
+		case AddrMode::IndirectX:
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] = (lo[i] + index[i]) & 0xFF; // zero page pointer
+			}
+			gather(address, lo);
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] += 1;
+			}
+			gather(address, hi);
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] = lo[i] | (hi[i] << 8);
+				crossed[i] = 0;
+			}
+			break;
+		case AddrMode::IndirectY:
+			for (u32 i = begin; i < lanes; i++) {
+				address[i] = lo[i] + 1; // high byte of the zero page pointer
+			}
+			gather(address, hi);
+			gather(lo, lo);
+			for (u32 i = begin; i < lanes; i++) {
+				const u32 effectiveAddr = lo[i] | (hi[i] << 8);
+				address[i] = (effectiveAddr + index[i]) & 0xFFFF;
+				crossed[i] = 0u - static_cast<u32>(CPU::PageCrossed(static_cast<Word>(effectiveAddr), static_cast<Word>(address[i])));
+			}
+			break;
+		default:
+			break;
+		}
+
+		if (kernel.operation == Operation::StoreRegister) {
+			scatter(address, (this->*kernel.reg).data());
+			for (u32 i = begin; i < lanes; i++) {
+				const u32 m = mask[i];
+				cyclesLeft[i] -= (baseCycles + static_cast<s32>(crossed[i] & penalty & 1)) & m;
+				programCounter[i] = static_cast<Word>((nextPC & m) | (programCounter[i] & ~m));
+			}
+			return;
+		}
+		if (op.mode == AddrMode::Immediate) {
+			value = lo;
+			for (u32 i = begin; i < lanes; i++) {
+				crossed[i] = 0;
+			}
+		} else {
+			gather(address, value);
+		}
+		Byte *reg = (this->*kernel.reg).data();
+		const Byte keep = static_cast<Byte>(~(Status.zero | Status.negative));
+		const Byte zero = Status.zero;
+		const Byte negative = Status.negative;
+		// branch free so the loop vectorizes: members take the new value, the rest keep theirs
+		for (u32 i = begin; i < lanes; i++) {
+			const u32 m = mask[i];
+			cyclesLeft[i] -= (baseCycles + static_cast<s32>(crossed[i] & penalty & 1)) & m;
+			programCounter[i] = static_cast<Word>((nextPC & m) | (programCounter[i] & ~m));
+		}
+		for (u32 i = begin; i < lanes; i++) {
+			const u32 m = mask[i];
+			const u32 flags = (zero & (0u - (value[i] == 0))) | (negative & (0u - (value[i] >> 7)));
+			reg[i] = static_cast<Byte>((value[i] & m) | (reg[i] & ~m));
+			processorStatus[i] = static_cast<Byte>((((processorStatus[i] & keep) | flags) & m) | (processorStatus[i] & ~m));
+		}
+	}
+}
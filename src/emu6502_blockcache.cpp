@@ -0,0 +1,437 @@
+#include <emu6502_blockcache.h>
+#include <emu6502_opcodes.h>
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <utility>
+
+namespace my6502 {
+
+namespace {
+
+	using AddrMode  = CPU::AddrMode;
+	using PageCross = CPU::PageCross;
+	using Handler   = DecodedIns::Handler;
+	using Register  = Byte CPU::*;
+
+	/** effective address of a decoded operand, adds the page crossing
+	 *  cycle to penalty for the modes that charge one **/
+	template <AddrMode Mode, PageCross Cross>
+	Word EffectiveAddress(const CPU &cpu, const DecodedIns &ins, const Mem &memory, s32 &penalty) {
+		if constexpr (Mode == AddrMode::ZeroPage || Mode == AddrMode::Absolute) {
+			return ins.operand;
+		} else if constexpr (Mode == AddrMode::ZeroPageX) {
+			return static_cast<Byte>(ins.operand + cpu.indexRegX);
+		} else if constexpr (Mode == AddrMode::ZeroPageY) {
+			return static_cast<Byte>(ins.operand + cpu.indexRegY);
+		} else if constexpr (Mode == AddrMode::AbsoluteX || Mode == AddrMode::AbsoluteY) {
+			Byte index = (Mode == AddrMode::AbsoluteX) ? cpu.indexRegX : cpu.indexRegY;
+			Word effectiveAddr = ins.operand + index;
+			if (Cross == PageCross::OnCross && CPU::PageCrossed(ins.operand, effectiveAddr)) {
+				penalty++;
+			}
+			return effectiveAddr;
+		} else if constexpr (Mode == AddrMode::IndirectX) {
+			Byte zPAddress = static_cast<Byte>(ins.operand + cpu.indexRegX);
+			return memory[zPAddress] | (memory[zPAddress + 1] << 8);
+		} else {
+			static_assert(Mode == AddrMode::IndirectY, "addressing mode has no effective address");
+			Word effectiveAddr = memory[ins.operand] | (memory[ins.operand + 1] << 8);
+			Word effectiveAddrY = effectiveAddr + cpu.indexRegY;
+			if (Cross == PageCross::OnCross && CPU::PageCrossed(effectiveAddr, effectiveAddrY)) {
+				penalty++;
+			}
+			return effectiveAddrY;
+		}
+	}
+
+	/* The bus helpers of CPU count into a scratch counter, a decoded
+	 * instruction is charged its base cycles (plus page crossing) once. */
+
+	template <Register Reg>
+	s32 LoadImmediate(CPU &cpu, const DecodedIns &ins, s32 cycles, Mem &) {
+		cpu.programCounter = ins.nextPC;
+		cpu.*Reg = static_cast<Byte>(ins.operand);
+		cpu.SetResultFlags(cpu.*Reg);
+		return cycles - ins.cycles;
+	}
+
+	template <AddrMode Mode, PageCross Cross, Register Reg>
+	s32 LoadRegister(CPU &cpu, const DecodedIns &ins, s32 cycles, Mem &memory) {
+		s32 penalty = 0;
+		cpu.programCounter = ins.nextPC;
+		Word address = EffectiveAddress<Mode, Cross>(cpu, ins, memory, penalty);
+		cpu.*Reg = static_cast<const Mem &>(memory)[address];
+		cpu.SetResultFlags(cpu.*Reg);
+		return cycles - ins.cycles - penalty;
+	}
+
+	template <AddrMode Mode, Register Reg>
+	s32 StoreRegister(CPU &cpu, const DecodedIns &ins, s32 cycles, Mem &memory) {
+		s32 penalty = 0, busCycles = 0;
+		cpu.programCounter = ins.nextPC;
+		Word address = EffectiveAddress<Mode, PageCross::None>(cpu, ins, memory, penalty);
+		cpu.WriteByte(cpu.*Reg, address, busCycles, memory);
+		return cycles - ins.cycles;
+	}
+
+	s32 JumpToSubroutine(CPU &cpu, const DecodedIns &ins, s32 cycles, Mem &memory) {
+		s32 busCycles = 0;
+		cpu.programCounter = ins.nextPC;
+		cpu.PushPCToStack(busCycles, memory);
+		cpu.programCounter = ins.operand;
+		return cycles - ins.cycles;
+	}
+
+	s32 ReturnFromSubroutine(CPU &cpu, const DecodedIns &ins, s32 cycles, Mem &memory) {
+		s32 busCycles = 0;
+		Word ReturnAddress = cpu.PopWordFromStack(busCycles, memory);
+		cpu.programCounter = ReturnAddress + 1;
+		return cycles - ins.cycles;
+	}
+
+	struct Decoder {
+		Handler handler;
+		bool writesMemory;
+	};
+
+	/** the decoded handler of an opcode, picked by its mnemonic, addressing
+	 *  mode and page crossing in the opcode table as CPU::Execute picks
+	 *  its own, nullptr for the opcodes the block cache leaves alone **/
+	template <Byte Ins>
+	constexpr Decoder DecoderFor() {
+		constexpr OpcodeInfo Info = OpcodeInfoTable[Ins];
+		constexpr Mnemonic Name = Info.mnemonic;
+		constexpr Register Reg = (Name == Mnemonic::LDX || Name == Mnemonic::STX) ? &CPU::indexRegX
+			: (Name == Mnemonic::LDY || Name == Mnemonic::STY) ? &CPU::indexRegY : &CPU::accumulator;
+		if constexpr (Name == Mnemonic::LDA || Name == Mnemonic::LDX || Name == Mnemonic::LDY) {
+			if constexpr (Info.mode == AddrMode::Immediate) {
+				return {&LoadImmediate<Reg>, false};
+			} else {
+				return {&LoadRegister<Info.mode, Info.pageCross, Reg>, false};
+			}
+		} else if constexpr (Name == Mnemonic::STA || Name == Mnemonic::STX || Name == Mnemonic::STY) {
+			return {&StoreRegister<Info.mode, Reg>, true};
+		} else if constexpr (Name == Mnemonic::JSR) {
+			return {&JumpToSubroutine, true};
+		} else if constexpr (Name == Mnemonic::RTS) {
+			return {&ReturnFromSubroutine, false};
+		} else {
+			return {nullptr, false};
+		}
+	}
+
+	/** decoded handlers for the loads, stores, JSR and RTS, nullptr for
+	 *  the rest. Decode also leaves out the opcodes CPU::Execute has no
+	 *  handler for, a block never runs what the interpreter would not. **/
+	template <std::size_t... Ins>
+	constexpr std::array<Decoder, 256> MakeDecoderTable(std::index_sequence<Ins...>) {
+		return {DecoderFor<static_cast<Byte>(Ins)>()...};
+	}
+
+	constexpr std::array<Decoder, 256> DecoderTable = MakeDecoderTable(std::make_index_sequence<256>());
+
+	constexpr Byte NOT_FUSED = 0xFF;
+
+	/** the decoded opcodes of the mnemonics, at most 255 **/
+	template <std::size_t Count>
+	constexpr std::array<Byte, Count> OpcodesOf(std::initializer_list<Mnemonic> mnemonics) {
+		std::array<Byte, Count> opcodes{};
+		std::size_t n = 0;
+		for (u32 op = 0; op < 256; op++) {
+			for (const Mnemonic name : mnemonics) {
+				if (DecoderTable[op].handler != nullptr && OpcodeInfoTable[op].mnemonic == name) {
+					opcodes[n++] = static_cast<Byte>(op);
+				}
+			}
+		}
+		return opcodes;
+	}
+
+	constexpr std::size_t CountOf(std::initializer_list<Mnemonic> mnemonics) {
+		std::size_t n = 0;
+		for (u32 op = 0; op < 256; op++) {
+			for (const Mnemonic name : mnemonics) {
+				n += DecoderTable[op].handler != nullptr && OpcodeInfoTable[op].mnemonic == name;
+			}
+		}
+		return n;
+	}
+
+	/* A pair is a load followed by a load or a store. The load writes
+	 * nothing, the second instruction can not have been written over in
+	 * between, which RunBlock would only notice after the pair. */
+	constexpr std::size_t LOADS = CountOf({Mnemonic::LDA, Mnemonic::LDX, Mnemonic::LDY});
+	constexpr std::size_t MOVES = CountOf({Mnemonic::LDA, Mnemonic::LDX, Mnemonic::LDY,
+	                                       Mnemonic::STA, Mnemonic::STX, Mnemonic::STY});
+	constexpr std::array<Byte, LOADS> Loads = OpcodesOf<LOADS>({Mnemonic::LDA, Mnemonic::LDX, Mnemonic::LDY});
+	constexpr std::array<Byte, MOVES> Moves = OpcodesOf<MOVES>({Mnemonic::LDA, Mnemonic::LDX, Mnemonic::LDY,
+	                                                            Mnemonic::STA, Mnemonic::STX, Mnemonic::STY});
+
+	/** position of every opcode in opcodes, NOT_FUSED if it is not there **/
+	template <std::size_t Count>
+	constexpr std::array<Byte, 256> IndexOf(const std::array<Byte, Count> &opcodes) {
+		std::array<Byte, 256> index{};
+		for (Byte &i : index) {
+			i = NOT_FUSED;
+		}
+		for (std::size_t i = 0; i < Count; i++) {
+			index[opcodes[i]] = static_cast<Byte>(i);
+		}
+		return index;
+	}
+
+	constexpr std::array<Byte, 256> LoadIndex = IndexOf(Loads);
+	constexpr std::array<Byte, 256> MoveIndex = IndexOf(Moves);
+
+	/** a pair, both parts count their cycles from 0 and the sum is taken
+	 *  off the budget once **/
+	template <Handler First, Handler Second>
+	s32 FusedPair(CPU &cpu, const DecodedIns &ins, s32 cycles, Mem &memory) {
+		s32 spent = First(cpu, ins, 0, memory);
+		spent = Second(cpu, (&ins)[1], spent, memory);
+		return cycles + spent;
+	}
+
+	template <std::size_t... Pair>
+	constexpr std::array<Handler, sizeof...(Pair)> MakePairTable(std::index_sequence<Pair...>) {
+		return {&FusedPair<DecoderTable[Loads[Pair / MOVES]].handler, DecoderTable[Moves[Pair % MOVES]].handler>...};
+	}
+
+	/** the handler of every pair, the load at LoadIndex * MOVES + MoveIndex **/
+	constexpr std::array<Handler, LOADS * MOVES> PairTable = MakePairTable(std::make_index_sequence<LOADS * MOVES>());
+
+	/** a JSR and the leaf routine it calls, up to its RTS, the routine
+	 *  runs as long as its page is unchanged, a part that writes over it
+	 *  ends the call there **/
+	s32 CallLeaf(CPU &cpu, const DecodedIns &ins, s32 cycles, Mem &memory) {
+		s32 spent = JumpToSubroutine(cpu, ins, 0, memory);
+		const Byte Page = ins.operand >> 8;
+		for (u32 part = 1; part < ins.length && memory.pageVersion[Page] == ins.codeVersion; part++) {
+			const DecodedIns &next = (&ins)[part];
+			spent = next.handler(cpu, next, spent, memory);
+		}
+		return cycles + spent;
+	}
+
+	/** the most cycles ins can take **/
+	s32 WorstCycles(const DecodedIns &ins) {
+		return ins.cycles + (CPU::Decode(ins.opcode).pageCross == PageCross::OnCross ? 1 : 0);
+	}
+
+	/** RunBlock with Z and N already deferred **/
+	s32 RunDeferred(const BlockCache::Block &block, CPU &cpu, s32 cycles, Mem &memory) {
+		for (std::size_t i = 0; i < block.instructions.size(); i += block.instructions[i].length) {
+			const DecodedIns &ins = block.instructions[i];
+			cycles = ins.handler(cpu, ins, cycles, memory);
+			if (ins.writesMemory && BlockCache::IsStale(block, memory)) {
+				break; // the block wrote over its own code
+			}
+		}
+		return cycles;
+	}
+}
+
+	Superinstructions::Superinstructions() : pairs(256 * 256) {}
+
+	bool Superinstructions::Fusable(Byte first, Byte second) {
+		return LoadIndex[first] != NOT_FUSED && MoveIndex[second] != NOT_FUSED;
+	}
+
+	Superinstructions Superinstructions::Hot(const SequenceProfile &profile, double share) {
+		Superinstructions hot;
+		const double Least = share * static_cast<double>(profile.instructions);
+		for (u32 pair = 0; pair < 256 * 256; pair++) {
+			hot.pairs[pair] = profile.pairs[pair] != 0 && profile.pairs[pair] >= Least
+				&& Fusable(static_cast<Byte>(pair >> 8), static_cast<Byte>(pair));
+		}
+		hot.leafCalls = profile.leafCalls != 0 && profile.leafCalls >= Least;
+		return hot;
+	}
+
+	u32 Superinstructions::Pairs() const {
+		return static_cast<u32>(std::count(pairs.begin(), pairs.end(), true));
+	}
+
+	BlockCache::BlockCache() : blocks(Mem::MAX_MEM) {}
+
+	void BlockCache::Fuse(const Superinstructions &superinstructions) {
+		fused = superinstructions;
+		Clear();
+	}
+
+	s32 BlockCache::Execute(CPU &target, s32 cycles, Mem &memory) {
+		// a local copy, Z and N deferred for the whole run as in CPU::Execute
+		CPU cpu = target;
+		cpu.DeferFlags();
+		const s32 cyclesRequested = cycles;
+		while (cycles > 0) {
+			const Block *block = Lookup(cpu.programCounter, memory);
+			// a block may only run when the interpreter would not stop
+			// before its last instruction, otherwise step the interpreter
+			if (block == nullptr || block->maxLeadCycles >= cycles) {
+				cpu.ResolveFlags();
+				const ExecResult step = cpu.Execute(1, memory);
+				cpu.DeferFlags();
+				cycles -= step.cyclesUsed;
+				if (step.reason != StopReason::Cycles) {
+					break; // in front of an opcode without a handler
+				}
+				continue;
+			}
+			cycles = RunDeferred(*block, cpu, cycles, memory);
+		}
+		cpu.ResolveFlags();
+		target = cpu;
+		return cyclesRequested - cycles;
+	}
+
+	s32 BlockCache::RunBlock(const Block &block, CPU &cpu, s32 cycles, Mem &memory) {
+		const CPU::DeferredFlags deferred(cpu);
+		return RunDeferred(block, cpu, cycles, memory);
+	}
+
+	void BlockCache::InvalidatePage(Byte page) {
+		// blocks that start on the page before can run into this page
+		u32 first = (page == 0) ? 0 : (page - 1) * Mem::PAGE_SIZE;
+		u32 last = (page + 1) * Mem::PAGE_SIZE;
+		for (u32 address = first; address < last; address++) {
+			const std::unique_ptr<Block> &block = blocks[address];
+			if (block && block->firstPage <= page && page <= block->lastPage) {
+				blocks[address].reset();
+			}
+		}
+	}
+
+	void BlockCache::Clear() {
+		for (std::unique_ptr<Block> &block : blocks) {
+			block.reset();
+		}
+	}
+
+	const BlockCache::Block *BlockCache::Lookup(Word address, const Mem &memory) {
+		if (cachedMemory != &memory) {
+			Clear();
+			cachedMemory = &memory;
+		}
+		std::unique_ptr<Block> &block = blocks[address];
+		if (block && IsStale(*block, memory)) {
+			block.reset();
+		}
+		if (!block) {
+			block = Decode(address, memory);
+		}
+		return block->instructions.empty() ? nullptr : block.get();
+	}
+
+	bool BlockCache::IsStale(const Block &block, const Mem &memory) {
+		return memory.pageVersion[block.firstPage] != block.firstPageVersion
+			|| memory.pageVersion[block.lastPage] != block.lastPageVersion;
+	}
+
+	std::unique_ptr<BlockCache::Block> BlockCache::Decode(Word address, const Mem &memory) {
+		auto block = std::make_unique<Block>();
+		Word pc = address;
+		while (block->instructions.size() < MAX_BLOCK_INSTRUCTIONS) {
+			Byte Ins = memory[pc];
+			const CPU::Opcode &op = CPU::Decode(Ins);
+			const Decoder &decoder = DecoderTable[Ins];
+			const Byte operandBytes = OpcodeInfoTable[Ins].bytes - 1;
+			if (decoder.handler == nullptr || op.cycles == 0 || static_cast<u32>(pc) + 1 + operandBytes > Mem::MAX_MEM) {
+				break; // left to the interpreter
+			}
+			DecodedIns ins{};
+			ins.handler = decoder.handler;
+			ins.opcode = Ins;
+			ins.cycles = op.cycles;
+			ins.writesMemory = decoder.writesMemory;
+			ins.length = 1;
+			if (operandBytes >= 1) {
+				ins.operand = memory[pc + 1];
+			}
+			if (operandBytes == 2) {
+				ins.operand |= memory[pc + 2] << 8;
+			}
+			ins.nextPC = pc + 1 + operandBytes;
+			block->instructions.push_back(ins);
+			const Mnemonic Name = OpcodeInfoTable[Ins].mnemonic;
+			if (Name == Mnemonic::JSR || Name == Mnemonic::RTS || ins.nextPC == 0) {
+				break; // control flow ends the block, so does the end of memory
+			}
+			pc = ins.nextPC;
+		}
+		const Word lastByte = block->instructions.empty() ? address : static_cast<Word>(block->instructions.back().nextPC - 1);
+		block->firstPage = address >> 8;
+		block->lastPage = lastByte >> 8;
+		block->firstPageVersion = memory.pageVersion[block->firstPage];
+		block->lastPageVersion = memory.pageVersion[block->lastPage];
+		if (fused.leafCalls && !block->instructions.empty()
+		    && OpcodeInfoTable[block->instructions.back().opcode].mnemonic == Mnemonic::JSR) {
+			FuseLeafCall(*block, memory);
+		}
+		FusePairs(*block);
+		// a leaf routine runs inside its call, it counts as instructions of the block
+		block->maxLeadCycles = 0;
+		s32 maxCycles = 0;
+		for (const DecodedIns &ins : block->instructions) {
+			block->maxLeadCycles = maxCycles;
+			maxCycles += WorstCycles(ins);
+		}
+		blocksDecoded++;
+		return block;
+	}
+
+	bool BlockCache::FuseLeafCall(Block &block, const Mem &memory) {
+		const std::size_t Call = block.instructions.size() - 1;
+		const Word Routine = block.instructions[Call].operand;
+		Word pc = Routine;
+		for (u32 n = 0; n < SequenceProfile::MAX_LEAF_INSTRUCTIONS; n++) {
+			const Byte Ins = memory[pc];
+			const Decoder &decoder = DecoderTable[Ins];
+			const OpcodeInfo &info = OpcodeInfoTable[Ins];
+			const Byte Bytes = info.bytes;
+			const Byte Cycles = CPU::Decode(Ins).cycles;
+			// loads and stores in the page of the routine, then RTS
+			if (decoder.handler == nullptr || Cycles == 0 || info.mnemonic == Mnemonic::JSR
+			    || (pc >> 8) != ((pc + Bytes - 1) >> 8) || (pc >> 8) != (Routine >> 8)) {
+				break;
+			}
+			DecodedIns ins{};
+			ins.handler = decoder.handler;
+			ins.opcode = Ins;
+			ins.cycles = Cycles;
+			ins.writesMemory = decoder.writesMemory;
+			ins.length = 1;
+			ins.operand = Bytes >= 2 ? memory[pc + 1] : 0;
+			ins.operand |= Bytes == 3 ? memory[pc + 2] << 8 : 0;
+			ins.nextPC = pc + Bytes;
+			block.instructions.push_back(ins);
+			if (info.mnemonic == Mnemonic::RTS) {
+				DecodedIns &call = block.instructions[Call];
+				call.handler = &CallLeaf;
+				call.length = static_cast<Byte>(block.instructions.size() - Call);
+				call.codeVersion = memory.pageVersion[Routine >> 8];
+				superinstructionsDecoded++;
+				return true;
+			}
+			pc = ins.nextPC;
+		}
+		block.instructions.resize(Call + 1);
+		return false;
+	}
+
+	void BlockCache::FusePairs(Block &block) {
+		std::vector<DecodedIns> &code = block.instructions;
+		for (std::size_t i = 0; i + 1 < code.size(); i += code[i].length) {
+			DecodedIns &first = code[i];
+			const DecodedIns &second = code[i + 1];
+			if (first.length != 1 || second.length != 1 || !fused.pairs[(first.opcode << 8) | second.opcode]) {
+				continue;
+			}
+			first.handler = PairTable[LoadIndex[first.opcode] * MOVES + MoveIndex[second.opcode]];
+			first.length = 2;
+			first.writesMemory = second.writesMemory;
+			superinstructionsDecoded++;
+		}
+	}
+}
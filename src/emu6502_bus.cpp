@@ -0,0 +1,50 @@
+#include <emu6502_bus.h>
+
+namespace my6502 {
+
+	Bus::Bus(Mem &ram) : ram(ram) {
+		for (u32 page = 0; page < NUM_PAGES; page++) {
+			readPages[page] = ram.Data + page * PAGE_SIZE;
+			writePages[page] = ram.Data;
+			devices[page] = {nullptr, nullptr, nullptr};
+		}
+	}
+
+	void Bus::MapRAM(Byte first, Byte last) {
+		for (u32 page = first; page <= last; page++) {
+			mappedPages -= (writePages[page] == nullptr);
+			readPages[page] = ram.Data + page * PAGE_SIZE;
+			writePages[page] = ram.Data;
+			devices[page] = {nullptr, nullptr, nullptr};
+		}
+	}
+
+	void Bus::MapROM(Byte first, Byte last) {
+		for (u32 page = first; page <= last; page++) {
+			mappedPages += (writePages[page] != nullptr);
+			readPages[page] = ram.Data + page * PAGE_SIZE;
+			writePages[page] = nullptr;
+			devices[page] = {nullptr, nullptr, nullptr};
+		}
+	}
+
+	void Bus::MapROM(Byte first, Byte last, const Byte *rom) {
+		for (u32 page = first; page <= last; page++) {
+			mappedPages += (writePages[page] != nullptr);
+			readPages[page] = rom + (page - first) * PAGE_SIZE;
+			writePages[page] = nullptr;
+			devices[page] = {nullptr, nullptr, nullptr};
+		}
+	}
+
+	void Bus::MapDevice(Byte first, Byte last, ReadFn read, WriteFn write, void *device) {
+		assert(read != nullptr);
+		for (u32 page = first; page <= last; page++) {
+			mappedPages += (writePages[page] != nullptr);
+			readPages[page] = nullptr;
+			writePages[page] = nullptr;
+			devices[page] = {read, write, device};
+		}
+	}
+
+}
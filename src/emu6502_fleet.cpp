@@ -0,0 +1,174 @@
+#include <emu6502_fleet.h>
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace my6502 {
+
+	Fleet::Fleet(u32 count) : head(&stub), tail(&stub) {
+		if (count == 0) {
+			count = std::max(1u, std::thread::hardware_concurrency());
+		}
+		for (u32 i = 0; i < count; i++) {
+			workers.push_back(std::make_unique<Worker>());
+		}
+		// every deque exists before the first worker looks for jobs to steal
+		for (u32 i = 0; i < count; i++) {
+			workers[i]->thread = std::thread(&Fleet::Run, this, i);
+		}
+	}
+
+	Fleet::~Fleet() {
+		Wait();
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto &worker : workers) {
+			worker->thread.join();
+		}
+	}
+
+	void Fleet::Submit(Job job) {
+		const u32 Worker = nextWorker;
+		nextWorker = (nextWorker + 1) % Workers();
+		Submit(std::move(job), Worker);
+	}
+
+	void Fleet::Submit(Job job, u32 worker) {
+		assert(worker < Workers() && job.image);
+		outstanding.fetch_add(1, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> guard(workers[worker]->lock);
+			workers[worker]->jobs.push_back(std::move(job));
+		}
+		// queued only counts jobs that are already in a deque
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+			queued.fetch_add(1, std::memory_order_relaxed);
+		}
+		wake.notify_one();
+	}
+
+	bool Fleet::Take(u32 index, Job &job) {
+		{
+			Worker &own = *workers[index];
+			std::lock_guard<std::mutex> guard(own.lock);
+			if (!own.jobs.empty()) {
+				job = std::move(own.jobs.back());
+				own.jobs.pop_back();
+				queued.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		for (u32 i = 1; i < Workers(); i++) {
+			Worker &victim = *workers[(index + i) % Workers()];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (!victim.jobs.empty()) {
+				job = std::move(victim.jobs.front());
+				victim.jobs.pop_front();
+				queued.fetch_sub(1, std::memory_order_relaxed);
+				workers[index]->steals.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Fleet::Run(u32 index) {
+		// allocated by the thread that runs on it
+		CPU cpu{};
+		auto memory = std::make_unique<Mem>();
+
+		for (;;) {
+			Job job;
+			if (!Take(index, job)) {
+				std::unique_lock<std::mutex> sleep(sleepLock);
+				wake.wait(sleep, [this] { return stopping || queued.load(std::memory_order_relaxed) > 0; });
+				if (stopping && queued.load(std::memory_order_relaxed) == 0) {
+					return;
+				}
+				continue;
+			}
+
+			*memory = *job.image;
+			cpu = job.cpu;
+			auto completion = new Completion;
+			completion->result.id = job.id;
+			const ExecResult run = cpu.Execute(job.cycles, *memory);
+			completion->result.cyclesUsed = run.cyclesUsed;
+			completion->result.completed = run.reason == StopReason::Cycles;
+			completion->result.cpu = cpu;
+			if (job.keepMemory) {
+				completion->result.memory = std::move(memory);
+				memory = std::make_unique<Mem>();
+			}
+			Complete(completion);
+		}
+	}
+
+	void Fleet::Push(Completion *completion) {
+		completion->next.store(nullptr, std::memory_order_relaxed);
+		Completion *previous = head.exchange(completion, std::memory_order_acq_rel);
+		previous->next.store(completion, std::memory_order_release);
+	}
+
+	void Fleet::Complete(Completion *completion) {
+		Push(completion);
+		if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			std::lock_guard<std::mutex> guard(doneLock);
+			done.notify_all();
+		}
+	}
+
+	bool Fleet::Poll(Result &result) {
+		Completion *first = tail;
+		Completion *next = first->next.load(std::memory_order_acquire);
+		if (first == &stub) {
+			if (next == nullptr) {
+				return false;
+			}
+			tail = first = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+		if (next == nullptr) {
+			// a worker is between the exchange and linking its node
+			if (first != head.load(std::memory_order_acquire)) {
+				return false;
+			}
+			// first is the last node, put the stub behind it so it can be taken
+			Push(&stub);
+			next = first->next.load(std::memory_order_acquire);
+			if (next == nullptr) {
+				return false;
+			}
+		}
+		tail = next;
+		result = std::move(first->result);
+		delete first;
+		return true;
+	}
+
+	std::vector<Fleet::Result> Fleet::Wait() {
+		{
+			std::unique_lock<std::mutex> wait(doneLock);
+			done.wait(wait, [this] { return outstanding.load(std::memory_order_acquire) == 0; });
+		}
+		std::vector<Result> results;
+		Result result;
+		while (Poll(result)) {
+			results.push_back(std::move(result));
+		}
+		return results;
+	}
+
+	std::uint64_t Fleet::Steals() const {
+		std::uint64_t steals = 0;
+		for (const auto &worker : workers) {
+			steals += worker->steals.load(std::memory_order_relaxed);
+		}
+		return steals;
+	}
+
+}
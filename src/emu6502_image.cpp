@@ -0,0 +1,304 @@
+#include <emu6502_image.h>
+#include <emu6502_bus.h>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MY6502_IMAGE_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MY6502_IMAGE_POSIX 0
+#endif
+
+namespace my6502 {
+
+namespace {
+
+	constexpr u32 INES_HEADER_SIZE = 16;
+	constexpr u32 INES_TRAINER_SIZE = 512;
+	constexpr u32 INES_BANK_SIZE = 16 * 1024;
+	constexpr Byte INES_TRAINER = 0b100; // bit of flags 6
+
+	/** value of a hex digit, -1 if c is none **/
+	int HexDigit(Byte c) {
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		return -1;
+	}
+
+	/** every page start..start+size-1 touches counts as written **/
+	void TouchPages(Mem &memory, u32 start, u32 size) {
+		for (u32 page = start >> 8; page <= (start + size - 1) >> 8; page++) {
+			memory.pageVersion[page]++;
+		}
+	}
+
+	/** copies the bytes from..to-1 of segment into the RAM of bus and maps their pages as ROM **/
+	void CopyAsROM(Bus &bus, const Image::Segment &segment, u32 from, u32 to) {
+		if (from < to) {
+			memcpy(bus.Ram().Data + from, segment.data + (from - segment.address), to - from);
+			TouchPages(bus.Ram(), from, to - from);
+			bus.MapROM(from >> 8, (to - 1) >> 8);
+		}
+	}
+}
+
+	Image::~Image() {
+		Close();
+	}
+
+	bool Image::Open(const char *path, Format format, Word address) {
+		Close();
+#if MY6502_IMAGE_POSIX
+		const int fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		void *region = MAP_FAILED;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			region = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		close(fd);
+		if (region == MAP_FAILED) {
+			return false;
+		}
+		data = static_cast<const Byte *>(region);
+		length = info.st_size;
+		mapped = true;
+		if (!Parse(data, length, format, address)) {
+			Close();
+			return false;
+		}
+		return true;
+#else
+		(void)path;
+		(void)format;
+		(void)address;
+		return false;
+#endif
+	}
+
+	bool Image::Open(const Byte *bytes, std::uint64_t size, Format format, Word address) {
+		Close();
+		data = bytes;
+		length = size;
+		if (!Parse(data, length, format, address)) {
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Image::Close() {
+#if MY6502_IMAGE_POSIX
+		if (mapped) {
+			munmap(const_cast<Byte *>(data), length);
+		}
+#endif
+		data = nullptr;
+		length = 0;
+		mapped = false;
+		opened = false;
+		segments.clear();
+		decoded.clear();
+		entry = 0;
+	}
+
+	bool Image::Parse(const Byte *bytes, std::uint64_t size, Format format, Word address) {
+		switch (format) {
+		case Format::Raw:
+			if (size == 0 || address + size > Mem::MAX_MEM) {
+				return false;
+			}
+			segments.push_back({address, static_cast<u32>(size), bytes});
+			entry = address;
+			break;
+		case Format::PRG: {
+			if (size < 3) {
+				return false;
+			}
+			const Word load = bytes[0] | (bytes[1] << 8);
+			if (load + (size - 2) > Mem::MAX_MEM) {
+				return false;
+			}
+			segments.push_back({load, static_cast<u32>(size - 2), bytes + 2});
+			entry = load;
+			break;
+		}
+		case Format::IntelHex:
+			if (!ParseIntelHex(bytes, size)) {
+				return false;
+			}
+			break;
+		case Format::INES: {
+			if (size < INES_HEADER_SIZE || memcmp(bytes, "NES\x1A", 4) != 0 || bytes[4] == 0) {
+				return false;
+			}
+			const u32 banks = bytes[4];
+			const Byte *prg = bytes + INES_HEADER_SIZE + ((bytes[6] & INES_TRAINER) ? INES_TRAINER_SIZE : 0);
+			if (static_cast<std::uint64_t>(prg - bytes) + std::uint64_t{banks} * INES_BANK_SIZE > size) {
+				return false;
+			}
+			// NROM-128 mirrors its one bank, bigger boards start with the last bank fixed at $C000
+			const Byte *last = prg + (banks - 1) * INES_BANK_SIZE;
+			segments.push_back({0x8000, INES_BANK_SIZE, prg});
+			segments.push_back({0xC000, INES_BANK_SIZE, last});
+			entry = last[RESET_VECTOR - 0xC000] | (last[RESET_VECTOR - 0xC000 + 1] << 8);
+			break;
+		}
+		default:
+			return false;
+		}
+		opened = true;
+		return true;
+	}
+
+	bool Image::ParseIntelHex(const Byte *bytes, std::uint64_t size) {
+		decoded.assign(Mem::MAX_MEM, 0);
+		u32 base = 0;          // from extended segment or linear address records
+		bool hasStart = false; // a start address record was seen
+		std::uint64_t at = 0;
+		const auto NextByte = [&](Byte &value) {
+			if (at + 2 > size) {
+				return false;
+			}
+			const int high = HexDigit(bytes[at]);
+			const int low = HexDigit(bytes[at + 1]);
+			at += 2;
+			value = static_cast<Byte>((high << 4) | low);
+			return high >= 0 && low >= 0;
+		};
+
+		for (;;) {
+			while (at < size && (bytes[at] == '\r' || bytes[at] == '\n' || bytes[at] == ' ' || bytes[at] == '\t')) {
+				at++;
+			}
+			if (at == size) {
+				return false; // no end of file record
+			}
+			if (bytes[at++] != ':') {
+				return false;
+			}
+			Byte count, addressHigh, addressLow, type;
+			if (!NextByte(count) || !NextByte(addressHigh) || !NextByte(addressLow) || !NextByte(type)) {
+				return false;
+			}
+			Byte sum = count + addressHigh + addressLow + type;
+			Byte field[255];
+			for (u32 i = 0; i < count; i++) {
+				if (!NextByte(field[i])) {
+					return false;
+				}
+				sum += field[i];
+			}
+			Byte checksum;
+			if (!NextByte(checksum) || static_cast<Byte>(sum + checksum) != 0) {
+				return false;
+			}
+
+			// in 64 bits, base + offset + count must not wrap past the check
+			const std::uint64_t address = std::uint64_t{base} + ((addressHigh << 8) | addressLow);
+			switch (type) {
+			case 0x00: // data
+				if (count == 0) {
+					break;
+				}
+				if (address >= Mem::MAX_MEM || count > Mem::MAX_MEM - address) {
+					return false;
+				}
+				memcpy(decoded.data() + address, field, count);
+				if (!hasStart && segments.empty()) {
+					entry = static_cast<Word>(address);
+				}
+				if (!segments.empty() && segments.back().address + segments.back().size == address) {
+					segments.back().size += count;
+				} else {
+					segments.push_back({static_cast<Word>(address), count, decoded.data() + address});
+				}
+				break;
+			case 0x01: // end of file
+				opened = !segments.empty();
+				return opened;
+			case 0x02: // extended segment address
+				if (count != 2) return false;
+				base = ((field[0] << 8) | field[1]) << 4;
+				if (base >= Mem::MAX_MEM) {
+					return false; // past the 64 KiB of the 6502
+				}
+				break;
+			case 0x03: // start segment address, CS:IP
+				if (count != 4) return false;
+				entry = static_cast<Word>((((field[0] << 8) | field[1]) << 4) + ((field[2] << 8) | field[3]));
+				hasStart = true;
+				break;
+			case 0x04: // extended linear address
+				if (count != 2) return false;
+				base = static_cast<u32>((field[0] << 8) | field[1]) << 16;
+				if (base >= Mem::MAX_MEM) {
+					return false;
+				}
+				break;
+			case 0x05: // start linear address
+				if (count != 4) return false;
+				entry = static_cast<Word>((field[2] << 8) | field[3]);
+				hasStart = true;
+				break;
+			default:
+				return false;
+			}
+		}
+	}
+
+	bool Image::CoversResetVector() const {
+		for (const Segment &segment : segments) {
+			if (segment.address <= RESET_VECTOR && segment.address + segment.size >= RESET_VECTOR + 2u) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool Image::LoadInto(Mem &memory) const {
+		if (!opened) {
+			return false;
+		}
+		for (const Segment &segment : segments) {
+			memcpy(memory.Data + segment.address, segment.data, segment.size);
+			TouchPages(memory, segment.address, segment.size);
+		}
+		if (!CoversResetVector()) {
+			memory[RESET_VECTOR] = entry & 0xFF;
+			memory[RESET_VECTOR + 1] = entry >> 8;
+		}
+		return true;
+	}
+
+	bool Image::MapInto(Bus &bus) const {
+		if (!opened) {
+			return false;
+		}
+		Mem &ram = bus.Ram();
+		for (const Segment &segment : segments) {
+			const u32 end = segment.address + segment.size;
+			// the whole pages are mapped, the pieces of pages before and after them copied
+			u32 first = (segment.address + Mem::PAGE_SIZE - 1) / Mem::PAGE_SIZE * Mem::PAGE_SIZE;
+			u32 last = end / Mem::PAGE_SIZE * Mem::PAGE_SIZE;
+			if (first < last) {
+				bus.MapROM(first >> 8, (last >> 8) - 1, segment.data + (first - segment.address));
+			} else {
+				first = last = end;
+			}
+			CopyAsROM(bus, segment, segment.address, first);
+			CopyAsROM(bus, segment, last, end);
+		}
+		if (!CoversResetVector()) {
+			ram[RESET_VECTOR] = entry & 0xFF;
+			ram[RESET_VECTOR + 1] = entry >> 8;
+		}
+		return true;
+	}
+}
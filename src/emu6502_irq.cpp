@@ -0,0 +1,111 @@
+#include <emu6502_irq.h>
+#include <emu6502_bus.h>
+#include <cassert>
+
+namespace my6502 {
+
+namespace {
+
+	/** the Bus a stretch runs on, for the scheduler to tell the time by **/
+	Bus *BusOf(Mem &) { return nullptr; }
+	Bus *BusOf(Bus &bus) { return &bus; }
+}
+
+	InterruptController::Source InterruptController::AddSource(Line line) {
+		assert(sources < MAX_SOURCES);
+		const Source New = sources++;
+		if (line == Line::NMI) {
+			nmiSources |= 1u << New;
+		}
+		timed[New] = {this, New, 0, Scheduler::NEVER, 0};
+		timed[New].device = scheduler.Add(&Fire, &timed[New]);
+		return New;
+	}
+
+	void InterruptController::Schedule(Source source, std::uint64_t at, u32 period) {
+		assert(source < sources);
+		timed[source].at = at;
+		timed[source].period = period;
+		scheduler.Reschedule(timed[source].device, at);
+	}
+
+	void InterruptController::Cancel(Source source) {
+		assert(source < sources);
+		timed[source].at = Scheduler::NEVER;
+		scheduler.Reschedule(timed[source].device, Scheduler::NEVER);
+	}
+
+	std::uint64_t InterruptController::Fire(void *timed, std::uint64_t now) {
+		Timed &t = *static_cast<Timed *>(timed);
+		if (t.at > now) {
+			return t.at; // brought up to date early, not due yet
+		}
+		t.controller->Raise(t.source);
+		// from the cycle it was due, a stretch may have run past it
+		t.at = t.period != 0 ? t.at + t.period : Scheduler::NEVER;
+		return t.at;
+	}
+
+	void InterruptController::Raise(Source source) {
+		assert(source < sources);
+		if ((nmiSources >> source) & 1) {
+			nmiPending = true;
+		} else {
+			irqRaised |= 1u << source;
+		}
+		scheduler.EndStretch();
+	}
+
+	void InterruptController::Release(Source source) {
+		irqRaised &= ~(1u << source);
+	}
+
+	template <typename Memory>
+	ExecResult InterruptController::RunOn(CPU &cpu, s32 cycles, Memory &memory) {
+		ExecResult result{StopReason::Cycles, 0, 0, 0};
+		while (result.cyclesUsed < cycles) {
+			scheduler.RunDue();
+			if (nmiPending || (irqRaised != 0 && !cpu.Flag.interruptDisable)) {
+				const bool Nmi = nmiPending;
+				s32 busCycles = 0;
+				cpu.EnterInterrupt(Nmi ? CPU::NMI_VECTOR : CPU::IRQ_VECTOR, false, busCycles, memory);
+				scheduler.Elapse(INTERRUPT_CYCLES);
+				if (Nmi) {
+					nmiPending = false;
+					nmisTaken++;
+				} else {
+					irqsTaken++;
+				}
+				result.cyclesUsed += INTERRUPT_CYCLES;
+				continue;
+			}
+			// nothing to look at before the next event, unless CLI or RTI unmask the line
+			cpu.irqLine = irqRaised != 0;
+			s32 stretch = cycles - result.cyclesUsed;
+			if (scheduler.NextEvent() - scheduler.Now() < static_cast<std::uint64_t>(stretch)) {
+				stretch = static_cast<s32>(scheduler.NextEvent() - scheduler.Now());
+			}
+			scheduler.BeginStretch(stretch, BusOf(memory));
+			const ExecResult Run = cpu.Execute(stretch, memory);
+			stretches++;
+			result.cyclesUsed += scheduler.FinishStretch(Run.cyclesUsed);
+			result.instructions += Run.instructions;
+			if (Run.reason != StopReason::Cycles && Run.reason != StopReason::Interrupt) {
+				result.reason = Run.reason;
+				result.address = Run.address;
+				break;
+			}
+		}
+		// plain CPU::Execute calls see no IRQ line
+		cpu.irqLine = false;
+		return result;
+	}
+
+	ExecResult InterruptController::Run(CPU &cpu, s32 cycles, Mem &memory) {
+		return RunOn(cpu, cycles, memory);
+	}
+
+	ExecResult InterruptController::Run(CPU &cpu, s32 cycles, Bus &memory) {
+		return RunOn(cpu, cycles, memory);
+	}
+}
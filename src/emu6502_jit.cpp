@@ -0,0 +1,532 @@
+#include <emu6502_jit.h>
+#include <emu6502_opcodes.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define MY6502_JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define MY6502_JIT_X86_64 0
+#endif
+
+namespace my6502 {
+
+namespace {
+
+	using AddrMode  = CPU::AddrMode;
+	using PageCross = CPU::PageCross;
+
+	/** the bits of processorStatus written by LoadRegisterSetStatus **/
+	struct FlagMasks {
+		Byte zero;
+		Byte negative;
+		Byte nzFlags[256]; // zero and negative flags for every loaded value
+	};
+
+	const FlagMasks &Masks() {
+		static const FlagMasks masks = [] {
+			FlagMasks m{};
+			CPU probe{};
+			probe.processorStatus = 0;
+			probe.Flag.zeroFlag = 1;
+			m.zero = probe.processorStatus;
+			probe.processorStatus = 0;
+			probe.Flag.negativeFlag = 1;
+			m.negative = probe.processorStatus;
+			for (u32 value = 0; value < 256; value++) {
+				m.nzFlags[value] = (value == 0 ? m.zero : 0) | ((value & 0x80) ? m.negative : 0);
+			}
+			return m;
+		}();
+		return masks;
+	}
+
+	/** the address SPToAddress maps stack pointer 0 to **/
+	Word StackBase() {
+		CPU probe{};
+		probe.stackPointer = 0;
+		return probe.SPToAddress();
+	}
+
+	/** Encodes the handful of x86-64 instructions the translator needs.
+	 *  Native blocks are called as s32 (CPU *rdi, Mem *rsi, s32 edx):
+	 *  edx holds the cycles left, ecx the effective address, eax the
+	 *  value moved, r8 is scratch and r11 points at the N/Z flag table. **/
+	struct Emitter {
+		std::vector<Byte> code;
+
+		void Emit(std::initializer_list<Byte> bytes) {
+			code.insert(code.end(), bytes);
+		}
+		void Imm16(Word value) {
+			Emit({static_cast<Byte>(value), static_cast<Byte>(value >> 8)});
+		}
+		void Imm32(u32 value) {
+			for (int shift = 0; shift < 32; shift += 8) {
+				code.push_back(static_cast<Byte>(value >> shift));
+			}
+		}
+		void Imm64(std::uint64_t value) {
+			for (int shift = 0; shift < 64; shift += 8) {
+				code.push_back(static_cast<Byte>(value >> shift));
+			}
+		}
+
+		/* movzx ecx, byte [rdi+disp8] */
+		void LoadCPUByteToECX(Byte disp) { Emit({0x0F, 0xB6, 0x4F, disp}); }
+		/* movzx eax, byte [rdi+disp8] */
+		void LoadCPUByteToEAX(Byte disp) { Emit({0x0F, 0xB6, 0x47, disp}); }
+		/* mov [rdi+disp8], al */
+		void StoreALToCPU(Byte disp) { Emit({0x88, 0x47, disp}); }
+		/* mov word [rdi+disp8], imm16 */
+		void StoreWordToCPU(Byte disp, Word value) { Emit({0x66, 0xC7, 0x47, disp}); Imm16(value); }
+		/* mov ecx, imm32 */
+		void MoveToECX(u32 value) { Emit({0xB9}); Imm32(value); }
+		/* movzx eax, byte [rsi+rcx] */
+		void LoadMemoryToEAX() { Emit({0x0F, 0xB6, 0x04, 0x0E}); }
+		/* eax = word at [rsi+rcx+disp] (little endian), clobbers r8 */
+		void LoadMemoryWordToEAX(Byte disp) {
+			if (disp == 0) {
+				LoadMemoryToEAX();
+			} else {
+				Emit({0x0F, 0xB6, 0x44, 0x0E, disp});             // movzx eax, byte [rsi+rcx+disp]
+			}
+			Emit({0x44, 0x0F, 0xB6, 0x44, 0x0E, static_cast<Byte>(disp + 1)}); // movzx r8d, byte [rsi+rcx+disp+1]
+			Emit({0x41, 0xC1, 0xE0, 0x08});                     // shl r8d, 8
+			Emit({0x44, 0x09, 0xC0});                           // or eax, r8d
+		}
+		/* edx -= imm8 */
+		void SubCycles(Byte cycles) { Emit({0x83, 0xEA, cycles}); }
+		/* edx -= (((ecx ^ base) & 0xFF00) != 0), base in eax or an immediate, see CPU::PageCrossed */
+		void SubPageCrossPenalty(bool baseInEAX, u32 base) {
+			Emit({0x41, 0x89, 0xC8});                           // mov r8d, ecx
+			if (baseInEAX) {
+				Emit({0x41, 0x31, 0xC0});                         // xor r8d, eax
+			} else {
+				Emit({0x41, 0x81, 0xF0}); Imm32(base);            // xor r8d, imm32
+			}
+			Emit({0x41, 0xF7, 0xC0}); Imm32(0xFF00);            // test r8d, 0xFF00
+			Emit({0x41, 0x0F, 0x95, 0xC0});                     // setne r8b
+			Emit({0x45, 0x0F, 0xB6, 0xC0});                     // movzx r8d, r8b
+			Emit({0x44, 0x29, 0xC2});                           // sub edx, r8d
+		}
+		/* ++memory.pageVersion[ecx >> 8], ecx is always below 0x10000 */
+		void BumpPageVersion() {
+			Emit({0x41, 0x89, 0xC8});                           // mov r8d, ecx
+			Emit({0x41, 0xC1, 0xE8, 0x08});                     // shr r8d, 8
+			Emit({0x42, 0x83, 0x84, 0x86});                     // add dword [rsi+r8*4+disp32], 1
+			Imm32(offsetof(Mem, pageVersion));
+			Emit({0x01});
+		}
+		/* set programCounter and return the cycles left */
+		void Exit(Byte pcDisp, Word pc) {
+			StoreWordToCPU(pcDisp, pc);
+			Return();
+		}
+		void Return() {
+			Emit({0x89, 0xD0});                                 // mov eax, edx
+			Emit({0xC3});                                       // ret
+		}
+		/* leave with programCounter = pc if the page version moved */
+		void ExitIfPageWritten(Byte page, u32 version, Byte pcDisp, Word pc) {
+			Emit({0x81, 0xBE});                                 // cmp dword [rsi+disp32], imm32
+			Imm32(static_cast<u32>(offsetof(Mem, pageVersion) + page * sizeof(u32)));
+			Imm32(version);
+			Emit({0x74, 0x09});                                 // je over the exit
+			Exit(pcDisp, pc);
+		}
+	};
+
+	constexpr Byte PC_DISP = offsetof(CPU, programCounter);
+	constexpr Byte SP_DISP = offsetof(CPU, stackPointer);
+	constexpr Byte A_DISP  = offsetof(CPU, accumulator);
+	constexpr Byte X_DISP  = offsetof(CPU, indexRegX);
+	constexpr Byte Y_DISP  = offsetof(CPU, indexRegY);
+	constexpr Byte P_DISP  = offsetof(CPU, processorStatus);
+	static_assert(P_DISP < 0x80, "CPU registers must be reachable with an 8 bit displacement");
+
+	enum class Operation { None, LoadRegister, StoreRegister, JumpToSubroutine, ReturnFromSubroutine };
+
+	struct Translation {
+		Operation operation;
+		Byte registerDisp;
+	};
+
+	/** what an opcode does by its mnemonic in the opcode table, None for
+	 *  the opcodes the translator does not know and those CPU::Execute
+	 *  has no handler for **/
+	Translation Translate(Byte Ins) {
+		if (CPU::Decode(Ins).cycles == 0) {
+			return {Operation::None, 0};
+		}
+		switch (OpcodeInfoTable[Ins].mnemonic) {
+		case Mnemonic::LDA:
+			return {Operation::LoadRegister, A_DISP};
+		case Mnemonic::LDX:
+			return {Operation::LoadRegister, X_DISP};
+		case Mnemonic::LDY:
+			return {Operation::LoadRegister, Y_DISP};
+		case Mnemonic::STA:
+			return {Operation::StoreRegister, A_DISP};
+		case Mnemonic::STX:
+			return {Operation::StoreRegister, X_DISP};
+		case Mnemonic::STY:
+			return {Operation::StoreRegister, Y_DISP};
+		case Mnemonic::JSR:
+			return {Operation::JumpToSubroutine, 0};
+		case Mnemonic::RTS:
+			return {Operation::ReturnFromSubroutine, 0};
+		default:
+			return {Operation::None, 0};
+		}
+	}
+
+	/** effective address of the operand into ecx, charges page crossing **/
+	void EmitEffectiveAddress(Emitter &e, const DecodedIns &ins, const CPU::Opcode &op) {
+		const bool penalty = op.pageCross == PageCross::OnCross;
+		switch (op.mode) {
+		case AddrMode::ZeroPage:
+		case AddrMode::Absolute:
+			e.MoveToECX(ins.operand);
+			break;
+		case AddrMode::ZeroPageX:
+		case AddrMode::ZeroPageY:
+			e.LoadCPUByteToECX(op.mode == AddrMode::ZeroPageX ? X_DISP : Y_DISP);
+			e.Emit({0x80, 0xC1, static_cast<Byte>(ins.operand)}); // add cl, imm8
+			e.Emit({0x0F, 0xB6, 0xC9});                          // movzx ecx, cl
+			break;
+		case AddrMode::AbsoluteX:
+		case AddrMode::AbsoluteY:
+			e.LoadCPUByteToECX(op.mode == AddrMode::AbsoluteX ? X_DISP : Y_DISP);
+			e.Emit({0x81, 0xC1}); e.Imm32(ins.operand);          // add ecx, imm32
+			e.Emit({0x0F, 0xB7, 0xC9});                          // movzx ecx, cx
+			if (penalty) {
+				e.SubPageCrossPenalty(false, ins.operand);
+			}
+			break;
+		case AddrMode::IndirectX:
+			e.LoadCPUByteToECX(X_DISP);
+			e.Emit({0x80, 0xC1, static_cast<Byte>(ins.operand)}); // add cl, imm8
+			e.Emit({0x0F, 0xB6, 0xC9});                          // movzx ecx, cl
+			e.LoadMemoryWordToEAX(0);
+			e.Emit({0x89, 0xC1});                                // mov ecx, eax
+			break;
+		case AddrMode::IndirectY:
+			e.MoveToECX(ins.operand);
+			e.LoadMemoryWordToEAX(0);
+			e.LoadCPUByteToECX(Y_DISP);
+			e.Emit({0x01, 0xC1});                                // add ecx, eax
+			e.Emit({0x0F, 0xB7, 0xC9});                          // movzx ecx, cx
+			if (penalty) {
+				e.SubPageCrossPenalty(true, 0);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	/** processorStatus = (processorStatus & ~(Z|N)) | flags of eax or of a known value **/
+	void EmitLoadRegisterSetStatus(Emitter &e, bool known, Byte value) {
+		const FlagMasks &masks = Masks();
+		e.LoadCPUByteToECX(P_DISP);
+		e.Emit({0x81, 0xE1}); e.Imm32(static_cast<Byte>(~(masks.zero | masks.negative))); // and ecx, imm32
+		if (known) {
+			if (masks.nzFlags[value] != 0) {
+				e.Emit({0x81, 0xC9}); e.Imm32(masks.nzFlags[value]); // or ecx, imm32
+			}
+		} else {
+			e.Emit({0x41, 0x0A, 0x0C, 0x03});                       // or cl, [r11+rax]
+		}
+		e.Emit({0x88, 0x4F, P_DISP});                             // mov [rdi+disp8], cl
+	}
+}
+
+	Jit::Jit() : entries(Mem::MAX_MEM) {
+		// a call to a leaf routine is translated into the block of its JSR
+		Superinstructions leafCalls;
+		leafCalls.leafCalls = true;
+		cache.Fuse(leafCalls);
+#if MY6502_JIT_X86_64
+		void *region = mmap(nullptr, CODE_CACHE_SIZE, PROT_READ | PROT_WRITE,
+		                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (region != MAP_FAILED) {
+			codeCache = static_cast<Byte *>(region);
+			if (mprotect(codeCache, CODE_CACHE_SIZE, PROT_READ | PROT_EXEC) != 0) {
+				DropCodeCache();
+			}
+		}
+#endif
+	}
+
+	Jit::~Jit() {
+		DropCodeCache();
+	}
+
+	void Jit::DropCodeCache() {
+#if MY6502_JIT_X86_64
+		if (codeCache != nullptr) {
+			munmap(codeCache, CODE_CACHE_SIZE);
+		}
+#endif
+		codeCache = nullptr;
+		writableBegin = writableEnd = 0;
+	}
+
+	bool Jit::Seal() {
+		if (writableBegin == writableEnd) {
+			return true;
+		}
+		bool sealed = true;
+#if MY6502_JIT_X86_64
+		sealed = mprotect(codeCache + writableBegin, writableEnd - writableBegin, PROT_READ | PROT_EXEC) == 0;
+#endif
+		writableBegin = writableEnd = 0;
+		if (!sealed) {
+			// the pages stay writable, none of their code may run
+			FlushCode();
+			DropCodeCache();
+		}
+		return sealed;
+	}
+
+	bool Jit::IsSupported() {
+		return MY6502_JIT_X86_64;
+	}
+
+	void Jit::Clear() {
+		FlushCode();
+		cache.Clear();
+	}
+
+	void Jit::FlushCode() {
+		Seal(); // Compile starts over at the front of the code cache
+		for (Entry &entry : entries) {
+			entry = Entry{};
+		}
+		codeUsed = 0;
+	}
+
+	Jit::Entry Jit::NewEntry(const BlockCache::Block &block, NativeBlock code) {
+		Entry entry{};
+		entry.code = code;
+		entry.maxLeadCycles = block.maxLeadCycles;
+		entry.firstPage = block.firstPage;
+		entry.lastPage = block.lastPage;
+		entry.firstPageVersion = block.firstPageVersion;
+		entry.lastPageVersion = block.lastPageVersion;
+		return entry;
+	}
+
+	s32 Jit::Execute(CPU &cpu, s32 cycles, Mem &memory) {
+		if (cachedMemory != &memory) {
+			Clear();
+			cachedMemory = &memory;
+		}
+		const s32 cyclesRequested = cycles;
+		while (cycles > 0) {
+			const Word address = cpu.programCounter;
+			Entry &entry = entries[address];
+			// hot path: native code whose pages are unchanged runs without the cache
+			if (entry.code != nullptr && entry.maxLeadCycles < cycles && !differential
+			    && memory.pageVersion[entry.firstPage] == entry.firstPageVersion
+			    && memory.pageVersion[entry.lastPage] == entry.lastPageVersion && Seal()) {
+				nativeBlocksRun++;
+				cycles = entry.code(&cpu, &memory, cycles);
+				continue;
+			}
+			const BlockCache::Block *block = cache.Lookup(address, memory);
+			// same rule as BlockCache: the interpreter must not stop inside the block
+			if (block == nullptr || block->maxLeadCycles >= cycles) {
+				const ExecResult step = cpu.Execute(1, memory);
+				cycles -= step.cyclesUsed;
+				if (step.reason != StopReason::Cycles) {
+					break; // in front of an opcode without a handler
+				}
+				continue;
+			}
+			// the cache decodes the block again once its code is written,
+			// the entry is only current while it matches that decode
+			if (entry.firstPage != block->firstPage || entry.lastPage != block->lastPage
+			    || entry.firstPageVersion != block->firstPageVersion
+			    || entry.lastPageVersion != block->lastPageVersion) {
+				const u32 recompiles = entry.code != nullptr ? entry.recompiles + 1 : entry.recompiles;
+				entry = NewEntry(*block, nullptr);
+				entry.recompiles = recompiles;
+				// code that keeps being written is cheaper to interpret
+				entry.untranslatable = recompiles > MAX_RECOMPILES;
+			}
+			if (entry.code == nullptr && !entry.untranslatable && ++entry.runs >= HOT_THRESHOLD) {
+				const u32 recompiles = entry.recompiles;
+				NativeBlock code = Compile(*block); // may flush every entry
+				entry = NewEntry(*block, code);
+				entry.recompiles = recompiles;
+				entry.untranslatable = (code == nullptr);
+				// its first run stays on the cache, so blocks turning hot
+				// one after the other are written without sealing the
+				// code cache in between
+				cycles = BlockCache::RunBlock(*block, cpu, cycles, memory);
+				continue;
+			}
+			if (entry.code == nullptr || !Seal()) {
+				cycles = BlockCache::RunBlock(*block, cpu, cycles, memory);
+				continue;
+			}
+			nativeBlocksRun++;
+			if (differential) {
+				cycles = RunDifferential(entry.code, address, cpu, cycles, memory);
+			} else {
+				cycles = entry.code(&cpu, &memory, cycles);
+			}
+		}
+		return cyclesRequested - cycles;
+	}
+
+	s32 Jit::RunDifferential(NativeBlock code, Word address, CPU &cpu, s32 cycles, Mem &memory) {
+		if (!referenceMemory) {
+			referenceMemory = std::make_unique<Mem>();
+		}
+		CPU reference = cpu;
+		*referenceMemory = memory;
+
+		const s32 cyclesLeft = code(&cpu, &memory, cycles);
+		const s32 nativeCycles = cycles - cyclesLeft;
+		// the interpreter runs exactly the same instructions for the same budget
+		const s32 referenceCycles = reference.Execute(nativeCycles, *referenceMemory).cyclesUsed;
+
+		const bool same = referenceCycles == nativeCycles
+			&& cpu.programCounter == reference.programCounter
+			&& cpu.stackPointer == reference.stackPointer
+			&& cpu.accumulator == reference.accumulator
+			&& cpu.indexRegX == reference.indexRegX
+			&& cpu.indexRegY == reference.indexRegY
+			&& cpu.processorStatus == reference.processorStatus;
+		if (same) {
+			return cyclesLeft;
+		}
+		if (mismatches++ == 0) {
+			firstMismatchPC = address;
+		}
+		cpu = reference;
+		memory = *referenceMemory;
+		entries[address].code = nullptr;
+		entries[address].untranslatable = true;
+		return cycles - referenceCycles;
+	}
+
+	Jit::NativeBlock Jit::Compile(const BlockCache::Block &block) {
+#if MY6502_JIT_X86_64
+		if (codeCache == nullptr) {
+			return nullptr;
+		}
+		Emitter e;
+		e.Emit({0x49, 0xBB});                                       // mov r11, imm64
+		e.Imm64(reinterpret_cast<std::uintptr_t>(Masks().nzFlags));
+		bool exited = false;
+		const DecodedIns *call = nullptr; // the fused JSR whose routine is being translated
+		for (const DecodedIns &ins : block.instructions) {
+			const CPU::Opcode &op = CPU::Decode(ins.opcode);
+			const Translation t = Translate(ins.opcode);
+			e.SubCycles(ins.cycles);
+			switch (t.operation) {
+			case Operation::LoadRegister:
+				if (op.mode == AddrMode::Immediate) {
+					e.Emit({0xC6, 0x47, t.registerDisp, static_cast<Byte>(ins.operand)}); // mov byte [rdi+disp8], imm8
+					EmitLoadRegisterSetStatus(e, true, static_cast<Byte>(ins.operand));
+				} else {
+					EmitEffectiveAddress(e, ins, op);
+					e.LoadMemoryToEAX();
+					e.StoreALToCPU(t.registerDisp);
+					EmitLoadRegisterSetStatus(e, false, 0);
+				}
+				break;
+			case Operation::StoreRegister:
+				EmitEffectiveAddress(e, ins, op);
+				e.LoadCPUByteToEAX(t.registerDisp);
+				e.Emit({0x88, 0x04, 0x0E});                             // mov [rsi+rcx], al
+				e.BumpPageVersion();
+				// the block may have written over its own code
+				e.ExitIfPageWritten(block.firstPage, block.firstPageVersion, PC_DISP, ins.nextPC);
+				if (block.lastPage != block.firstPage) {
+					e.ExitIfPageWritten(block.lastPage, block.lastPageVersion, PC_DISP, ins.nextPC);
+				}
+				// or over the leaf routine it is running, which ends the call there
+				if (call != nullptr) {
+					e.ExitIfPageWritten(static_cast<Byte>(call->operand >> 8), call->codeVersion, PC_DISP, ins.nextPC);
+				}
+				break;
+			case Operation::JumpToSubroutine: {
+				const Word returnAddress = ins.nextPC - 1;
+				e.LoadCPUByteToECX(SP_DISP);
+				e.Emit({0x81, 0xC9}); e.Imm32(StackBase());               // or ecx, imm32
+				e.Emit({0x83, 0xE9, 0x01});                               // sub ecx, 1
+				e.Emit({0xC6, 0x04, 0x0E, static_cast<Byte>(returnAddress)});      // mov byte [rsi+rcx], imm8
+				e.BumpPageVersion();
+				e.Emit({0x83, 0xC1, 0x01});                               // add ecx, 1
+				e.Emit({0xC6, 0x04, 0x0E, static_cast<Byte>(returnAddress >> 8)}); // mov byte [rsi+rcx], imm8
+				e.BumpPageVersion();
+				e.Emit({0x80, 0x6F, SP_DISP, 0x02});                      // sub byte [rdi+disp8], 2
+				if (ins.length == 1) {
+					e.Exit(PC_DISP, ins.operand);
+					exited = true;
+					break;
+				}
+				// a fused leaf call runs on into its routine while the
+				// routine's page is unchanged, as CallLeaf does
+				e.ExitIfPageWritten(static_cast<Byte>(ins.operand >> 8), ins.codeVersion, PC_DISP, ins.operand);
+				call = &ins;
+			} break;
+			case Operation::ReturnFromSubroutine:
+				e.LoadCPUByteToECX(SP_DISP);
+				e.Emit({0x81, 0xC9}); e.Imm32(StackBase());               // or ecx, imm32
+				e.LoadMemoryWordToEAX(1);
+				e.Emit({0x83, 0xC0, 0x01});                               // add eax, 1
+				e.Emit({0x66, 0x89, 0x47, PC_DISP});                      // mov [rdi+disp8], ax
+				e.Emit({0x80, 0x47, SP_DISP, 0x02});                      // add byte [rdi+disp8], 2
+				e.Return();
+				exited = true;
+				break;
+			case Operation::None:
+				return nullptr;
+			}
+		}
+		if (!exited) {
+			e.Exit(PC_DISP, block.instructions.back().nextPC);
+		}
+
+		if (codeUsed + e.code.size() > CODE_CACHE_SIZE) {
+			FlushCode(); // code cache is full, start over
+		}
+		Byte *code = codeCache + codeUsed;
+		// only the host pages the block lands on are made writable, they
+		// stay so for the next blocks compiled until Seal, code of other
+		// blocks on them can not run in between
+		const u32 hostPage = static_cast<u32>(sysconf(_SC_PAGESIZE));
+		const u32 first = writableBegin != writableEnd ? writableEnd : codeUsed & ~(hostPage - 1);
+		const u32 end = (codeUsed + static_cast<u32>(e.code.size()) + hostPage - 1) & ~(hostPage - 1);
+		if (first < end) {
+			if (mprotect(codeCache + first, end - first, PROT_READ | PROT_WRITE) != 0) {
+				FlushCode();
+				DropCodeCache();
+				return nullptr;
+			}
+			if (writableBegin == writableEnd) {
+				writableBegin = first;
+			}
+			writableEnd = end;
+		}
+		std::memcpy(code, e.code.data(), e.code.size());
+		codeUsed += static_cast<u32>(e.code.size());
+		blocksCompiled++;
+		return reinterpret_cast<NativeBlock>(code);
+#else
+		(void)block;
+		return nullptr;
+#endif
+	}
+}
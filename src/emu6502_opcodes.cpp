@@ -0,0 +1,74 @@
+#include <emu6502_opcodes.h>
+#include <stdio.h>
+
+namespace my6502 {
+
+	const char *MnemonicName(Mnemonic mnemonic) {
+		static const char *const Names[] = {
+			"ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT", "BMI", "BNE", "BPL", "BRK", "BVC", "BVS", "CLC",
+			"CLD", "CLI", "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY", "EOR", "INC", "INX", "INY", "JMP",
+			"JSR", "LDA", "LDX", "LDY", "LSR", "NOP", "ORA", "PHA", "PHP", "PLA", "PLP", "ROL", "ROR", "RTI",
+			"RTS", "SBC", "SEC", "SED", "SEI", "STA", "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS", "TYA",
+			"???"};
+		static_assert(sizeof(Names) / sizeof(Names[0]) == static_cast<u32>(Mnemonic::Invalid) + 1,
+		              "a name for every mnemonic");
+		return Names[static_cast<Byte>(mnemonic)];
+	}
+
+	std::string Disassemble(Word address, const Byte *bytes) {
+		using AddrMode = CPU::AddrMode;
+		const OpcodeInfo &info = OpcodeInfoTable[bytes[0]];
+		const Byte Lo = bytes[1];
+		const Word Operand = static_cast<Word>(bytes[1] | (bytes[2] << 8));
+		char text[32];
+		if (!info.Valid()) {
+			snprintf(text, sizeof(text), ".byte $%02X", bytes[0]);
+			return text;
+		}
+		const char *name = MnemonicName(info.mnemonic);
+		switch (info.mode) {
+		case AddrMode::Implied:
+			snprintf(text, sizeof(text), "%s", name);
+			break;
+		case AddrMode::Accumulator:
+			snprintf(text, sizeof(text), "%s A", name);
+			break;
+		case AddrMode::Immediate:
+			snprintf(text, sizeof(text), "%s #$%02X", name, Lo);
+			break;
+		case AddrMode::ZeroPage:
+			snprintf(text, sizeof(text), "%s $%02X", name, Lo);
+			break;
+		case AddrMode::ZeroPageX:
+			snprintf(text, sizeof(text), "%s $%02X,X", name, Lo);
+			break;
+		case AddrMode::ZeroPageY:
+			snprintf(text, sizeof(text), "%s $%02X,Y", name, Lo);
+			break;
+		case AddrMode::Absolute:
+			snprintf(text, sizeof(text), "%s $%04X", name, Operand);
+			break;
+		case AddrMode::AbsoluteX:
+			snprintf(text, sizeof(text), "%s $%04X,X", name, Operand);
+			break;
+		case AddrMode::AbsoluteY:
+			snprintf(text, sizeof(text), "%s $%04X,Y", name, Operand);
+			break;
+		case AddrMode::IndirectX:
+			snprintf(text, sizeof(text), "%s ($%02X,X)", name, Lo);
+			break;
+		case AddrMode::IndirectY:
+			snprintf(text, sizeof(text), "%s ($%02X),Y", name, Lo);
+			break;
+		case AddrMode::Indirect:
+			snprintf(text, sizeof(text), "%s ($%04X)", name, Operand);
+			break;
+		case AddrMode::Relative:
+			snprintf(text, sizeof(text), "%s $%04X", name,
+			         static_cast<Word>(address + info.bytes + static_cast<signed char>(Lo)));
+			break;
+		}
+		return text;
+	}
+
+}
@@ -0,0 +1,111 @@
+#include <emu6502_paged.h>
+#include <cstring>
+
+namespace my6502 {
+
+	// every memory starts on the zero table, one per thread and never freed
+	PagedMem::Table *PagedMem::Zeroed() {
+		static thread_local Block zeroPage{NUM_PAGES + 1, {}};
+		static thread_local Table zeroTable = [] {
+			Table zeroed{1, {}};
+			for (Block *&page : zeroed.pages) {
+				page = &zeroPage;
+			}
+			return zeroed;
+		}();
+		zeroTable.refs++;
+		return &zeroTable;
+	}
+
+	void PagedMem::Release(Table *table) {
+		if (--table->refs != 0) {
+			return;
+		}
+		for (Block *page : table->pages) {
+			if (--page->refs == 0) {
+				delete page;
+			}
+		}
+		delete table;
+	}
+
+	PagedMem::PagedMem() : table(Zeroed()) {
+	}
+
+	PagedMem::PagedMem(const Mem &memory) : table(new Table) {
+		table->refs = 1;
+		for (u32 page = 0; page < NUM_PAGES; page++) {
+			Block *copy = new Block;
+			copy->refs = 1;
+			std::memcpy(copy->data, memory.Data + page * PAGE_SIZE, PAGE_SIZE);
+			table->pages[page] = copy;
+		}
+	}
+
+	PagedMem::PagedMem(const PagedMem &other) : table(other.table) {
+		table->refs++;
+	}
+
+	PagedMem::PagedMem(PagedMem &&other) noexcept : table(other.table) {
+		other.table = Zeroed();
+	}
+
+	PagedMem &PagedMem::operator=(const PagedMem &other) {
+		other.table->refs++;
+		Release(table);
+		table = other.table;
+		return *this;
+	}
+
+	PagedMem &PagedMem::operator=(PagedMem &&other) noexcept {
+		if (this != &other) {
+			Release(table);
+			table = other.table;
+			other.table = Zeroed();
+		}
+		return *this;
+	}
+
+	PagedMem::~PagedMem() {
+		Release(table);
+	}
+
+	void PagedMem::Initialize() {
+		Release(table);
+		table = Zeroed();
+	}
+
+	PagedMem::Block *PagedMem::Unshare(u32 page) {
+		// while shared neither the table nor its pages change, so
+		// copying them needs no more than the references
+		if (table->refs != 1) {
+			Table *copy = new Table;
+			copy->refs = 1;
+			for (u32 i = 0; i < NUM_PAGES; i++) {
+				copy->pages[i] = table->pages[i];
+				copy->pages[i]->refs++;
+			}
+			Release(table);
+			table = copy;
+		}
+		Block *&shared = table->pages[page];
+		if (shared->refs != 1) {
+			Block *copy = new Block;
+			copy->refs = 1;
+			std::memcpy(copy->data, shared->data, PAGE_SIZE);
+			if (--shared->refs == 0) {
+				delete shared;
+			}
+			shared = copy;
+		}
+		return shared;
+	}
+
+	void PagedMem::CopyTo(Mem &memory) const {
+		for (u32 page = 0; page < NUM_PAGES; page++) {
+			std::memcpy(memory.Data + page * PAGE_SIZE, table->pages[page]->data, PAGE_SIZE);
+			memory.pageVersion[page]++;
+		}
+	}
+
+}
@@ -0,0 +1,45 @@
+#include <emu6502_profile.h>
+#include <algorithm>
+#include <numeric>
+
+namespace my6502 {
+
+	Profile::Profile()
+		: opcodes(256), addresses(Mem::MAX_MEM), pageCrosses(256),
+		  pageReads(Mem::NUM_PAGES), pageWrites(Mem::NUM_PAGES) {}
+
+	void Profile::Clear() {
+		for (std::vector<Counter> *counters : {&opcodes, &addresses, &pageCrosses, &pageReads, &pageWrites}) {
+			std::fill(counters->begin(), counters->end(), 0);
+		}
+	}
+
+	Profile::Counter Profile::Instructions() const {
+		return std::accumulate(opcodes.begin(), opcodes.end(), Counter{0});
+	}
+
+	std::vector<std::pair<Word, Profile::Counter>> Profile::Hottest(u32 count) const {
+		std::vector<std::pair<Word, Counter>> hot;
+		for (u32 address = 0; address < Mem::MAX_MEM; address++) {
+			if (addresses[address] != 0) {
+				hot.emplace_back(static_cast<Word>(address), addresses[address]);
+			}
+		}
+		const auto MoreFrequent = [](const std::pair<Word, Counter> &a, const std::pair<Word, Counter> &b) {
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		};
+		const std::size_t kept = std::min<std::size_t>(count, hot.size());
+		std::partial_sort(hot.begin(), hot.begin() + kept, hot.end(), MoreFrequent);
+		hot.resize(kept);
+		return hot;
+	}
+
+	SequenceProfile::SequenceProfile() : pairs(256 * 256) {}
+
+	void SequenceProfile::Clear() {
+		std::fill(pairs.begin(), pairs.end(), 0);
+		leafCalls = 0;
+		instructions = 0;
+		sinceCall = MAX_LEAF_INSTRUCTIONS;
+	}
+}
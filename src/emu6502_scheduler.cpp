@@ -0,0 +1,242 @@
+#include <emu6502_scheduler.h>
+#include <algorithm>
+#include <cassert>
+
+namespace my6502 {
+
+namespace {
+
+	/** index of the lowest set bit, bits is not 0 **/
+	u32 LowestBit(std::uint64_t bits) {
+#if defined(__GNUC__)
+		return static_cast<u32>(__builtin_ctzll(bits));
+#else
+		u32 bit = 0;
+		while ((bits & 1) == 0) {
+			bits >>= 1;
+			bit++;
+		}
+		return bit;
+#endif
+	}
+}
+
+	Scheduler::Scheduler() {
+		for (u32 slot = 0; slot < SLOTS; slot++) {
+			slots[slot] = NONE;
+		}
+		for (u32 word = 0; word < WORDS; word++) {
+			inUse[word] = 0;
+		}
+	}
+
+	Scheduler::Device Scheduler::Add(CatchUpFn catchUp, void *device, std::uint64_t firstEvent) {
+		assert(catchUp != nullptr);
+		const Device Id = static_cast<Device>(clients.size());
+		clients.push_back(std::make_unique<Client>(Client{this, Id, catchUp, device, nullptr, nullptr, NEVER, NONE, false}));
+		Reschedule(Id, firstEvent);
+		return Id;
+	}
+
+	Scheduler::Device Scheduler::Map(Bus &bus, Byte first, Byte last, Bus::ReadFn read, Bus::WriteFn write,
+	                                 CatchUpFn catchUp, void *device, std::uint64_t firstEvent) {
+		assert(read != nullptr);
+		const Device Id = Add(catchUp, device, firstEvent);
+		Client &client = *clients[Id];
+		client.read = read;
+		client.write = write;
+		bus.MapDevice(first, last, &ReadThrough, &WriteThrough, &client);
+		return Id;
+	}
+
+	Byte Scheduler::ReadThrough(void *client, Word address) {
+		Client &c = *static_cast<Client *>(client);
+		c.scheduler->Sync(c.id);
+		return c.read(c.device, address);
+	}
+
+	void Scheduler::WriteThrough(void *client, Word address, Byte value) {
+		Client &c = *static_cast<Client *>(client);
+		c.scheduler->Sync(c.id);
+		if (c.write != nullptr) {
+			c.write(c.device, address, value);
+			// the write may have started or stopped a timer
+			c.scheduler->Sync(c.id);
+		}
+	}
+
+	void Scheduler::Sync(Device device) {
+		Client &client = *clients[device];
+		const std::uint64_t Now = this->Now();
+		catchUps++;
+		const std::uint64_t Next = client.catchUp(client.device, Now);
+		Reschedule(device, Next <= Now ? Now + 1 : Next);
+	}
+
+	void Scheduler::Reschedule(Device device, std::uint64_t at) {
+		Client &client = *clients[device];
+		Remove(client);
+		client.at = at;
+		Insert(client);
+		if (at < stretchEnd) {
+			CutStretch(at);
+		}
+	}
+
+	void Scheduler::EndStretch() {
+		CutStretch(Now());
+	}
+
+	void Scheduler::CutStretch(std::uint64_t at) {
+		// without a bus nothing can reschedule in the middle of a stretch
+		if (!running || bus == nullptr || bus->cyclesLeft == nullptr) {
+			return;
+		}
+		at = std::max(at, Now());
+		if (at >= stretchEnd) {
+			return;
+		}
+		const s32 Cut = static_cast<s32>(stretchEnd - at);
+		stretchEnd = at;
+		bus->budgetCut += Cut;
+		cut += Cut;
+	}
+
+	std::uint64_t Scheduler::Now() const {
+		if (running && bus != nullptr && bus->cyclesLeft != nullptr) {
+			return stretchEnd - static_cast<std::uint64_t>(*bus->cyclesLeft - bus->budgetCut);
+		}
+		return now;
+	}
+
+	std::uint64_t Scheduler::NextEvent() const {
+		const u32 Start = base & (SLOTS - 1);
+		// from the slot of base to the end of the wheel, then around to it
+		for (u32 n = 0; n <= WORDS; n++) {
+			const u32 word = ((Start >> 6) + n) % WORDS;
+			std::uint64_t bits = inUse[word];
+			if (n == 0) {
+				bits &= ~0ull << (Start & 63);
+			} else if (n == WORDS) {
+				bits &= ~(~0ull << (Start & 63));
+			}
+			if (bits != 0) {
+				const u32 Slot = word * 64 + LowestBit(bits);
+				return base + ((Slot - Start) & (SLOTS - 1));
+			}
+		}
+		return overflowMin;
+	}
+
+	void Scheduler::RunDue() {
+		const std::uint64_t Now = this->Now();
+		for (std::uint64_t at = NextEvent(); at <= Now; at = NextEvent()) {
+			base = at;
+			Refill();
+			const u32 Slot = at & (SLOTS - 1);
+			u32 id = slots[Slot];
+			slots[Slot] = NONE;
+			inUse[Slot >> 6] &= ~(1ull << (Slot & 63));
+			while (id != NONE) {
+				Client &client = *clients[id];
+				id = client.next;
+				client.onWheel = false;
+				client.at = NEVER;
+				catchUps++;
+				const std::uint64_t Next = client.catchUp(client.device, Now);
+				client.at = Next <= Now ? Now + 1 : Next;
+				Insert(client);
+			}
+		}
+		// nothing left before Now
+		base = Now;
+		Refill();
+	}
+
+	void Scheduler::BeginStretch(s32 budget, Bus *bus) {
+		stretchEnd = now + static_cast<std::uint64_t>(budget);
+		this->bus = bus;
+		cut = 0;
+		running = true;
+		if (bus != nullptr) {
+			bus->budgetCut = 0;
+		}
+	}
+
+	s32 Scheduler::FinishStretch(s32 cyclesUsed) {
+		// a cut the dispatch loop did not get to take off
+		if (bus != nullptr) {
+			cut -= bus->budgetCut;
+			bus->budgetCut = 0;
+		}
+		const s32 Ran = cyclesUsed - cut;
+		now += static_cast<std::uint64_t>(Ran);
+		stretchEnd = 0;
+		bus = nullptr;
+		cut = 0;
+		running = false;
+		return Ran;
+	}
+
+	void Scheduler::Insert(Client &client) {
+		if (client.at == NEVER) {
+			return;
+		}
+		client.at = std::max(client.at, base);
+		if (client.at - base < SLOTS) {
+			const u32 Slot = client.at & (SLOTS - 1);
+			client.next = slots[Slot];
+			slots[Slot] = client.id;
+			inUse[Slot >> 6] |= 1ull << (Slot & 63);
+			client.onWheel = true;
+		} else {
+			overflow.push_back(client.id);
+			overflowMin = std::min(overflowMin, client.at);
+		}
+	}
+
+	void Scheduler::Remove(Client &client) {
+		if (client.at == NEVER) {
+			return;
+		}
+		if (client.onWheel) {
+			const u32 Slot = client.at & (SLOTS - 1);
+			u32 *link = &slots[Slot];
+			while (*link != client.id) {
+				link = &clients[*link]->next;
+			}
+			*link = client.next;
+			if (slots[Slot] == NONE) {
+				inUse[Slot >> 6] &= ~(1ull << (Slot & 63));
+			}
+			client.onWheel = false;
+		} else {
+			overflow.erase(std::find(overflow.begin(), overflow.end(), client.id));
+			if (client.at == overflowMin) {
+				overflowMin = NEVER;
+				for (const u32 id : overflow) {
+					overflowMin = std::min(overflowMin, clients[id]->at);
+				}
+			}
+		}
+		client.at = NEVER;
+	}
+
+	void Scheduler::Refill() {
+		if (overflowMin >= base + SLOTS) {
+			return;
+		}
+		std::vector<u32> farther;
+		overflowMin = NEVER;
+		for (const u32 id : overflow) {
+			Client &client = *clients[id];
+			if (client.at < base + SLOTS) {
+				Insert(client);
+			} else {
+				farther.push_back(id);
+				overflowMin = std::min(overflowMin, client.at);
+			}
+		}
+		overflow.swap(farther);
+	}
+}
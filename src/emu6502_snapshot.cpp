@@ -0,0 +1,204 @@
+#include <emu6502_snapshot.h>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MY6502_SNAPSHOT_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MY6502_SNAPSHOT_POSIX 0
+#endif
+
+namespace my6502 {
+
+namespace {
+
+	/** offsets into the header, the page bitmap has bit p % 8 of byte
+	 *  p / 8 set when page p is stored **/
+	constexpr char MAGIC[8] = {'M', 'Y', '6', '5', '0', '2', 'S', 'N'};
+	constexpr u32 VERSION_AT = 8;
+	constexpr u32 STORED_PAGES_AT = 12;
+	constexpr u32 PC_AT = 16;
+	constexpr u32 SP_AT = 18;
+	constexpr u32 A_AT = 19;
+	constexpr u32 X_AT = 20;
+	constexpr u32 Y_AT = 21;
+	constexpr u32 P_AT = 22;
+	constexpr u32 BITMAP_AT = 32;
+
+	static_assert(BITMAP_AT + Mem::NUM_PAGES / 8 == Snapshot::HEADER_SIZE, "the bitmap ends the header");
+
+	void Put32(Byte *at, u32 value) {
+		at[0] = value & 0xFF;
+		at[1] = (value >> 8) & 0xFF;
+		at[2] = (value >> 16) & 0xFF;
+		at[3] = value >> 24;
+	}
+
+	u32 Get32(const Byte *at) {
+		return at[0] | (at[1] << 8) | (at[2] << 16) | (static_cast<u32>(at[3]) << 24);
+	}
+
+	bool IsZeroPage(const Byte *page) {
+		// or-ing whole words keeps the loop branch free, the compiler vectorizes it
+		std::uint64_t bits = 0;
+		for (u32 i = 0; i < Mem::PAGE_SIZE; i += sizeof(bits)) {
+			std::uint64_t word;
+			memcpy(&word, page + i, sizeof(word));
+			bits |= word;
+		}
+		return bits == 0;
+	}
+}
+
+	void Snapshot::Take(const CPU &cpu, const Mem &memory, std::vector<Byte> &out) {
+		out.resize(HEADER_SIZE + Mem::MAX_MEM);
+		Byte *header = out.data();
+		memset(header, 0, HEADER_SIZE);
+		memcpy(header, MAGIC, sizeof(MAGIC));
+		Put32(header + VERSION_AT, VERSION);
+		header[PC_AT] = cpu.programCounter & 0xFF;
+		header[PC_AT + 1] = cpu.programCounter >> 8;
+		header[SP_AT] = cpu.stackPointer;
+		header[A_AT] = cpu.accumulator;
+		header[X_AT] = cpu.indexRegX;
+		header[Y_AT] = cpu.indexRegY;
+		// NV1BDIZC as the 6502 pushes it, not the host's order of the bit fields
+		header[P_AT] = cpu.StatusToPush(cpu.Flag.breakCommand != 0);
+
+		Byte *next = header + HEADER_SIZE;
+		u32 stored = 0;
+		for (u32 page = 0; page < Mem::NUM_PAGES; page++) {
+			const Byte *bytes = memory.Data + page * Mem::PAGE_SIZE;
+			if (!IsZeroPage(bytes)) {
+				header[BITMAP_AT + page / 8] |= 1 << (page % 8);
+				memcpy(next, bytes, Mem::PAGE_SIZE);
+				next += Mem::PAGE_SIZE;
+				stored++;
+			}
+		}
+		Put32(header + STORED_PAGES_AT, stored);
+		out.resize(HEADER_SIZE + stored * Mem::PAGE_SIZE);
+	}
+
+	bool Snapshot::Save(const char *path, const CPU &cpu, const Mem &memory) {
+		std::vector<Byte> bytes;
+		Take(cpu, memory, bytes);
+		FILE *file = fopen(path, "wb");
+		if (file == nullptr) {
+			return false;
+		}
+		const bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		return (fclose(file) == 0) && written;
+	}
+
+	Snapshot::~Snapshot() {
+		Close();
+	}
+
+	bool Snapshot::Open(const char *path) {
+		Close();
+#if MY6502_SNAPSHOT_POSIX
+		const int fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		void *region = MAP_FAILED;
+		if (fstat(fd, &info) == 0 && static_cast<std::uint64_t>(info.st_size) >= HEADER_SIZE) {
+			region = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		close(fd);
+		if (region == MAP_FAILED) {
+			return false;
+		}
+		if (!Open(static_cast<const Byte *>(region), info.st_size)) {
+			munmap(region, info.st_size);
+			return false;
+		}
+		mapped = true;
+		return true;
+#else
+		(void)path;
+		return false;
+#endif
+	}
+
+	bool Snapshot::Open(const Byte *bytes, std::uint64_t size) {
+		Close();
+		if (size < HEADER_SIZE || memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0
+		    || Get32(bytes + VERSION_AT) != VERSION) {
+			return false;
+		}
+		const u32 stored = Get32(bytes + STORED_PAGES_AT);
+		if (stored > Mem::NUM_PAGES || size < HEADER_SIZE + std::uint64_t{stored} * Mem::PAGE_SIZE) {
+			return false;
+		}
+		const Byte *next = bytes + HEADER_SIZE;
+		u32 found = 0;
+		for (u32 page = 0; page < Mem::NUM_PAGES; page++) {
+			if (bytes[BITMAP_AT + page / 8] & (1 << (page % 8))) {
+				if (found++ == stored) {
+					Close();
+					return false;
+				}
+				pages[page] = next;
+				next += Mem::PAGE_SIZE;
+			}
+		}
+		if (found != stored) {
+			Close();
+			return false;
+		}
+		data = bytes;
+		length = size;
+		storedPages = stored;
+		programCounter = bytes[PC_AT] | (bytes[PC_AT + 1] << 8);
+		stackPointer = bytes[SP_AT];
+		accumulator = bytes[A_AT];
+		indexRegX = bytes[X_AT];
+		indexRegY = bytes[Y_AT];
+		processorStatus = bytes[P_AT];
+		return true;
+	}
+
+	void Snapshot::Close() {
+#if MY6502_SNAPSHOT_POSIX
+		if (mapped) {
+			munmap(const_cast<Byte *>(data), length);
+		}
+#endif
+		data = nullptr;
+		length = 0;
+		mapped = false;
+		storedPages = 0;
+		for (const Byte *&page : pages) {
+			page = nullptr;
+		}
+	}
+
+	bool Snapshot::Restore(CPU &cpu, Mem &memory) const {
+		if (!IsOpen()) {
+			return false;
+		}
+		cpu.programCounter = programCounter;
+		cpu.stackPointer = stackPointer;
+		cpu.accumulator = accumulator;
+		cpu.indexRegX = indexRegX;
+		cpu.indexRegY = indexRegY;
+		cpu.StatusFromStack(processorStatus);
+		cpu.Flag.breakCommand = (processorStatus >> 4) & 1;
+		for (u32 page = 0; page < Mem::NUM_PAGES; page++) {
+			Byte *bytes = memory.Data + page * Mem::PAGE_SIZE;
+			if (pages[page] != nullptr) {
+				memcpy(bytes, pages[page], Mem::PAGE_SIZE);
+			} else {
+				memset(bytes, 0, Mem::PAGE_SIZE);
+			}
+			memory.pageVersion[page]++;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,276 @@
+#include <emu6502_trace.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MY6502_TRACE_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MY6502_TRACE_POSIX 0
+#endif
+
+namespace my6502 {
+
+namespace {
+
+	/** the start of a trace file, records follow at HEADER_SIZE, the
+	 *  index at indexOffset **/
+	struct TraceHeader {
+		char magic[8];
+		u32 recordSize;
+		u32 indexInterval;
+		std::uint64_t records;
+		std::uint64_t indexOffset;
+		std::uint64_t indexEntries;
+	};
+
+	constexpr char MAGIC[8] = {'M', 'Y', '6', '5', '0', '2', 'T', '1'};
+	constexpr std::uint64_t HEADER_SIZE = 64;
+	// the file grows in steps of at least this many bytes
+	constexpr std::uint64_t GROWTH = 16 * 1024 * 1024;
+
+	static_assert(sizeof(TraceHeader) <= HEADER_SIZE, "the header fits in front of the records");
+
+	std::uint64_t RoundUpToPowerOfTwo(u32 value) {
+		std::uint64_t size = 1;
+		while (size < value) {
+			size <<= 1;
+		}
+		return size;
+	}
+}
+
+	TraceRecorder::TraceRecorder(const Mem &memory, u32 ringRecords)
+		: memory(memory), ring(RoundUpToPowerOfTwo(std::max<u32>(ringRecords, 2))),
+		  ringMask(ring.size() - 1),
+		  publishMask(std::min<std::uint64_t>(PUBLISH_INTERVAL, ring.size() / 2) - 1) {}
+
+	TraceRecorder::~TraceRecorder() {
+		Close();
+	}
+
+	bool TraceRecorder::Open(const char *path) {
+		Close();
+#if MY6502_TRACE_POSIX
+		fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			return false;
+		}
+		head = freeUntil = 0;
+		cyclesLow = 0;
+		published.store(0, std::memory_order_relaxed);
+		drained.store(0, std::memory_order_relaxed);
+		stop.store(false, std::memory_order_relaxed);
+		index.clear();
+		failed = !Reserve(GROWTH);
+		drainer = std::thread(&TraceRecorder::Drain, this);
+		return !failed;
+#else
+		(void)path;
+		return false;
+#endif
+	}
+
+	bool TraceRecorder::Close() {
+#if MY6502_TRACE_POSIX
+		if (fd < 0) {
+			return false;
+		}
+		published.store(head, std::memory_order_release);
+		stop.store(true, std::memory_order_release);
+		drainer.join();
+
+		const std::uint64_t records = drained.load(std::memory_order_acquire);
+		const std::uint64_t indexOffset = HEADER_SIZE + records * sizeof(TraceRecord);
+		const std::uint64_t length = indexOffset + index.size() * sizeof(std::uint64_t);
+		if (!failed && Reserve(length)) {
+			memcpy(map + indexOffset, index.data(), index.size() * sizeof(std::uint64_t));
+			TraceHeader header{};
+			memcpy(header.magic, MAGIC, sizeof(MAGIC));
+			header.recordSize = sizeof(TraceRecord);
+			header.indexInterval = INDEX_INTERVAL;
+			header.records = records;
+			header.indexOffset = indexOffset;
+			header.indexEntries = index.size();
+			memcpy(map, &header, sizeof(header));
+		} else {
+			failed = true;
+		}
+		Unmap();
+		failed |= ftruncate(fd, static_cast<off_t>(length)) != 0;
+		failed |= close(fd) != 0;
+		fd = -1;
+		return !failed;
+#else
+		return false;
+#endif
+	}
+
+	void TraceRecorder::Publish() {
+		if (fd < 0) {
+			// not recording, the ring is overwritten from the start
+			freeUntil = head;
+			return;
+		}
+		published.store(head, std::memory_order_release);
+		while (head + publishMask + 1 - freeUntil > ring.size()) {
+			freeUntil = drained.load(std::memory_order_acquire);
+			if (head + publishMask + 1 - freeUntil > ring.size()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void TraceRecorder::Drain() {
+		std::uint64_t tail = 0;
+		std::uint64_t cycles = 0; // of the last record drained
+		for (;;) {
+			// stop is read first, every record published before it was set is drained
+			const bool stopping = stop.load(std::memory_order_acquire);
+			const std::uint64_t available = published.load(std::memory_order_acquire);
+			if (available == tail) {
+				if (stopping) {
+					return;
+				}
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				continue;
+			}
+			if (!failed && Reserve(HEADER_SIZE + available * sizeof(TraceRecord))) {
+				TraceRecord *out = reinterpret_cast<TraceRecord *>(map + HEADER_SIZE);
+				for (std::uint64_t n = tail; n < available; n++) {
+					const Pending &in = ring[n & ringMask];
+					const u32 Low = static_cast<u32>(in.registers);
+					// an instruction takes far fewer than 2^32 cycles, the low bits wrap at most once
+					cycles += static_cast<u32>(Low - static_cast<u32>(cycles));
+					TraceRecord record;
+					record.cyclesLow = Low;
+					record.cyclesHigh = static_cast<Word>(cycles >> 32);
+					record.pc = static_cast<Word>(in.instruction);
+					record.opcode = static_cast<Byte>(in.instruction >> 16);
+					record.operands[0] = static_cast<Byte>(in.instruction >> 24);
+					record.operands[1] = static_cast<Byte>(in.instruction >> 32);
+					record.accumulator = static_cast<Byte>(in.registers >> 32);
+					record.indexRegX = static_cast<Byte>(in.registers >> 40);
+					record.indexRegY = static_cast<Byte>(in.registers >> 48);
+					record.stackPointer = static_cast<Byte>(in.instruction >> 56);
+					record.processorStatus = CPU::ResolvedStatus(static_cast<Byte>(in.registers >> 56),
+					                                             static_cast<Word>(in.instruction >> 40));
+					out[n] = record;
+					if (n % INDEX_INTERVAL == 0) {
+						index.push_back(cycles);
+					}
+				}
+			} else {
+				failed = true;
+			}
+			tail = available;
+			drained.store(tail, std::memory_order_release);
+		}
+	}
+
+	bool TraceRecorder::Reserve(std::uint64_t bytes) {
+#if MY6502_TRACE_POSIX
+		if (bytes <= mapped) {
+			return true;
+		}
+		const std::uint64_t size = std::max(bytes, mapped + std::max(mapped, GROWTH));
+		Unmap();
+		if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+			return false;
+		}
+		void *region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (region == MAP_FAILED) {
+			return false;
+		}
+		map = static_cast<Byte *>(region);
+		mapped = size;
+		return true;
+#else
+		(void)bytes;
+		return false;
+#endif
+	}
+
+	void TraceRecorder::Unmap() {
+#if MY6502_TRACE_POSIX
+		if (map != nullptr) {
+			munmap(map, mapped);
+		}
+#endif
+		map = nullptr;
+		mapped = 0;
+	}
+
+	TraceReader::~TraceReader() {
+		Close();
+	}
+
+	bool TraceReader::Open(const char *path) {
+		Close();
+#if MY6502_TRACE_POSIX
+		const int fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		void *region = MAP_FAILED;
+		if (fstat(fd, &info) == 0 && static_cast<std::uint64_t>(info.st_size) >= HEADER_SIZE) {
+			region = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		}
+		close(fd);
+		if (region == MAP_FAILED) {
+			return false;
+		}
+		map = static_cast<const Byte *>(region);
+		length = info.st_size;
+
+		TraceHeader header;
+		memcpy(&header, map, sizeof(header));
+		const bool valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+			&& header.recordSize == sizeof(TraceRecord)
+			&& header.indexOffset == HEADER_SIZE + header.records * sizeof(TraceRecord)
+			&& header.indexOffset + header.indexEntries * sizeof(std::uint64_t) <= length;
+		if (!valid) {
+			Close();
+			return false;
+		}
+		first = reinterpret_cast<const TraceRecord *>(map + HEADER_SIZE);
+		records = header.records;
+		index = reinterpret_cast<const std::uint64_t *>(map + header.indexOffset);
+		indexEntries = header.indexEntries;
+		indexInterval = header.indexInterval;
+		return true;
+#else
+		(void)path;
+		return false;
+#endif
+	}
+
+	void TraceReader::Close() {
+#if MY6502_TRACE_POSIX
+		if (map != nullptr) {
+			munmap(const_cast<Byte *>(map), length);
+		}
+#endif
+		map = nullptr;
+		length = 0;
+		first = nullptr;
+		records = 0;
+		index = nullptr;
+		indexEntries = 0;
+	}
+
+	std::uint64_t TraceReader::FindCycle(std::uint64_t cycle) const {
+		// the last indexed record that finished before cycle, cycle counts never go down
+		const std::uint64_t *after = std::lower_bound(index, index + indexEntries, cycle);
+		std::uint64_t n = after == index ? 0 : (after - index - 1) * indexInterval;
+		while (n < records && first[n].Cycles() < cycle) {
+			n++;
+		}
+		return n;
+	}
+}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_aot.h>
+#include <emu6502_image.h>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// My6502AotProgram.hex, translated by my6502_aot when the tests are built
+extern const my6502::StaticCode::Program my6502_aot_program;
+// My6502AotLoop.hex, a loop of loads and stores counting Y down through tables, closed by BNE, then a JMP
+extern const my6502::StaticCode::Program my6502_aot_loop;
+
+class My6502AotTests : public testing::Test {
+public:
+  using Byte             = my6502::Byte;
+  using Word             = my6502::Word;
+  using CPU              = my6502::CPU;
+  using Mem              = my6502::Mem;
+  using Image            = my6502::Image;
+  using StaticCode       = my6502::StaticCode;
+  using StaticRecompiler = my6502::StaticRecompiler;
+  using ExecResult       = my6502::ExecResult;
+  using StopReason       = my6502::StopReason;
+  using s32              = my6502::s32;
+
+  // 64 KiB each, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  std::unique_ptr<Mem> referenceMem = std::make_unique<Mem>();
+  CPU cpu{};
+  CPU reference{};
+  StaticCode code{my6502_aot_program};
+
+	virtual void SetUp() {
+		cpu.Reset(my6502_aot_program.entry, *mem);
+		code.LoadInto(*mem);
+		reference.Reset(my6502_aot_program.entry, *referenceMem);
+		code.LoadInto(*referenceMem); }
+  virtual void TearDown() { ; }
+
+  void ExpectSameState(const ExecResult &result, const ExecResult &expected) {
+    EXPECT_EQ(result.reason, expected.reason);
+    EXPECT_EQ(result.cyclesUsed, expected.cyclesUsed);
+    EXPECT_EQ(result.instructions, expected.instructions);
+    EXPECT_EQ(result.address, expected.address);
+    EXPECT_EQ(cpu.programCounter, reference.programCounter);
+    EXPECT_EQ(cpu.stackPointer, reference.stackPointer);
+    EXPECT_EQ(cpu.accumulator, reference.accumulator);
+    EXPECT_EQ(cpu.indexRegX, reference.indexRegX);
+    EXPECT_EQ(cpu.indexRegY, reference.indexRegY);
+    EXPECT_EQ(cpu.processorStatus, reference.processorStatus);
+    EXPECT_EQ(memcmp(mem->Data, referenceMem->Data, Mem::MAX_MEM), 0);
+  }
+};
+
+TEST_F(My6502AotTests, FindsTheBlocksReachableFromTheVectors) {
+  // given:
+  Image image;
+  ASSERT_TRUE(image.Open(MY6502_AOT_PROGRAM, Image::Format::IntelHex));
+  StaticRecompiler recompiler;
+
+  // when:
+  const bool Translated = recompiler.Translate(image);
+
+  // then:
+  ASSERT_TRUE(Translated);
+  std::vector<Word> addresses;
+  for (const StaticRecompiler::Block &block : recompiler.Blocks()) {
+    addresses.push_back(block.address);
+  }
+  // the reset code, the JSR targets and returns, past CLI and SEI, RTI is left out
+  EXPECT_EQ(addresses, (std::vector<Word>{0x8000, 0x8012, 0x8027, 0x8030, 0x8040, 0x804E, 0x80F0}));
+  const StaticRecompiler::Block &First = recompiler.Blocks().front();
+  EXPECT_EQ(First.size, 0x12);
+  EXPECT_EQ(First.instructions, 8u);
+  EXPECT_EQ(First.maxLeadCycles, 2 + 2 + 3 + 3 + 3 + 3 + 4);
+  EXPECT_EQ(my6502_aot_program.blockCount, 7u);
+  EXPECT_EQ(my6502_aot_program.entry, 0x8000);
+}
+
+TEST_F(My6502AotTests, RunsTheProgramToTheStateOfTheInterpreter) {
+  // given:
+  constexpr s32 CYCLES = 100000;
+
+  // when:
+  const ExecResult Result = code.Execute(cpu, CYCLES, *mem);
+  const ExecResult Expected = reference.Execute(CYCLES, *referenceMem);
+
+  // then:
+  ExpectSameState(Result, Expected);
+  EXPECT_GT(code.blocksRun, 0u);
+  // the subroutine at $8030 is patched every pass, and writes over its own code
+  EXPECT_GT(code.staleBlocks, 0u);
+  EXPECT_GT(code.interpreted, 0u);
+}
+
+TEST_F(My6502AotTests, StopsOnEveryBudgetWhereTheInterpreterStops) {
+  for (s32 budget = 1; budget <= 300; budget++) {
+    // given:
+    cpu.Reset(my6502_aot_program.entry, *mem);
+    code.LoadInto(*mem);
+    reference.Reset(my6502_aot_program.entry, *referenceMem);
+    code.LoadInto(*referenceMem);
+
+    // when:
+    const ExecResult Result = code.Execute(cpu, budget, *mem);
+    const ExecResult Expected = reference.Execute(budget, *referenceMem);
+
+    // then:
+    SCOPED_TRACE(budget);
+    ExpectSameState(Result, Expected);
+  }
+}
+
+TEST_F(My6502AotTests, RunsCodeWrittenOverOnTheInterpreter) {
+  // given:
+  (*mem)[0x8004] = 0x02;           // KIL in place of LDA $10
+  (*referenceMem)[0x8004] = 0x02;
+
+  // when:
+  const ExecResult Result = code.Execute(cpu, 1000, *mem);
+  const ExecResult Expected = reference.Execute(1000, *referenceMem);
+
+  // then:
+  ExpectSameState(Result, Expected);
+  EXPECT_EQ(Result.reason, StopReason::Halt);
+  EXPECT_EQ(Result.address, 0x8004);
+  EXPECT_EQ(code.blocksRun, 0u);
+  EXPECT_EQ(code.staleBlocks, 1u);
+}
+
+TEST_F(My6502AotTests, FollowsBranchesAndJumps) {
+  // given:
+  Image image;
+  ASSERT_TRUE(image.Open(MY6502_AOT_LOOP, Image::Format::IntelHex));
+  StaticRecompiler recompiler;
+
+  // when:
+  const bool Translated = recompiler.Translate(image);
+
+  // then:
+  ASSERT_TRUE(Translated);
+  std::vector<Word> addresses;
+  for (const StaticRecompiler::Block &block : recompiler.Blocks()) {
+    addresses.push_back(block.address);
+  }
+  // the reset code, the taken BNE, the BNE not taken and the JMP target
+  EXPECT_EQ(addresses, (std::vector<Word>{0x9000, 0x9002, 0x900E, 0x9020}));
+  EXPECT_EQ(my6502_aot_loop.blockCount, 4u);
+}
+
+TEST_F(My6502AotTests, RunsTheBlocksAfterABranchAsTranslatedCode) {
+  // given:
+  StaticCode loop{my6502_aot_loop};
+  cpu.Reset(my6502_aot_loop.entry, *mem);
+  loop.LoadInto(*mem);
+  reference.Reset(my6502_aot_loop.entry, *referenceMem);
+  loop.LoadInto(*referenceMem);
+
+  // when:
+  const ExecResult Result = loop.Execute(cpu, 1000, *mem);
+  const ExecResult Expected = reference.Execute(1000, *referenceMem);
+
+  // then:
+  ExpectSameState(Result, Expected);
+  EXPECT_EQ(Result.reason, StopReason::Halt);
+  EXPECT_EQ(Result.address, 0x9025);
+  EXPECT_EQ((*mem)[0x0400], 0x11);
+  EXPECT_EQ((*mem)[0x0304], 0x44);
+  // $9000 once, $9002 on each of the 3 branches back, $900E and $9020,
+  // only BNE and JMP left to the interpreter
+  EXPECT_EQ(loop.blocksRun, 1u + 3u + 1u + 1u);
+  EXPECT_EQ(loop.interpreted, 4u + 1u);
+  EXPECT_EQ(loop.staleBlocks, 0u);
+}
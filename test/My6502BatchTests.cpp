@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_batch.h>
+#include "My6502RandomPrograms.h"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+class My6502BatchTests : public testing::Test {
+public:
+  using Byte  = my6502::Byte;
+  using Word  = my6502::Word;
+  using CPU   = my6502::CPU;
+  using Mem   = my6502::Mem;
+  using Batch = my6502::Batch;
+  using s32   = my6502::s32;
+  using u32   = my6502::u32;
+
+  // not a multiple of Batch::LANES
+  static constexpr u32 INSTANCES = 61;
+
+  Batch batch{INSTANCES};
+  std::vector<CPU> cpus{INSTANCES};
+  std::vector<std::unique_ptr<Mem>> mems;
+  std::unique_ptr<Mem> saved = std::make_unique<Mem>();
+
+	virtual void SetUp() {
+    for (u32 i = 0; i < INSTANCES; i++) {
+      mems.push_back(std::make_unique<Mem>());
+      cpus[i].Reset(0x8000, *mems[i]);
+    } }
+  virtual void TearDown() { ; }
+
+  /** load every instance into the batch, run it and every instance on
+   *  its own through CPU::Execute and compare the results **/
+  void RunBothAndCompare(s32 cycles);
+};
+
+void My6502BatchTests::RunBothAndCompare(s32 cycles) {
+  for (u32 i = 0; i < INSTANCES; i++) {
+    batch.Load(i, cpus[i], *mems[i]);
+  }
+
+  batch.Execute(cycles);
+
+  for (u32 i = 0; i < INSTANCES; i++) {
+    const s32 CyclesUsed = cpus[i].Execute(cycles, *mems[i]).cyclesUsed;
+    CPU state{};
+    batch.Save(i, state, *saved);
+    EXPECT_EQ(batch.cyclesUsed[i], CyclesUsed) << "instance " << i;
+    EXPECT_EQ(state.programCounter, cpus[i].programCounter) << "instance " << i;
+    EXPECT_EQ(state.stackPointer, cpus[i].stackPointer) << "instance " << i;
+    EXPECT_EQ(state.accumulator, cpus[i].accumulator) << "instance " << i;
+    EXPECT_EQ(state.indexRegX, cpus[i].indexRegX) << "instance " << i;
+    EXPECT_EQ(state.indexRegY, cpus[i].indexRegY) << "instance " << i;
+    EXPECT_EQ(state.processorStatus, cpus[i].processorStatus) << "instance " << i;
+    ASSERT_EQ(std::memcmp(saved->Data, mems[i]->Data, Mem::MAX_MEM), 0) << "instance " << i;
+  }
+}
+
+TEST_F(My6502BatchTests, InstancesRunningTheSameProgramRunLikeTheInterpreter) {
+  // given:
+  std::mt19937 random(6502);
+  std::mt19937 program(1977);
+  for (u32 i = 0; i < INSTANCES; i++) {
+    std::mt19937 sameProgram = program;
+    my6502test::WriteLoopingProgram(sameProgram, *mems[i], 30);
+    my6502test::WriteData(random, *mems[i]);
+    cpus[i].indexRegX = static_cast<Byte>(random()); // page crossings differ per instance
+    cpus[i].indexRegY = static_cast<Byte>(random());
+  }
+
+  // when/then:
+  RunBothAndCompare(3000);
+  EXPECT_GT(batch.lockstepInstructions, 0u);
+}
+
+TEST_F(My6502BatchTests, InstancesRunningDifferentProgramsAreSplitOff) {
+  // given:
+  std::mt19937 random(42);
+  for (u32 i = 0; i < INSTANCES; i++) {
+    my6502test::WriteLoopingProgram(random, *mems[i], 1 + random() % 20);
+    my6502test::WriteData(random, *mems[i]);
+  }
+
+  // when/then:
+  RunBothAndCompare(1000);
+  EXPECT_GT(batch.splits, 0u);
+}
+
+TEST_F(My6502BatchTests, InstancesReturningToDifferentAddressesDiverge) {
+  // given:
+  for (u32 i = 0; i < INSTANCES; i++) {
+    Mem &mem = *mems[i];
+    mem[0x8000] = CPU::INS_LDA_IMMEDIATE;
+    mem[0x8001] = static_cast<Byte>(i);
+    mem[0x8002] = CPU::INS_RTS;
+    cpus[i].stackPointer = 0xFD;
+    const Word ReturnAddress = i % 3 == 0 ? 0x9000 : 0xA000;
+    mem[cpus[i].SPToAddress() + 1] = static_cast<Byte>(ReturnAddress - 1);
+    mem[cpus[i].SPToAddress() + 2] = static_cast<Byte>((ReturnAddress - 1) >> 8);
+    mem[0x9000] = CPU::INS_LDX_ABS;
+    mem[0x9001] = 0x10;
+    mem[0x9002] = 0x00;
+    mem[0xA000] = CPU::INS_STA_ABSOLUTE;
+    mem[0xA001] = 0x00;
+    mem[0xA002] = 0x30;
+  }
+
+  // when/then:
+  RunBothAndCompare(2 + 6 + 4);
+  EXPECT_EQ(batch.Read(0, 0x3000), 0x00);
+  EXPECT_EQ(batch.Read(1, 0x3000), 0x01);
+}
+
+TEST_F(My6502BatchTests, RepeatedRunsContinueWhereTheyStopped) {
+  // given:
+  std::mt19937 random(7);
+  std::mt19937 program(8);
+  for (u32 i = 0; i < INSTANCES; i++) {
+    std::mt19937 sameProgram = program;
+    my6502test::WriteLoopingProgram(sameProgram, *mems[i], 12);
+    my6502test::WriteData(random, *mems[i]);
+  }
+
+  // when/then:
+  for (s32 cycles = 1; cycles < 200; cycles += 13) {
+    RunBothAndCompare(cycles);
+  }
+}
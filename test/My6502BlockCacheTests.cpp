@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_blockcache.h>
+#include <emu6502_profile.h>
+#include "My6502RandomPrograms.h"
+#include <cstring>
+
+class My6502BlockCacheTests : public testing::Test {
+public:
+  using Byte       = my6502::Byte;
+  using Word       = my6502::Word;
+  using CPU        = my6502::CPU;
+  using Mem        = my6502::Mem;
+  using BlockCache = my6502::BlockCache;
+  using s32        = my6502::s32;
+
+  using SequenceProfile   = my6502::SequenceProfile;
+  using Superinstructions = my6502::Superinstructions;
+
+  Mem mem{};
+  CPU cpu{};
+  BlockCache cache;
+
+	virtual void SetUp() {
+		cpu.Reset(mem); }
+  virtual void TearDown() { ; }
+};
+
+TEST_F(My6502BlockCacheTests, RunsAProgramLikeTheInterpreter) {
+  // given:
+  cpu.Reset(0xFF00, mem);
+  cpu.indexRegY = 0xFF;
+  mem[0xFF00] = CPU::INS_LDA_IMMEDIATE;
+  mem[0xFF01] = 0x84;
+  mem[0xFF02] = CPU::INS_STA_ZEROPAGE;
+  mem[0xFF03] = 0x40;
+  mem[0xFF04] = CPU::INS_LDX_ZEROPAGE;
+  mem[0xFF05] = 0x40;
+  mem[0xFF06] = CPU::INS_LDA_ABSY;
+  mem[0xFF07] = 0x02;
+  mem[0xFF08] = 0x44; // 0x4402+0xFF crosses page boundary
+  mem[0x4501] = 0x69;
+  mem[0xFF09] = CPU::INS_JSR;
+  mem[0xFF0A] = 0x00;
+  mem[0xFF0B] = 0x80;
+  mem[0x8000] = CPU::INS_LDY_ZEROPAGE;
+  mem[0x8001] = 0x40;
+  mem[0x8002] = CPU::INS_RTS;
+  mem[0xFF0C] = CPU::INS_STY_ABSOLUTE;
+  mem[0xFF0D] = 0x00;
+  mem[0xFF0E] = 0x30;
+  Mem memCopy = mem;
+  CPU interpreted = cpu;
+  constexpr s32 expected_cycles = 2 + 3 + 3 + 5 + 6 + 3 + 6 + 4;
+
+  // when:
+  const s32 CyclesUsed = cache.Execute(cpu, expected_cycles, mem);
+  const s32 InterpretedCycles = interpreted.Execute(expected_cycles, memCopy).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, expected_cycles);
+  EXPECT_EQ(CyclesUsed, InterpretedCycles);
+  my6502test::VerifySameState(cpu, interpreted);
+  EXPECT_EQ(mem[0x3000], 0x84);
+}
+
+TEST_F(My6502BlockCacheTests, StopsAtTheSameCycleAsTheInterpreter) {
+  // given:
+  cpu.Reset(0xFF00, mem);
+  for (Word address = 0xFF00; address < 0xFF20; address += 2) {
+    mem[address] = CPU::INS_LDA_ZEROPAGE;
+    mem[address + 1] = static_cast<Byte>(address);
+  }
+  CPU interpreted = cpu;
+
+  // when:
+  const s32 CyclesUsed = cache.Execute(cpu, 10, mem);
+  const s32 InterpretedCycles = interpreted.Execute(10, mem).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, 12);
+  EXPECT_EQ(CyclesUsed, InterpretedCycles);
+  my6502test::VerifySameState(cpu, interpreted);
+}
+
+TEST_F(My6502BlockCacheTests, ABlockThatWritesOverItsOwnCodeRunsTheNewCode) {
+  // given:
+  cpu.Reset(0x8000, mem);
+  mem[0x8000] = CPU::INS_LDA_IMMEDIATE;
+  mem[0x8001] = 0x42;
+  mem[0x8002] = CPU::INS_STA_ABSOLUTE;
+  mem[0x8003] = 0x06;
+  mem[0x8004] = 0x80; // operand of the LDX below
+  mem[0x8005] = CPU::INS_LDX_IMMEDIATE;
+  mem[0x8006] = 0x00;
+  constexpr s32 expected_cycles = 2 + 4 + 2;
+
+  // when:
+  const s32 CyclesUsed = cache.Execute(cpu, expected_cycles, mem);
+
+  // then:
+  EXPECT_EQ(CyclesUsed, expected_cycles);
+  EXPECT_EQ(cpu.indexRegX, 0x42);
+}
+
+TEST_F(My6502BlockCacheTests, HostWritesToCachedCodeInvalidateTheBlock) {
+  // given:
+  cpu.Reset(0x8000, mem);
+  mem[0x8000] = CPU::INS_LDA_IMMEDIATE;
+  mem[0x8001] = 0x01;
+  mem[0x8002] = CPU::INS_LDX_IMMEDIATE;
+  mem[0x8003] = 0x02;
+  cache.Execute(cpu, 4, mem);
+  ASSERT_EQ(cpu.accumulator, 0x01);
+
+  // when:
+  mem[0x8001] = 0x11;
+  cpu.programCounter = 0x8000;
+  cache.Execute(cpu, 4, mem);
+
+  // then:
+  EXPECT_EQ(cpu.accumulator, 0x11);
+}
+
+TEST_F(My6502BlockCacheTests, TheBlockIsOnlyDecodedOnceWhileItIsValid) {
+  // given:
+  cpu.Reset(0x8000, mem);
+  mem[0x8000] = CPU::INS_LDA_IMMEDIATE;
+  mem[0x8001] = 0x01;
+  mem[0x8002] = CPU::INS_STA_ZEROPAGE;
+  mem[0x8003] = 0x10;
+  mem[0x8004] = CPU::INS_RTS;
+  cpu.stackPointer = 0xFD;
+  mem[cpu.SPToAddress() + 1] = 0xFF;
+  mem[cpu.SPToAddress() + 2] = 0x7F; // RTS back to 0x8000
+
+  // when:
+  for (int i = 0; i < 10; i++) {
+    cpu.stackPointer = 0xFD;
+    cache.Execute(cpu, 2 + 3 + 6, mem);
+  }
+
+  // then:
+  EXPECT_EQ(cache.blocksDecoded, 1u);
+}
+
+TEST_F(My6502BlockCacheTests, FusedSequencesRunLikeTheInterpreterOnEveryBudget) {
+  // given:
+  cpu.Reset(0x8000, mem);
+  const Byte Program[] = {
+    CPU::INS_LDA_IMMEDIATE, 0x84, CPU::INS_STA_ABSOLUTE, 0x40, 0x00,  // LDA #imm; STA abs
+    CPU::INS_LDX_ZEROPAGE, 0x41, CPU::INS_LDA_ABSX, 0x01, 0x44,       // LDX zp; LDA abs,X
+    CPU::INS_LDY_IMMEDIATE, 0xFF, CPU::INS_LDA_INDIRECTY, 0x42,       // LDY #imm; LDA (zp),Y
+    CPU::INS_JSR, 0x00, 0x90,                                          // a leaf routine
+    CPU::INS_STY_ABSOLUTE, 0x00, 0x30,
+    0x02};                                                             // KIL
+  memcpy(mem.Data + 0x8000, Program, sizeof(Program));
+  mem[0x0041] = 0xFF; // LDA $4401,X crosses a page
+  mem[0x0042] = 0x10;
+  mem[0x0043] = 0x20; // ($42),Y crosses a page
+  mem[0x4500] = 0x69;
+  mem[0x9000] = CPU::INS_LDY_ZEROPAGE;
+  mem[0x9001] = 0x40;
+  mem[0x9002] = CPU::INS_RTS;
+  const Mem Start = mem;
+  const CPU Reset = cpu;
+  SequenceProfile profile;
+  CPU profiled = Reset;
+  Mem profiledMem = Start;
+  profiled.Execute(1000, profiledMem, profile);
+  const Superinstructions Hot = Superinstructions::Hot(profile, 0.05);
+  cache.Fuse(Hot);
+
+  for (s32 budget = 1; budget <= 60; budget++) {
+    mem = Start;
+    cpu = Reset;
+    Mem memCopy = Start;
+    CPU interpreted = Reset;
+
+    // when:
+    const s32 CyclesUsed = cache.Execute(cpu, budget, mem);
+    const s32 InterpretedCycles = interpreted.Execute(budget, memCopy).cyclesUsed;
+
+    // then:
+    SCOPED_TRACE(budget);
+    EXPECT_EQ(CyclesUsed, InterpretedCycles);
+    my6502test::VerifySameState(cpu, interpreted);
+    EXPECT_EQ(memcmp(mem.Data, memCopy.Data, Mem::MAX_MEM), 0);
+  }
+  EXPECT_EQ(Hot.Pairs(), 4u);
+  EXPECT_TRUE(Hot.pairs[(CPU::INS_LDA_IMMEDIATE << 8) | CPU::INS_STA_ABSOLUTE]);
+  EXPECT_TRUE(Hot.pairs[(CPU::INS_LDX_ZEROPAGE << 8) | CPU::INS_LDA_ABSX]);
+  EXPECT_TRUE(Hot.pairs[(CPU::INS_LDA_ABSX << 8) | CPU::INS_LDY_IMMEDIATE]);
+  EXPECT_TRUE(Hot.pairs[(CPU::INS_LDY_IMMEDIATE << 8) | CPU::INS_LDA_INDIRECTY]);
+  EXPECT_TRUE(Hot.leafCalls);
+  EXPECT_GT(cache.superinstructionsDecoded, 0u);
+}
+
+TEST_F(My6502BlockCacheTests, AFusedCallStopsWhereItsRoutineWritesOverItself) {
+  // given:
+  cpu.Reset(0x8000, mem);
+  mem[0x8000] = CPU::INS_JSR;
+  mem[0x8001] = 0x00;
+  mem[0x8002] = 0x90;
+  mem[0x9000] = CPU::INS_STA_ABSOLUTE;
+  mem[0x9001] = 0x04;
+  mem[0x9002] = 0x90; // operand of the LDX below
+  mem[0x9003] = CPU::INS_LDX_IMMEDIATE;
+  mem[0x9004] = 0x00;
+  mem[0x9005] = CPU::INS_RTS;
+  cpu.accumulator = 0x42;
+  Superinstructions superinstructions;
+  superinstructions.leafCalls = true;
+  cache.Fuse(superinstructions);
+  constexpr s32 expected_cycles = 6 + 4 + 2 + 6;
+
+  // when:
+  const s32 CyclesUsed = cache.Execute(cpu, expected_cycles, mem);
+
+  // then:
+  EXPECT_EQ(CyclesUsed, expected_cycles);
+  EXPECT_EQ(cpu.indexRegX, 0x42);
+  EXPECT_EQ(cpu.programCounter, 0x8003);
+  EXPECT_EQ(cache.superinstructionsDecoded, 1u);
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_bus.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class My6502BusTests : public testing::Test {
+public:
+  using Byte = my6502::Byte;
+  using Word = my6502::Word;
+  using CPU  = my6502::CPU;
+  using Mem  = my6502::Mem;
+  using Bus  = my6502::Bus;
+  using s32  = my6502::s32;
+
+  /** remembers every access and reads back the low byte of the address **/
+  struct Recorder {
+    std::vector<Word> reads;
+    std::vector<std::pair<Word, Byte>> writes;
+
+    static Byte Read(void *device, Word address) {
+      static_cast<Recorder *>(device)->reads.push_back(address);
+      return static_cast<Byte>(address);
+    }
+    static void Write(void *device, Word address, Byte value) {
+      static_cast<Recorder *>(device)->writes.emplace_back(address, value);
+    }
+  };
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> ram = std::make_unique<Mem>();
+  Bus bus{*ram};
+  CPU cpu{};
+  Recorder recorder;
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, bus); }
+  virtual void TearDown() { ; }
+};
+
+TEST_F(My6502BusTests, RamPagesReadAndWriteTheMemory) {
+  // given:
+  bus[0x8000] = CPU::INS_LDA_ABS;
+  bus[0x8001] = 0x00;
+  bus[0x8002] = 0x30;
+  bus[0x8003] = CPU::INS_STA_ZEROPAGE;
+  bus[0x8004] = 0x10;
+  bus[0x3000] = 0x42;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(4 + 3, bus).cyclesUsed;
+
+  // then:
+  EXPECT_TRUE(bus.RamOnly());
+  EXPECT_EQ(CyclesUsed, 4 + 3);
+  EXPECT_EQ(cpu.accumulator, 0x42);
+  EXPECT_EQ(ram->Data[0x0010], 0x42);
+}
+
+TEST_F(My6502BusTests, DevicePagesCallTheHandlers) {
+  // given:
+  bus.MapDevice(0xD0, 0xD1, &Recorder::Read, &Recorder::Write, &recorder);
+  bus[0x8000] = CPU::INS_LDX_ABS;
+  bus[0x8001] = 0x34;
+  bus[0x8002] = 0xD1;
+  bus[0x8003] = CPU::INS_STX_ABSOLUTE;
+  bus[0x8004] = 0x12;
+  bus[0x8005] = 0xD0;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(4 + 4, bus).cyclesUsed;
+
+  // then:
+  EXPECT_FALSE(bus.RamOnly());
+  EXPECT_EQ(CyclesUsed, 4 + 4);
+  EXPECT_EQ(cpu.indexRegX, 0x34);
+  ASSERT_EQ(recorder.reads.size(), 1u);
+  EXPECT_EQ(recorder.reads[0], 0xD134);
+  ASSERT_EQ(recorder.writes.size(), 1u);
+  EXPECT_EQ(recorder.writes[0].first, 0xD012);
+  EXPECT_EQ(recorder.writes[0].second, 0x34);
+  EXPECT_EQ(ram->Data[0xD012], 0x00);
+}
+
+TEST_F(My6502BusTests, RomPagesDropWrites) {
+  // given:
+  (*ram)[0xE000] = 0x77;
+  bus.MapROM(0xE0, 0xFF);
+  cpu.accumulator = 0x11;
+  bus[0x8000] = CPU::INS_STA_ABSOLUTE;
+  bus[0x8001] = 0x00;
+  bus[0x8002] = 0xE0;
+
+  // when:
+  cpu.Execute(4, bus);
+
+  // then:
+  EXPECT_EQ(static_cast<const Bus &>(bus)[0xE000], 0x77);
+}
+
+TEST_F(My6502BusTests, RemappingRamMakesTheBusRamOnlyAgain) {
+  // given:
+  bus.MapDevice(0xD0, 0xD0, &Recorder::Read, nullptr, &recorder);
+  bus.MapROM(0xF0, 0xF1);
+
+  // when:
+  bus.MapRAM(0xD0, 0xD0);
+  bus.MapRAM(0xF0, 0xF1);
+
+  // then:
+  EXPECT_TRUE(bus.RamOnly());
+}
+
+TEST_F(My6502BusTests, ResetClearsRamWrittenThroughTheBus) {
+  // given:
+  bus.MapDevice(0xD0, 0xD0, &Recorder::Read, &Recorder::Write, &recorder);
+  bus[0x4000] = 0x01;
+
+  // when:
+  cpu.Reset(0x8000, bus);
+
+  // then:
+  EXPECT_EQ(ram->Data[0x4000], 0x00);
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_fleet.h>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+class My6502FleetTests : public testing::Test {
+public:
+  using Byte  = my6502::Byte;
+  using Word  = my6502::Word;
+  using CPU   = my6502::CPU;
+  using Mem   = my6502::Mem;
+  using Fleet = my6502::Fleet;
+  using s32   = my6502::s32;
+  using u32   = my6502::u32;
+
+  static constexpr u32 JOBS = 40;
+
+	virtual void SetUp() { ; }
+  virtual void TearDown() { ; }
+
+  /** reset the CPU and write a program that stores a value that
+   *  depends on the job and calls itself again **/
+  static std::shared_ptr<Mem> Image(u32 job, CPU &cpu);
+  static Fleet::Job MakeJob(u32 id, s32 cycles);
+};
+
+std::shared_ptr<my6502::Mem> My6502FleetTests::Image(u32 job, CPU &cpu) {
+  auto mem = std::make_shared<Mem>();
+  cpu.Reset(0x8000, *mem);
+  Mem &image = *mem;
+  image[0x0040] = static_cast<Byte>(job);
+  image[0x8000] = CPU::INS_LDX_ZEROPAGE;
+  image[0x8001] = 0x40;
+  image[0x8002] = CPU::INS_LDA_ZEROPX;
+  image[0x8003] = 0x10;
+  image[0x8004] = CPU::INS_STA_ABSOLUTEX;
+  image[0x8005] = 0x00;
+  image[0x8006] = 0x30;
+  image[0x8007] = CPU::INS_LDY_IMMEDIATE;
+  image[0x8008] = static_cast<Byte>(job * 3);
+  image[0x8009] = CPU::INS_STY_ZEROPAGE;
+  image[0x800A] = 0x10;
+  image[0x800B] = CPU::INS_JSR;
+  image[0x800C] = 0x00;
+  image[0x800D] = 0x80;
+  return mem;
+}
+
+My6502FleetTests::Fleet::Job My6502FleetTests::MakeJob(u32 id, s32 cycles) {
+  Fleet::Job job;
+  job.id = id;
+  job.image = Image(id, job.cpu);
+  job.cycles = cycles;
+  job.keepMemory = true;
+  return job;
+}
+
+TEST_F(My6502FleetTests, JobsRunLikeTheInterpreter) {
+  // given:
+  Fleet fleet(3);
+  std::vector<Fleet::Job> jobs;
+  for (u32 i = 0; i < JOBS; i++) {
+    jobs.push_back(MakeJob(i, 500 + 37 * i));
+    fleet.Submit(jobs.back());
+  }
+
+  // when:
+  std::vector<Fleet::Result> results = fleet.Wait();
+
+  // then:
+  ASSERT_EQ(results.size(), JOBS);
+  std::vector<bool> seen(JOBS);
+  for (const Fleet::Result &result : results) {
+    ASSERT_LT(result.id, JOBS);
+    EXPECT_FALSE(seen[result.id]);
+    seen[result.id] = true;
+
+    const Fleet::Job &job = jobs[result.id];
+    CPU cpu = job.cpu;
+    auto mem = std::make_unique<Mem>(*job.image);
+    const s32 CyclesUsed = cpu.Execute(job.cycles, *mem).cyclesUsed;
+    EXPECT_TRUE(result.completed);
+    EXPECT_EQ(result.cyclesUsed, CyclesUsed);
+    EXPECT_EQ(result.cpu.programCounter, cpu.programCounter);
+    EXPECT_EQ(result.cpu.stackPointer, cpu.stackPointer);
+    EXPECT_EQ(result.cpu.accumulator, cpu.accumulator);
+    EXPECT_EQ(result.cpu.indexRegX, cpu.indexRegX);
+    EXPECT_EQ(result.cpu.indexRegY, cpu.indexRegY);
+    EXPECT_EQ(result.cpu.processorStatus, cpu.processorStatus);
+    ASSERT_TRUE(result.memory);
+    EXPECT_EQ(std::memcmp(result.memory->Data, mem->Data, Mem::MAX_MEM), 0);
+  }
+}
+
+TEST_F(My6502FleetTests, UnhandledInstructionEndsOnlyItsJob) {
+  // given:
+  Fleet fleet(2);
+  Fleet::Job broken = MakeJob(1, 1000);
+  auto image = std::make_shared<Mem>(*broken.image);
+  (*image)[0x8007] = 0xFF; // no instruction
+  broken.image = image;
+  fleet.Submit(MakeJob(0, 1000));
+  fleet.Submit(broken);
+
+  // when:
+  std::vector<Fleet::Result> results = fleet.Wait();
+
+  // then:
+  ASSERT_EQ(results.size(), 2u);
+  for (const Fleet::Result &result : results) {
+    EXPECT_EQ(result.completed, result.id == 0);
+  }
+}
+
+TEST_F(My6502FleetTests, PollHandsBackEveryResultOnce) {
+  // given:
+  Fleet fleet(2);
+  for (u32 i = 0; i < JOBS; i++) {
+    Fleet::Job job = MakeJob(i, 200);
+    job.keepMemory = false;
+    fleet.Submit(job);
+  }
+
+  // when:
+  std::vector<bool> seen(JOBS);
+  u32 polled = 0;
+  Fleet::Result result;
+  while (polled < JOBS) {
+    if (fleet.Poll(result)) {
+      ASSERT_LT(result.id, JOBS);
+      EXPECT_FALSE(seen[result.id]);
+      EXPECT_FALSE(result.memory);
+      seen[result.id] = true;
+      polled++;
+    }
+  }
+
+  // then:
+  EXPECT_TRUE(fleet.Wait().empty());
+  EXPECT_FALSE(fleet.Poll(result));
+}
+
+TEST_F(My6502FleetTests, IdleWorkersStealQueuedJobs) {
+  // given:
+  Fleet fleet(4);
+  for (u32 i = 0; i < JOBS; i++) {
+    Fleet::Job job = MakeJob(i, 200000);
+    job.keepMemory = false;
+    fleet.Submit(job, 0);
+  }
+
+  // when:
+  std::vector<Fleet::Result> results = fleet.Wait();
+
+  // then:
+  EXPECT_EQ(results.size(), JOBS);
+  EXPECT_GT(fleet.Steals(), 0u);
+}
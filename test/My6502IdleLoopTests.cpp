@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_bus.h>
+#include <emu6502_debug.h>
+#include <emu6502_irq.h>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+class My6502IdleLoopTests : public testing::Test {
+public:
+  using Byte                = my6502::Byte;
+  using Word                = my6502::Word;
+  using CPU                 = my6502::CPU;
+  using Mem                 = my6502::Mem;
+  using Bus                 = my6502::Bus;
+  using InterruptController = my6502::InterruptController;
+  using Line                = my6502::InterruptController::Line;
+  using StopConditions      = my6502::StopConditions;
+  using ExecResult          = my6502::ExecResult;
+  using StopReason          = my6502::StopReason;
+  using s32                 = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { ; }
+
+  void Write(Word address, std::initializer_list<Byte> bytes) {
+    for (const Byte b : bytes) {
+      (*mem)[address++] = b;
+    }
+  }
+
+  /** runs the program on Execute and on RunUntil, which never skips,
+   *  and expects the same from both on every budget **/
+  void ExpectSameAsSpinning() {
+    const Mem Start = *mem;
+    const CPU Reset = cpu;
+    std::vector<s32> budgets;
+    for (s32 budget = 1; budget <= 40; budget++) {
+      budgets.push_back(budget);
+    }
+    budgets.push_back(100000);
+    budgets.push_back(1000003);
+    for (const s32 Budget : budgets) {
+      // given:
+      *mem = Start;
+      cpu = Reset;
+      auto spunMem = std::make_unique<Mem>(Start);
+      CPU spun = Reset;
+
+      // when:
+      const ExecResult Result = cpu.Execute(Budget, *mem);
+      const ExecResult Spun = spun.RunUntil(Budget, *spunMem, StopConditions{});
+
+      // then:
+      SCOPED_TRACE(Budget);
+      EXPECT_EQ(Result.reason, Spun.reason);
+      EXPECT_EQ(Result.cyclesUsed, Spun.cyclesUsed);
+      EXPECT_EQ(Result.instructions, Spun.instructions);
+      EXPECT_EQ(cpu.programCounter, spun.programCounter);
+      EXPECT_EQ(cpu.accumulator, spun.accumulator);
+      EXPECT_EQ(cpu.indexRegX, spun.indexRegX);
+      EXPECT_EQ(cpu.indexRegY, spun.indexRegY);
+      EXPECT_EQ(cpu.stackPointer, spun.stackPointer);
+      EXPECT_EQ(cpu.processorStatus, spun.processorStatus);
+      EXPECT_EQ(memcmp(mem->Data, spunMem->Data, Mem::MAX_MEM), 0);
+    }
+  }
+};
+
+TEST_F(My6502IdleLoopTests, APollingLoopEndsTheRunAsIfItHadSpun) {
+  Write(0x8000, {CPU::INS_LDA_ABS, 0x00, 0x02, CPU::INS_BEQ, 0xFB}); // LDA $0200; BEQ back
+  ExpectSameAsSpinning();
+}
+
+TEST_F(My6502IdleLoopTests, AJumpToItselfEndsTheRunAsIfItHadSpun) {
+  Write(0x8000, {CPU::INS_LDA_IMMEDIATE, 0x01, CPU::INS_JMP_ABSOLUTE, 0x02, 0x80});
+  ExpectSameAsSpinning();
+}
+
+TEST_F(My6502IdleLoopTests, ALoopAcrossPagesWithABranchOutEndsTheRunAsIfItHadSpun) {
+  // loop: LDA $0200; BNE out; LDY $0201; BEQ loop, the BEQ goes back a page
+  cpu.Reset(0x80F8, *mem);
+  Write(0x80F8, {CPU::INS_LDA_ABS, 0x00, 0x02, CPU::INS_BNE, 0x05,
+                 CPU::INS_LDY_ABS, 0x01, 0x02, CPU::INS_BEQ, 0xF6, 0x02});
+  ExpectSameAsSpinning();
+}
+
+TEST_F(My6502IdleLoopTests, LoopsThatChangeSomethingRunAsBefore) {
+  // a store every iteration
+  Write(0x8000, {CPU::INS_LDA_ABS, 0x00, 0x02, CPU::INS_STA_ABSOLUTE, 0x00, 0x03, CPU::INS_BEQ, 0xF8});
+  ExpectSameAsSpinning();
+
+  // X goes 1, 3, 1, 3, ..., the loop only comes back to itself every second iteration
+  cpu.Reset(0x8000, *mem);
+  Write(0x0011, {2, 3, 4, 1});
+  // LDX #1; loop: LDY $10,X; LDX $10,Y; BNE loop
+  Write(0x8000, {CPU::INS_LDX_IMMEDIATE, 0x01, CPU::INS_LDY_ZEROPX, 0x10, CPU::INS_LDX_ZEROPY, 0x10,
+                 CPU::INS_BNE, 0xFA});
+  ExpectSameAsSpinning();
+}
+
+TEST_F(My6502IdleLoopTests, ALoopPollingADeviceIsNotSkipped) {
+  // given:
+  struct Register {
+    static Byte Read(void *reads, Word) {
+      ++*static_cast<int *>(reads);
+      return 0;
+    }
+    static void Write(void *, Word, Byte) {}
+  };
+  int reads = 0;
+  Bus bus{*mem};
+  bus.MapDevice(0xD0, 0xD0, &Register::Read, &Register::Write, &reads);
+  Write(0x8000, {CPU::INS_LDA_ABS, 0x00, 0xD0, CPU::INS_BEQ, 0xFB});
+
+  // when:
+  const ExecResult Result = cpu.Execute(100 * (4 + 3), bus);
+
+  // then:
+  EXPECT_EQ(Result.cyclesUsed, 100 * (4 + 3));
+  EXPECT_EQ(Result.instructions, 200u);
+  EXPECT_EQ(reads, 100);
+}
+
+TEST_F(My6502IdleLoopTests, AnInterruptHandlerEndsTheWaitAtItsCycle) {
+  // given:
+  Mem &m = *mem;
+  // wait: LDA $10; BEQ wait; KIL
+  Write(0x8000, {CPU::INS_LDA_ZEROPAGE, 0x10, CPU::INS_BEQ, 0xFC, 0x02});
+  // nmi: LDA #1; STA $10; RTI
+  Write(0x9000, {CPU::INS_LDA_IMMEDIATE, 0x01, CPU::INS_STA_ZEROPAGE, 0x10, CPU::INS_RTI});
+  m[CPU::NMI_VECTOR] = 0x00;
+  m[CPU::NMI_VECTOR + 1] = 0x90;
+  InterruptController irq;
+  const InterruptController::Source Timer = irq.AddSource(Line::NMI);
+  irq.Schedule(Timer, 100000);
+
+  // when:
+  const ExecResult Result = irq.Run(cpu, 1000000, m);
+
+  // then:
+  // iterations of 3 + 3 cycles, the one ending at 100002 is the first at or after 100000
+  constexpr s32 Waited = 100002;
+  EXPECT_EQ(Result.reason, StopReason::Halt);
+  EXPECT_EQ(Result.cyclesUsed, Waited + InterruptController::INTERRUPT_CYCLES + 2 + 3 + 6 + 3 + 2);
+  EXPECT_EQ(Result.instructions, Waited / 6 * 2 + 3 + 2);
+  EXPECT_EQ(irq.nmisTaken, 1u);
+  EXPECT_EQ(irq.stretches, 2u);
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_bus.h>
+#include <emu6502_image.h>
+#include "My6502TempFiles.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class My6502ImageTests : public testing::Test {
+public:
+  using Byte   = my6502::Byte;
+  using Word   = my6502::Word;
+  using CPU    = my6502::CPU;
+  using Mem    = my6502::Mem;
+  using Bus    = my6502::Bus;
+  using Image  = my6502::Image;
+  using Format = my6502::Image::Format;
+  using s32    = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+  std::string path = my6502test::TempPath("my6502_image");
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { remove(path.c_str()); }
+
+  /** LDA #$42, LDX #$80, STX $10 **/
+  const std::vector<Byte> program = {
+    CPU::INS_LDA_IMMEDIATE, 0x42, CPU::INS_LDX_IMMEDIATE, 0x80, CPU::INS_STX_ZEROPAGE, 0x10};
+
+  void WriteFile(const std::vector<Byte> &bytes) {
+    FILE *file = fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+  }
+};
+
+TEST_F(My6502ImageTests, LoadsARawImageAndPointsTheResetVectorAtIt) {
+  // given:
+  Image image;
+  ASSERT_TRUE(image.Open(program.data(), program.size(), Format::Raw, 0x0200));
+
+  // when:
+  ASSERT_TRUE(image.LoadInto(*mem));
+  cpu.programCounter = image.Entry();
+  const s32 CyclesUsed = cpu.Execute(2 + 2 + 3, *mem).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(image.Entry(), 0x0200);
+  EXPECT_EQ((*mem)[0xFFFC], 0x00);
+  EXPECT_EQ((*mem)[0xFFFD], 0x02);
+  EXPECT_EQ(CyclesUsed, 2 + 2 + 3);
+  EXPECT_EQ((*mem)[0x0010], 0x80);
+}
+
+TEST_F(My6502ImageTests, LoadsAPrgFileAtItsLoadAddress) {
+  // given:
+  std::vector<Byte> prg = {0x01, 0x08};
+  prg.insert(prg.end(), program.begin(), program.end());
+  WriteFile(prg);
+  Image image;
+
+  // when:
+  ASSERT_TRUE(image.Open(path.c_str(), Format::PRG));
+  ASSERT_TRUE(image.LoadInto(*mem));
+
+  // then:
+  ASSERT_EQ(image.Segments().size(), 1u);
+  EXPECT_EQ(image.Segments()[0].address, 0x0801);
+  EXPECT_EQ(image.Segments()[0].size, program.size());
+  EXPECT_EQ(image.Entry(), 0x0801);
+  EXPECT_EQ((*mem)[0x0801], CPU::INS_LDA_IMMEDIATE);
+  EXPECT_EQ((*mem)[0x0806], 0x10);
+}
+
+TEST_F(My6502ImageTests, DecodesIntelHexRecords) {
+  // given:
+  const std::string hex =
+    ":03800000A942A2F0\r\n"
+    ":0380030080861064\r\n"
+    ":040000050000800077\r\n"
+    ":00000001FF\r\n";
+  Image image;
+
+  // when:
+  ASSERT_TRUE(image.Open(reinterpret_cast<const Byte *>(hex.data()), hex.size(), Format::IntelHex));
+  ASSERT_TRUE(image.LoadInto(*mem));
+
+  // then:
+  ASSERT_EQ(image.Segments().size(), 1u); // consecutive records are one segment
+  EXPECT_EQ(image.Segments()[0].size, 6u);
+  EXPECT_EQ(image.Entry(), 0x8000);
+  EXPECT_EQ(memcmp(mem->Data + 0x8000, program.data(), program.size()), 0);
+}
+
+TEST_F(My6502ImageTests, RejectsIntelHexWithABadChecksum) {
+  // given:
+  const std::string hex =
+    ":03800000A942A2F1\n"
+    ":00000001FF\n";
+  Image image;
+
+  // when:
+  const bool Opened = image.Open(reinterpret_cast<const Byte *>(hex.data()), hex.size(), Format::IntelHex);
+
+  // then:
+  EXPECT_FALSE(Opened);
+  EXPECT_FALSE(image.LoadInto(*mem));
+}
+
+TEST_F(My6502ImageTests, RejectsIntelHexRecordsPastTheEndOfMemory) {
+  // given: a linear base of $FFFF0000 and 32 bytes at $FFF0, which wrap to $0010 in 32 bits
+  const std::string hex =
+    ":02000004FFFFFC\n"
+    ":20FFF000000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F01\n"
+    ":00000001FF\n";
+  Image image;
+
+  // when:
+  const bool Opened = image.Open(reinterpret_cast<const Byte *>(hex.data()), hex.size(), Format::IntelHex);
+
+  // then:
+  EXPECT_FALSE(Opened);
+  EXPECT_FALSE(image.LoadInto(*mem));
+}
+
+TEST_F(My6502ImageTests, MapsTheMirroredBankOfAnInesRomOnTheBus) {
+  // given:
+  std::vector<Byte> nes(16 + 16 * 1024, 0x00);
+  nes[0] = 'N'; nes[1] = 'E'; nes[2] = 'S'; nes[3] = 0x1A;
+  nes[4] = 1; // one 16 KiB PRG bank
+  std::copy(program.begin(), program.end(), nes.begin() + 16);
+  nes[16 + 0x3FFC] = 0x00; // reset vector $C000, the mirror of the bank
+  nes[16 + 0x3FFD] = 0xC0;
+  Bus bus{*mem};
+  Image image;
+  ASSERT_TRUE(image.Open(nes.data(), nes.size(), Format::INES));
+
+  // when:
+  ASSERT_TRUE(image.MapInto(bus));
+  bus[0x8001] = 0x99; // ROM, dropped
+  cpu.programCounter = image.Entry();
+  const s32 CyclesUsed = cpu.Execute(2 + 2 + 3, bus).cyclesUsed;
+
+  // then:
+  const Bus &reads = bus;
+  EXPECT_EQ(image.Entry(), 0xC000);
+  EXPECT_EQ(reads[0x8001], 0x42);
+  EXPECT_EQ(reads[0xC001], 0x42);
+  EXPECT_EQ(mem->Data[0x8001], 0x00); // mapped, not copied
+  EXPECT_EQ(CyclesUsed, 2 + 2 + 3);
+  EXPECT_EQ(reads[0x0010], 0x80);
+}
+
+TEST_F(My6502ImageTests, CopiesThePartsOfPagesItCannotMap) {
+  // given:
+  std::vector<Byte> rom(0x180, 0xEA);
+  Bus bus{*mem};
+  Image image;
+  ASSERT_TRUE(image.Open(rom.data(), rom.size(), Format::Raw, 0x2080));
+
+  // when:
+  ASSERT_TRUE(image.MapInto(bus));
+  bus[0x2080] = 0x00;
+  bus[0x2100] = 0x00;
+  bus[0x2000] = 0x00; // the same page as the start of the image
+
+  // then:
+  const Bus &reads = bus;
+  EXPECT_EQ(mem->Data[0x2080], 0xEA); // the first page is copied
+  EXPECT_EQ(mem->Data[0x2100], 0x00); // the second is mapped
+  EXPECT_EQ(reads[0x2080], 0xEA);
+  EXPECT_EQ(reads[0x2100], 0xEA);
+  EXPECT_EQ(reads[0x21FF], 0xEA);
+  EXPECT_EQ(reads[0x2200], 0x00);
+}
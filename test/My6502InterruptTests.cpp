@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_bus.h>
+#include <emu6502_irq.h>
+#include <memory>
+
+class My6502InterruptTests : public testing::Test {
+public:
+  using Byte                = my6502::Byte;
+  using Word                = my6502::Word;
+  using CPU                 = my6502::CPU;
+  using Mem                 = my6502::Mem;
+  using Bus                 = my6502::Bus;
+  using InterruptController = my6502::InterruptController;
+  using Line                = my6502::InterruptController::Line;
+  using ExecResult          = my6502::ExecResult;
+  using StopReason          = my6502::StopReason;
+  using s32                 = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+  InterruptController irq;
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { ; }
+
+  /** LDA #$00 from 0x8000 up to the handlers at 0x9000 **/
+  void WriteLoads() {
+    for (Word address = 0x8000; address < 0x9000; address += 2) {
+      (*mem)[address] = CPU::INS_LDA_IMMEDIATE;
+      (*mem)[address + 1] = 0x00;
+    }
+  }
+
+  void SetVector(Word vector, Word handler) {
+    (*mem)[vector] = handler & 0xFF;
+    (*mem)[vector + 1] = handler >> 8;
+  }
+};
+
+TEST_F(My6502InterruptTests, BrkPushesTheReturnAddressAndStatusAndRtiComesBack) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_BRK;
+  m[0x8001] = 0xEA; // skipped
+  m[0x8002] = CPU::INS_LDA_IMMEDIATE;
+  m[0x8003] = 0x42;
+  m[0x9000] = CPU::INS_RTI;
+  SetVector(CPU::IRQ_VECTOR, 0x9000);
+  cpu.Flag.carryFlag = 1;
+
+  // when:
+  const s32 BrkCycles = cpu.Execute(7, m).cyclesUsed;
+  const Word HandlerPC = cpu.programCounter;
+  const bool Masked = cpu.Flag.interruptDisable;
+  const s32 ReturnCycles = cpu.Execute(6 + 2, m).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(BrkCycles, 7);
+  EXPECT_EQ(HandlerPC, 0x9000);
+  EXPECT_TRUE(Masked);
+  EXPECT_EQ(m[0x01FF], 0x80);
+  EXPECT_EQ(m[0x01FE], 0x02);
+  EXPECT_EQ(m[0x01FD], 0x31); // bit 5, B and C
+  EXPECT_EQ(ReturnCycles, 6 + 2);
+  EXPECT_EQ(cpu.programCounter, 0x8004);
+  EXPECT_EQ(cpu.stackPointer, 0xFF);
+  EXPECT_EQ(cpu.accumulator, 0x42);
+  EXPECT_EQ(cpu.Flag.carryFlag, 1);
+  EXPECT_EQ(cpu.Flag.interruptDisable, 0);
+}
+
+TEST_F(My6502InterruptTests, TakesAScheduledIrqAfterTheInstructionRunningAtItsCycle) {
+  // given:
+  WriteLoads();
+  SetVector(CPU::IRQ_VECTOR, 0x9000);
+  const InterruptController::Source Timer = irq.AddSource(Line::IRQ);
+  irq.Schedule(Timer, 5);
+
+  // when:
+  const ExecResult Result = irq.Run(cpu, 9, *mem);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::Cycles);
+  EXPECT_EQ(Result.cyclesUsed, 3 * 2 + InterruptController::INTERRUPT_CYCLES);
+  EXPECT_EQ(Result.instructions, 3u);
+  EXPECT_EQ(irq.Now(), 13u);
+  EXPECT_EQ(irq.irqsTaken, 1u);
+  EXPECT_EQ(irq.stretches, 1u);
+  EXPECT_EQ(cpu.programCounter, 0x9000);
+  EXPECT_EQ((*mem)[0x01FF], 0x80);
+  EXPECT_EQ((*mem)[0x01FE], 0x06);
+  EXPECT_EQ((*mem)[0x01FD], 0x22); // bit 5 and Z of LDA #$00, B clear
+  EXPECT_EQ(cpu.Flag.interruptDisable, 1);
+  EXPECT_FALSE(cpu.irqLine);
+}
+
+TEST_F(My6502InterruptTests, HoldsAMaskedIrqUntilCli) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_LDA_IMMEDIATE;
+  m[0x8001] = 0x01;
+  m[0x8002] = CPU::INS_LDA_IMMEDIATE;
+  m[0x8003] = 0x02;
+  m[0x8004] = CPU::INS_CLI;
+  m[0x8005] = CPU::INS_LDA_IMMEDIATE;
+  m[0x8006] = 0x03;
+  m[0x9000] = CPU::INS_LDX_IMMEDIATE;
+  m[0x9001] = 0x77;
+  m[0x9002] = 0x02; // KIL
+  SetVector(CPU::IRQ_VECTOR, 0x9000);
+  cpu.Flag.interruptDisable = 1;
+  const InterruptController::Source Device = irq.AddSource(Line::IRQ);
+  irq.Raise(Device);
+
+  // when:
+  const ExecResult Result = irq.Run(cpu, 100, m);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::Halt);
+  EXPECT_EQ(Result.address, 0x9002);
+  EXPECT_EQ(Result.cyclesUsed, 2 + 2 + 2 + InterruptController::INTERRUPT_CYCLES + 2);
+  EXPECT_EQ(Result.instructions, 4u);
+  EXPECT_EQ(irq.irqsTaken, 1u);
+  EXPECT_EQ(m[0x01FE], 0x05); // back to the instruction after CLI
+  EXPECT_EQ(cpu.accumulator, 0x02);
+  EXPECT_EQ(cpu.indexRegX, 0x77);
+  EXPECT_TRUE(irq.Raised(Device));
+}
+
+TEST_F(My6502InterruptTests, TakesAPeriodicNmiWhileIrqsAreMasked) {
+  // given:
+  WriteLoads();
+  (*mem)[0x9100] = CPU::INS_RTI;
+  SetVector(CPU::NMI_VECTOR, 0x9100);
+  cpu.Flag.interruptDisable = 1;
+  const InterruptController::Source Vblank = irq.AddSource(Line::NMI);
+  irq.Schedule(Vblank, 10, 100);
+
+  // when:
+  const ExecResult Result = irq.Run(cpu, 1000, *mem);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::Cycles);
+  EXPECT_EQ(irq.nmisTaken, 10u);
+  EXPECT_EQ(irq.irqsTaken, 0u);
+  EXPECT_LE(irq.stretches, 11u); // one per event, not one per instruction
+  EXPECT_EQ(cpu.stackPointer, 0xFF);
+  EXPECT_EQ(cpu.Flag.interruptDisable, 1);
+}
+
+namespace {
+  /** a timer that lets go of its IRQ when any of its registers is written **/
+  struct Timer {
+    my6502::InterruptController *irq;
+    my6502::InterruptController::Source source;
+    int acknowledged = 0;
+
+    static my6502::Byte Read(void *, my6502::Word) { return 0; }
+    static void Write(void *device, my6502::Word, my6502::Byte) {
+      Timer &timer = *static_cast<Timer *>(device);
+      timer.irq->Release(timer.source);
+      timer.acknowledged++;
+    }
+  };
+}
+
+TEST_F(My6502InterruptTests, ADeviceOnTheBusAcknowledgesItsIrq) {
+  // given:
+  WriteLoads();
+  Mem &m = *mem;
+  m[0x9000] = CPU::INS_STA_ABSOLUTE;
+  m[0x9001] = 0x00;
+  m[0x9002] = 0xD0;
+  m[0x9003] = CPU::INS_RTI;
+  SetVector(CPU::IRQ_VECTOR, 0x9000);
+  Timer timer{&irq, irq.AddSource(Line::IRQ)};
+  Bus bus{m};
+  bus.MapDevice(0xD0, 0xD0, &Timer::Read, &Timer::Write, &timer);
+  irq.Schedule(timer.source, 100, 100);
+
+  // when:
+  const ExecResult Result = irq.Run(cpu, 1000, bus);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::Cycles);
+  EXPECT_EQ(irq.irqsTaken, 9u);
+  EXPECT_EQ(timer.acknowledged, 9);
+  EXPECT_FALSE(irq.Raised(timer.source));
+  EXPECT_EQ(cpu.stackPointer, 0xFF);
+  EXPECT_EQ(cpu.Flag.interruptDisable, 0);
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_jit.h>
+#include "My6502RandomPrograms.h"
+#include <memory>
+#include <random>
+
+class My6502JitTests : public testing::Test {
+public:
+  using Byte = my6502::Byte;
+  using Word = my6502::Word;
+  using CPU  = my6502::CPU;
+  using Mem  = my6502::Mem;
+  using Jit  = my6502::Jit;
+  using s32  = my6502::s32;
+
+  // 64 KiB each, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  std::unique_ptr<Mem> interpretedMem = std::make_unique<Mem>();
+  CPU cpu{};
+  CPU interpreted{};
+  Jit jit;
+
+	virtual void SetUp() {
+		cpu.Reset(*mem); }
+  virtual void TearDown() { ; }
+
+  /** run the same budget through the JIT and the interpreter **/
+  void RunBothAndCompare(s32 cycles);
+};
+
+void My6502JitTests::RunBothAndCompare(s32 cycles) {
+  interpreted = cpu;
+  *interpretedMem = *mem;
+
+  const s32 CyclesUsed = jit.Execute(cpu, cycles, *mem);
+  const s32 InterpretedCycles = interpreted.Execute(cycles, *interpretedMem).cyclesUsed;
+
+  EXPECT_EQ(CyclesUsed, InterpretedCycles);
+  my6502test::VerifySameState(cpu, interpreted);
+  for (my6502::u32 address = 0; address < Mem::MAX_MEM; address++) {
+    ASSERT_EQ(mem->Data[address], interpretedMem->Data[address]) << "address " << address;
+  }
+}
+
+TEST_F(My6502JitTests, HotBlocksRunLikeTheInterpreter) {
+  // given:
+  std::mt19937 random(6502);
+  cpu.Reset(0x8000, *mem);
+  my6502test::WritePointers(random, *mem);
+  my6502test::WriteLoopingProgram(random, *mem, 20);
+
+  // when/then:
+  RunBothAndCompare(20000);
+  if (Jit::IsSupported()) {
+    EXPECT_GE(jit.blocksCompiled, 1u);
+    EXPECT_GT(jit.nativeBlocksRun, 0u);
+  }
+}
+
+TEST_F(My6502JitTests, RandomProgramsHaveNoDifferentialMismatches) {
+  std::mt19937 random(1975);
+  jit.differential = true;
+  for (int program = 0; program < 50; program++) {
+    // given:
+    cpu.Reset(0x8000, *mem);
+    cpu.indexRegX = static_cast<Byte>(random());
+    cpu.indexRegY = static_cast<Byte>(random());
+    my6502test::WritePointers(random, *mem);
+    my6502test::WriteLoopingProgram(random, *mem, 1 + random() % 40);
+
+    // when:
+    RunBothAndCompare(5000 + random() % 100);
+  }
+
+  // then:
+  EXPECT_EQ(jit.mismatches, 0u);
+}
+
+TEST_F(My6502JitTests, AHotBlockThatWritesOverItsOwnCodeRunsTheNewCode) {
+  // given:
+  cpu.Reset(0x8000, *mem);
+  cpu.accumulator = 0x42;
+  (*mem)[0x8000] = CPU::INS_LDX_ZEROPAGE;
+  (*mem)[0x8001] = 0x10;
+  (*mem)[0x8002] = CPU::INS_STA_ABSOLUTEX;
+  (*mem)[0x8003] = 0x80;
+  (*mem)[0x8004] = 0x7F;
+  (*mem)[0x8005] = CPU::INS_LDY_IMMEDIATE;
+  (*mem)[0x8006] = 0x00; // 0x7F80 + 0x86
+  (*mem)[0x8007] = CPU::INS_STY_ABSOLUTE;
+  (*mem)[0x8008] = 0x00;
+  (*mem)[0x8009] = 0x30;
+  (*mem)[0x800A] = CPU::INS_JSR;
+  (*mem)[0x800B] = 0x00;
+  (*mem)[0x800C] = 0x80;
+  (*mem)[0x0010] = 0x00; // STA writes 0x7F80 until the block is hot
+  jit.differential = true;
+  RunBothAndCompare(2000);
+
+  // when:
+  (*mem)[0x0010] = 0x86; // now STA writes the operand of LDY
+  RunBothAndCompare(2000);
+
+  // then:
+  EXPECT_EQ(jit.mismatches, 0u);
+  EXPECT_EQ((*mem)[0x3000], 0x42);
+}
+
+TEST_F(My6502JitTests, AHotCallToALeafRoutineThatWritesOverItselfRunsTheNewCode) {
+  // given:
+  cpu.Reset(0x8000, *mem);
+  (*mem)[0x8000] = CPU::INS_LDA_IMMEDIATE;
+  (*mem)[0x8001] = 0x42;
+  (*mem)[0x8002] = CPU::INS_JSR;
+  (*mem)[0x8003] = 0x00;
+  (*mem)[0x8004] = 0x90;
+  (*mem)[0x8005] = CPU::INS_STY_ABSOLUTE;
+  (*mem)[0x8006] = 0x00;
+  (*mem)[0x8007] = 0x30;
+  (*mem)[0x8008] = CPU::INS_JMP_ABSOLUTE;
+  (*mem)[0x8009] = 0x00;
+  (*mem)[0x800A] = 0x80;
+  // the leaf routine
+  (*mem)[0x9000] = CPU::INS_LDX_ZEROPAGE;
+  (*mem)[0x9001] = 0x10;
+  (*mem)[0x9002] = CPU::INS_STA_ABSOLUTEX;
+  (*mem)[0x9003] = 0x80;
+  (*mem)[0x9004] = 0x8F;
+  (*mem)[0x9005] = CPU::INS_LDY_IMMEDIATE;
+  (*mem)[0x9006] = 0x00; // 0x8F80 + 0x86
+  (*mem)[0x9007] = CPU::INS_RTS;
+  (*mem)[0x0010] = 0x00; // STA writes 0x8F80 until the call is hot
+  jit.differential = true;
+  RunBothAndCompare(2000);
+
+  // when:
+  (*mem)[0x0010] = 0x86; // now STA writes the operand of LDY
+  RunBothAndCompare(2000);
+
+  // then:
+  EXPECT_EQ(jit.mismatches, 0u);
+  EXPECT_EQ((*mem)[0x3000], 0x42);
+  if (Jit::IsSupported()) {
+    EXPECT_GT(jit.nativeBlocksRun, 0u);
+  }
+}
+
+TEST_F(My6502JitTests, HostWritesToHotCodeAreSeen) {
+  // given:
+  std::mt19937 random(7);
+  cpu.Reset(0x8000, *mem);
+  my6502test::WriteLoopingProgram(random, *mem, 5);
+  RunBothAndCompare(5000);
+
+  // when:
+  (*mem)[0x8001] = 0x99; // operand of the first instruction
+
+  // then:
+  RunBothAndCompare(5000);
+}
+
+TEST_F(My6502JitTests, StopsAtTheSameCycleAsTheInterpreter) {
+  std::mt19937 random(42);
+  cpu.Reset(0x8000, *mem);
+  my6502test::WriteLoopingProgram(random, *mem, 10);
+  for (s32 cycles = 1; cycles < 400; cycles += 7) {
+    RunBothAndCompare(cycles);
+  }
+}
+
+TEST_F(My6502JitTests, NativeCodeChargesAPageCrossingOnlyWhenTheHighByteChanges) {
+  // given: a hot loop over the three ways an index can meet a page boundary
+  const Byte Program[] = {
+    CPU::INS_LDX_IMMEDIATE, 0x01, CPU::INS_LDA_ABSX, 0xFF, 0x10,     // $1100, crosses
+    CPU::INS_LDX_IMMEDIATE, 0xFF, CPU::INS_LDA_ABSX, 0x00, 0x10,     // $10FF, does not
+    CPU::INS_LDX_IMMEDIATE, 0x90, CPU::INS_LDA_ABSX, 0x80, 0x10,     // $1110, crosses
+    CPU::INS_LDY_IMMEDIATE, 0xFF, CPU::INS_LDA_INDIRECTY, 0x20,      // $1000 + $FF, does not
+    CPU::INS_LDY_IMMEDIATE, 0x90, CPU::INS_LDA_INDIRECTY, 0x22,      // $1080 + $90, crosses
+    CPU::INS_JMP_ABSOLUTE, 0x00, 0x80,
+  };
+  cpu.Reset(0x8000, *mem);
+  for (Word i = 0; i < sizeof(Program); i++) {
+    (*mem)[0x8000 + i] = Program[i];
+  }
+  (*mem)[0x0021] = 0x10;          // $0020 -> $1000
+  (*mem)[0x0022] = 0x80;          // $0022 -> $1080
+  (*mem)[0x0023] = 0x10;
+
+  // when/then:
+  RunBothAndCompare(20000);
+  if (Jit::IsSupported()) {
+    EXPECT_GT(jit.nativeBlocksRun, 0u);
+  }
+}
@@ -4,6 +4,7 @@
 class My6502JumpsAndCallsTest : public testing::Test {
 public:
   using Byte   = my6502::Byte;
+  using Word   = my6502::Word;
   using CPU    = my6502::CPU;
   using Mem    = my6502::Mem;
   using s32    = my6502::s32;
@@ -30,7 +31,7 @@ TEST_F(My6502JumpsAndCallsTest, CanJumpToASubroutineAndJumpBackAgain) {
   constexpr s32 expected_cyles = 6 + 6 + 2;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
@@ -38,6 +39,25 @@ TEST_F(My6502JumpsAndCallsTest, CanJumpToASubroutineAndJumpBackAgain) {
 	EXPECT_EQ(cpu.stackPointer, CPUCopy.stackPointer);
 }
 
+TEST_F(My6502JumpsAndCallsTest, JSRPushesTheReturnAddressOntoPageOne) {
+  // given:
+  cpu.Reset(0xFF00, mem);
+  mem[0xFF00] = CPU::INS_JSR;
+  mem[0xFF01] = 0x00;
+  mem[0xFF02] = 0x80;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(6, mem).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, 6);
+  EXPECT_EQ(cpu.stackPointer, 0xFD);
+  EXPECT_EQ(mem[0x01FF], 0xFF); // the address of the last byte of JSR, high byte first
+  EXPECT_EQ(mem[0x01FE], 0x02);
+  EXPECT_EQ(mem[0x10FF], 0x00);
+  EXPECT_EQ(mem[0x10FE], 0x00);
+}
+
 TEST_F(My6502JumpsAndCallsTest, JSRDoesNotAffectTheProcessorStatus) {
   CPU CPUCopy = cpu;
   cpu.Reset(0xFF00, mem);
@@ -47,9 +67,59 @@ TEST_F(My6502JumpsAndCallsTest, JSRDoesNotAffectTheProcessorStatus) {
   constexpr s32 expected_cyles = 6;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
 	EXPECT_EQ(cpu.processorStatus, CPUCopy.processorStatus);
 }
+
+TEST_F(My6502JumpsAndCallsTest, JMPContinuesAtItsOperand) {
+  // given:
+  cpu.Reset(0xFF00, mem);
+  mem[0xFF00] = CPU::INS_JMP_ABSOLUTE;
+  mem[0xFF01] = 0x00;
+  mem[0xFF02] = 0x80;
+  mem[0x8000] = CPU::INS_LDA_IMMEDIATE;
+  mem[0x8001] = 0x69;
+  constexpr s32 expected_cyles = 3 + 2;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, expected_cyles);
+  EXPECT_EQ(cpu.accumulator, 0x69);
+  EXPECT_EQ(cpu.programCounter, 0x8002);
+}
+
+TEST_F(My6502JumpsAndCallsTest, BranchesTakeACycleMoreWhenTakenAndTwoAcrossAPage) {
+  struct Case { Byte opcode; Byte loaded; Word at; Byte offset; Word expectedPC; s32 expectedCycles; };
+  const Case Cases[] = {
+    {CPU::INS_BEQ, 0x00, 0x8000, 0x10, 0x8014, 2 + 3},      // taken forward
+    {CPU::INS_BEQ, 0x01, 0x8000, 0x10, 0x8004, 2 + 2},      // not taken
+    {CPU::INS_BNE, 0x01, 0x8000, 0xFC, 0x8000, 2 + 3},      // taken back to the load
+    {CPU::INS_BMI, 0x80, 0x80F0, 0x20, 0x8114, 2 + 4},      // taken onto the next page
+    {CPU::INS_BPL, 0x80, 0x80F0, 0x20, 0x80F4, 2 + 2},
+    {CPU::INS_BPL, 0x7F, 0x8010, 0xE0, 0x7FF4, 2 + 4},      // back onto the page before
+    {CPU::INS_BCC, 0x00, 0x8000, 0x02, 0x8006, 2 + 3},      // carry and overflow are clear
+    {CPU::INS_BCS, 0x00, 0x8000, 0x02, 0x8004, 2 + 2},
+    {CPU::INS_BVC, 0x00, 0x8000, 0x02, 0x8006, 2 + 3},
+    {CPU::INS_BVS, 0x00, 0x8000, 0x02, 0x8004, 2 + 2},
+  };
+  for (const Case &c : Cases) {
+    // given:
+    cpu.Reset(c.at, mem);
+    mem[c.at] = CPU::INS_LDA_IMMEDIATE;
+    mem[c.at + 1] = c.loaded;
+    mem[c.at + 2] = c.opcode;
+    mem[c.at + 3] = c.offset;
+
+    // when:
+    const s32 CyclesUsed = cpu.Execute(c.expectedCycles, mem).cyclesUsed;
+
+    // then:
+    EXPECT_EQ(CyclesUsed, c.expectedCycles) << "opcode " << int{c.opcode} << " at " << c.at;
+    EXPECT_EQ(cpu.programCounter, c.expectedPC) << "opcode " << int{c.opcode} << " at " << c.at;
+  }
+}
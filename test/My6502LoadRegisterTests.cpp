@@ -50,7 +50,7 @@ TEST_F(My6502LoadRegisterTests, CPUDoesNothingWhenWeExecuteZeroCycles) {
   constexpr s32 num_cycles = 0;
 
   // when:
-  s32 CyclesUsed = cpu.Execute(num_cycles, mem);
+  s32 CyclesUsed = cpu.Execute(num_cycles, mem).cyclesUsed;
 
   // then
 	EXPECT_EQ(CyclesUsed, 0);
@@ -62,7 +62,7 @@ TEST_F(My6502LoadRegisterTests, CPUCanExecuteMoreCyclesThanRequestedIfRequiredBy
 	mem[0XFFFD] = 0x84;
 
 	// when:
-	s32 CyclesUsed = cpu.Execute(1, mem); // immediate(2)
+	s32 CyclesUsed = cpu.Execute(1, mem).cyclesUsed; // immediate(2)
 
 	// then:
 	EXPECT_EQ(CyclesUsed, 2);
@@ -75,7 +75,7 @@ void My6502LoadRegisterTests::TestLoadRegisterImmediate(Byte OpcodeToTest, RegPt
 
 	// when:
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(2, mem);
+	s32 CyclesUsed = cpu.Execute(2, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x84);
@@ -105,7 +105,7 @@ TEST_F(My6502LoadRegisterTests, LDAImmediateCanAffectTheZeroFlag) {
 
 	// when:
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(2, mem);
+	s32 CyclesUsed = cpu.Execute(2, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.accumulator, 0x0);
@@ -125,7 +125,7 @@ void My6502LoadRegisterTests::TestLoadRegisterZeroPage(Byte OpcodeToTest, RegPtr
 
 	// when:
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(3, mem); 
+	s32 CyclesUsed = cpu.Execute(3, mem).cyclesUsed; 
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x69);
@@ -158,7 +158,7 @@ void My6502LoadRegisterTests::TestLoadRegisterZeroPageX(Byte OpcodeToTest, RegPt
 
 	// when:
 	CPU CPUCopy = cpu;  
-	s32 CyclesUsed = cpu.Execute(4, mem);
+	s32 CyclesUsed = cpu.Execute(4, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x69);
@@ -179,7 +179,7 @@ void My6502LoadRegisterTests::TestLoadRegisterZeroPageY(Byte OpcodeToTest, RegPt
 
 	// when:
 	CPU CPUCopy = cpu;  
-	s32 CyclesUsed = cpu.Execute(4, mem);
+	s32 CyclesUsed = cpu.Execute(4, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x69);
@@ -213,7 +213,7 @@ TEST_F(My6502LoadRegisterTests, LDAZeroPageXCanLoadAValueIntoTheARegisterWhenItW
 
 	// when:
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(4, mem);
+	s32 CyclesUsed = cpu.Execute(4, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.accumulator, 0x69);
@@ -233,7 +233,7 @@ void My6502LoadRegisterTests::TestLoadRegisterAbsolute(Byte OpcodeToTest, RegPtr
 	// when:
 	constexpr s32 expected_cycles = 4;
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(expected_cycles, mem);
+	s32 CyclesUsed = cpu.Execute(expected_cycles, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x69);
@@ -270,7 +270,7 @@ void My6502LoadRegisterTests::TestLoadRegisterAbsoluteX(Byte OpcodeToTest, RegPt
 	// when:
 	constexpr s32 expected_cycles = 4;
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(expected_cycles, mem);
+	s32 CyclesUsed = cpu.Execute(expected_cycles, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x69);
@@ -292,7 +292,7 @@ void My6502LoadRegisterTests::TestLoadRegisterAbsoluteY(Byte OpcodeToTest, RegPt
 	// when:
 	constexpr s32 expected_cycles = 4;
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(expected_cycles, mem);
+	s32 CyclesUsed = cpu.Execute(expected_cycles, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x69);
@@ -329,7 +329,7 @@ void My6502LoadRegisterTests::TestLoadRegisterAbsoluteXWhenCrossingPage(Byte Opc
 	// when:
 	constexpr s32 expected_cycles = 5;
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(expected_cycles, mem);
+	s32 CyclesUsed = cpu.Execute(expected_cycles, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x69);
@@ -349,6 +349,34 @@ TEST_F(My6502LoadRegisterTests, LDYAbsoluteXLoadAValueIntoTheYRegisterWhenItCros
   TestLoadRegisterAbsoluteXWhenCrossingPage(CPU::INS_LDY_ABSX, &CPU::indexRegY);
 }
 
+TEST_F(My6502LoadRegisterTests, LDAAbsoluteXCrossesAPageOnlyWhenTheHighByteChanges) {
+  struct Case {
+    my6502::Word base;
+    Byte x;
+    s32 cycles;
+  };
+  const Case Cases[] = {
+    {0x10FF, 0x01, 5}, // $1100, the next page
+    {0x1000, 0xFF, 4}, // $10FF, the same page
+    {0x1080, 0x90, 5}, // $1110, the next page
+  };
+  for (const Case &c : Cases) {
+    // given:
+    cpu.Reset(mem);
+    cpu.indexRegX = c.x;
+    mem[0xFFFC] = CPU::INS_LDA_ABSX;
+    mem[0xFFFD] = static_cast<Byte>(c.base);
+    mem[0xFFFE] = static_cast<Byte>(c.base >> 8);
+
+    // when:
+    const s32 CyclesUsed = cpu.Execute(1, mem).cyclesUsed;
+
+    // then:
+    SCOPED_TRACE(c.base);
+    EXPECT_EQ(CyclesUsed, c.cycles);
+  }
+}
+
 TEST_F(My6502LoadRegisterTests, LDAAbsoluteYLoadAValueIntoTheARegister) {
   // given:
   TestLoadRegisterAbsoluteY(CPU::INS_LDA_ABSY, &CPU::accumulator);
@@ -365,7 +393,7 @@ void My6502LoadRegisterTests::TestLoadRegisterAbsoluteYWhenCrossingPage(Byte Opc
 	// when:
 	constexpr s32 expected_cycles = 5;
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(expected_cycles, mem);
+	s32 CyclesUsed = cpu.Execute(expected_cycles, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.*RegisterToTest, 0x69);
@@ -396,7 +424,7 @@ TEST_F(My6502LoadRegisterTests, LDAIndirectXCanLoadAValueIntoTheARegister) {
 	// when:
 	constexpr s32 expected_cycles = 6;
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(expected_cycles, mem);
+	s32 CyclesUsed = cpu.Execute(expected_cycles, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.accumulator, 0x30);
@@ -419,7 +447,7 @@ TEST_F(My6502LoadRegisterTests, LDAIndirectYCanLoadAValueIntoTheARegister) {
 	// when:
 	constexpr s32 expected_cycles = 5;
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(expected_cycles, mem);
+	s32 CyclesUsed = cpu.Execute(expected_cycles, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.accumulator, 0x69);
@@ -441,7 +469,7 @@ TEST_F(My6502LoadRegisterTests, LDAIndirectYCanLoadAValueIntoTheARegisterWhenItC
 	// when:
 	constexpr s32 expected_cycles = 6;
 	CPU CPUCopy = cpu;
-	s32 CyclesUsed = cpu.Execute(expected_cycles, mem);
+	s32 CyclesUsed = cpu.Execute(expected_cycles, mem).cyclesUsed;
 
 	// then:
 	EXPECT_EQ(cpu.accumulator, 0x69);
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <cstring>
+#include <memory>
+
+class My6502MemTests : public testing::Test {
+public:
+  using Byte = my6502::Byte;
+  using CPU  = my6502::CPU;
+  using Mem  = my6502::Mem;
+  using s32  = my6502::s32;
+  using u32  = my6502::u32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+
+	virtual void SetUp() { ; }
+  virtual void TearDown() { ; }
+
+  static void VerifyZeroed(const Mem &memory) {
+    for (u32 address = 0; address < Mem::MAX_MEM; address++) {
+      ASSERT_EQ(memory.Data[address], 0) << "address " << address;
+    }
+  }
+};
+
+TEST_F(My6502MemTests, FirstResetClearsEveryPage) {
+  // given:
+  memset(mem->Data, 0xA5, Mem::MAX_MEM);
+
+  // when:
+  cpu.Reset(*mem);
+
+  // then:
+  VerifyZeroed(*mem);
+}
+
+TEST_F(My6502MemTests, ResetClearsThePagesWrittenSinceTheLastReset) {
+  // given:
+  cpu.Reset(*mem);
+  (*mem)[0x0000] = 0x01;
+  (*mem)[0x12FF] = 0x02;
+  (*mem)[0xFFFF] = 0x03;
+  s32 cycles = 10;
+  cpu.WriteWord(0x4242, 0x8000, cycles, *mem);
+
+  // when:
+  cpu.Reset(*mem);
+
+  // then:
+  VerifyZeroed(*mem);
+}
+
+TEST_F(My6502MemTests, ResetOnlyTouchesTheWrittenPages) {
+  // given:
+  cpu.Reset(*mem);
+  u32 versions[Mem::NUM_PAGES];
+  memcpy(versions, mem->pageVersion, sizeof(versions));
+  (*mem)[0x3456] = 0x01;
+
+  // when:
+  cpu.Reset(*mem);
+
+  // then:
+  for (u32 page = 0; page < Mem::NUM_PAGES; page++) {
+    if (page == 0x34) {
+      EXPECT_NE(mem->pageVersion[page], versions[page]);
+    } else {
+      EXPECT_EQ(mem->pageVersion[page], versions[page]) << "page " << page;
+    }
+  }
+}
+
+TEST_F(My6502MemTests, CopiesClearWhatTheOriginalWrote) {
+  // given:
+  cpu.Reset(*mem);
+  (*mem)[0x2000] = 0x01;
+  auto copy = std::make_unique<Mem>(*mem);
+  (*copy)[0x7000] = 0x02;
+
+  // when:
+  cpu.Reset(*copy);
+
+  // then:
+  VerifyZeroed(*copy);
+  EXPECT_EQ(mem->Data[0x2000], 0x01);
+}
+
+TEST_F(My6502MemTests, ReadingThroughOperatorIndexIsNoWrite) {
+  // given:
+  cpu.Reset(*mem);
+  (*mem)[0x5000] = 0x42;
+  u32 versions[Mem::NUM_PAGES];
+  memcpy(versions, mem->pageVersion, sizeof(versions));
+
+  // when:
+  const Byte Read = (*mem)[0x5000];
+  (*mem)[0x6000] = (*mem)[0x5000];
+
+  // then:
+  EXPECT_EQ(Read, 0x42);
+  EXPECT_EQ(mem->Data[0x6000], 0x42);
+  for (u32 page = 0; page < Mem::NUM_PAGES; page++) {
+    if (page == 0x60) {
+      EXPECT_NE(mem->pageVersion[page], versions[page]);
+    } else {
+      EXPECT_EQ(mem->pageVersion[page], versions[page]) << "page " << page;
+    }
+  }
+}
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_opcodes.h>
+
+class My6502OpcodeTableTests : public testing::Test {
+public:
+  using Byte       = my6502::Byte;
+  using CPU        = my6502::CPU;
+  using Mem        = my6502::Mem;
+  using s32        = my6502::s32;
+  using PageCross  = CPU::PageCross;
+  using Mnemonic   = my6502::Mnemonic;
+  using Info       = my6502::OpcodeInfo;
+  using ExecResult = my6502::ExecResult;
+  using StopReason = my6502::StopReason;
+
+  Mem mem{};
+  CPU cpu{};
+
+	virtual void SetUp() {
+		cpu.Reset(mem); }
+  virtual void TearDown() { ; }
+};
+
+TEST_F(My6502OpcodeTableTests, HandledOpcodesTakeTheirBaseCycles) {
+  for (int Ins = 0; Ins < 256; Ins++) {
+    const CPU::Opcode &op = CPU::Decode(static_cast<Byte>(Ins));
+    if (op.cycles == 0 || op.pageCross == PageCross::Branch) { // see My6502JumpsAndCallsTests
+      continue;
+    }
+    // given:
+    cpu.Reset(mem);
+    mem[0xFFFC] = static_cast<Byte>(Ins);
+
+    // when:
+    const s32 CyclesUsed = cpu.Execute(1, mem).cyclesUsed;
+
+    // then:
+    EXPECT_EQ(CyclesUsed, op.cycles) << "opcode " << Ins;
+  }
+}
+
+TEST_F(My6502OpcodeTableTests, PageCrossingOpcodesTakeOneMoreCycleWhenTheyCross) {
+  for (int Ins = 0; Ins < 256; Ins++) {
+    const CPU::Opcode &op = CPU::Decode(static_cast<Byte>(Ins));
+    if (op.cycles == 0 || op.pageCross == PageCross::Branch) { // see My6502JumpsAndCallsTests
+      continue;
+    }
+    // given:
+    cpu.Reset(mem);
+    cpu.indexRegX = cpu.indexRegY = 0xFF;
+    mem[0xFFFC] = static_cast<Byte>(Ins);
+    mem[0xFFFD] = 0x02;
+    mem[0xFFFE] = 0x44; // 0x4402+0xFF crosses page boundary
+    mem[0x0002] = 0x02;
+    mem[0x0003] = 0x80; // 0x8002+0xFF crosses page boundary
+
+    // when:
+    const s32 CyclesUsed = cpu.Execute(1, mem).cyclesUsed;
+
+    // then:
+    const s32 expected_cycles = op.cycles + (op.pageCross == PageCross::OnCross ? 1 : 0);
+    EXPECT_EQ(CyclesUsed, expected_cycles) << "opcode " << Ins;
+  }
+}
+
+TEST_F(My6502OpcodeTableTests, UnhandledOpcodesHaveNoCycles) {
+  // 0x02 is one of the 6502 opcodes that jams the processor
+  EXPECT_EQ(CPU::Decode(0x02).cycles, 0);
+}
+
+TEST_F(My6502OpcodeTableTests, UnhandledOpcodesStopTheRunInFrontOfThem) {
+  // given:
+  mem[0xFFFC] = CPU::INS_LDA_IMMEDIATE;
+  mem[0xFFFD] = 0x42;
+  mem[0xFFFE] = 0x69; // ADC #, no handler yet
+
+  // when:
+  const ExecResult Result = cpu.Execute(100, mem);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::IllegalOpcode);
+  EXPECT_EQ(Result.address, 0xFFFE);
+  EXPECT_EQ(Result.cyclesUsed, 2);
+  EXPECT_EQ(Result.instructions, 1u);
+  EXPECT_EQ(cpu.programCounter, 0xFFFE);
+  EXPECT_EQ(cpu.accumulator, 0x42);
+}
+
+TEST_F(My6502OpcodeTableTests, KilOpcodesHaltTheRun) {
+  for (const Byte Ins : {0x02, 0x12, 0x22, 0x32, 0x42, 0x52, 0x62, 0x72, 0x92, 0xB2, 0xD2, 0xF2}) {
+    // given:
+    cpu.Reset(mem);
+    mem[0xFFFC] = Ins;
+
+    // when:
+    const ExecResult Result = cpu.Execute(100, mem);
+
+    // then:
+    EXPECT_EQ(Result.reason, StopReason::Halt) << "opcode " << int{Ins};
+    EXPECT_EQ(Result.cyclesUsed, 0);
+    EXPECT_EQ(cpu.programCounter, 0xFFFC);
+  }
+}
+
+TEST_F(My6502OpcodeTableTests, TheDocumentedOpcodesAreValid) {
+  int valid = 0;
+  for (const Info &info : my6502::OpcodeInfoTable) {
+    valid += info.Valid() ? 1 : 0;
+  }
+  EXPECT_EQ(valid, 151);
+  EXPECT_FALSE(my6502::OpcodeInfoTable[0x02].Valid());
+  EXPECT_EQ(my6502::OpcodeInfoTable[CPU::INS_LDA_INDIRECTY].mnemonic, Mnemonic::LDA);
+}
+
+TEST_F(My6502OpcodeTableTests, HandledOpcodesDecodeToTheirInfo) {
+  for (int Ins = 0; Ins < 256; Ins++) {
+    const CPU::Opcode &op = CPU::Decode(static_cast<Byte>(Ins));
+    if (op.cycles == 0) {
+      continue;
+    }
+    const Info &info = my6502::OpcodeInfoTable[Ins];
+    EXPECT_TRUE(info.Valid()) << "opcode " << Ins;
+    EXPECT_EQ(op.mode, info.mode) << "opcode " << Ins;
+    EXPECT_EQ(op.cycles, info.cycles) << "opcode " << Ins;
+    EXPECT_EQ(op.pageCross, info.pageCross) << "opcode " << Ins;
+  }
+}
+
+TEST_F(My6502OpcodeTableTests, HandledOpcodesAdvanceThePCByTheirLength) {
+  for (int Ins = 0; Ins < 256; Ins++) {
+    const Info &info = my6502::OpcodeInfoTable[Ins];
+    if (CPU::Decode(static_cast<Byte>(Ins)).cycles == 0
+        || info.mnemonic == Mnemonic::JSR || info.mnemonic == Mnemonic::RTS
+        || info.mnemonic == Mnemonic::BRK || info.mnemonic == Mnemonic::RTI
+        || info.mnemonic == Mnemonic::JMP) {
+      continue;
+    }
+    // given:
+    cpu.Reset(mem);
+    mem[0xFFF0] = static_cast<Byte>(Ins);
+    cpu.programCounter = 0xFFF0;
+
+    // when:
+    cpu.Execute(1, mem);
+
+    // then:
+    EXPECT_EQ(cpu.programCounter, 0xFFF0 + info.bytes) << "opcode " << Ins;
+  }
+}
+
+TEST_F(My6502OpcodeTableTests, DisassemblesEveryAddressingMode) {
+  // given:
+  const Byte program[][3] = {
+    {0xA9, 0x12, 0x00}, {0xB5, 0x12, 0x00}, {0xB6, 0x12, 0x00},
+    {0xBD, 0x34, 0x12}, {0xA1, 0x20, 0x00}, {0xB1, 0x20, 0x00},
+    {0x6C, 0x34, 0x12}, {0x0A, 0x00, 0x00}, {0xD0, 0xFE, 0x00},
+    {0xEA, 0x00, 0x00}, {0x02, 0x00, 0x00},
+  };
+  const char *expected[] = {
+    "LDA #$12", "LDA $12,X", "LDX $12,Y",
+    "LDA $1234,X", "LDA ($20,X)", "LDA ($20),Y",
+    "JMP ($1234)", "ASL A", "BNE $8000",
+    "NOP", ".byte $02",
+  };
+
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+    // when:
+    const std::string text = my6502::Disassemble(0x8000, program[i]);
+
+    // then:
+    EXPECT_EQ(text, expected[i]);
+  }
+}
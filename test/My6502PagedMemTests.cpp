@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_paged.h>
+#include "My6502RandomPrograms.h"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+class My6502PagedMemTests : public testing::Test {
+public:
+  using Byte     = my6502::Byte;
+  using Word     = my6502::Word;
+  using CPU      = my6502::CPU;
+  using Mem      = my6502::Mem;
+  using PagedMem = my6502::PagedMem;
+  using s32      = my6502::s32;
+  using u32      = my6502::u32;
+
+  PagedMem mem;
+  CPU cpu{};
+  // 64 KiB each, kept off the stack
+  std::unique_ptr<Mem> flat = std::make_unique<Mem>();
+  std::unique_ptr<Mem> contents = std::make_unique<Mem>();
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, mem); }
+  virtual void TearDown() { ; }
+};
+
+TEST_F(My6502PagedMemTests, ResetMemoryReadsAsZero) {
+  // given:
+  mem[0x1234] = 0x42;
+
+  // when:
+  cpu.Reset(0x8000, mem);
+
+  // then:
+  mem.CopyTo(*contents);
+  for (u32 address = 0; address < Mem::MAX_MEM; address++) {
+    ASSERT_EQ(contents->Data[address], 0) << "address " << address;
+  }
+}
+
+TEST_F(My6502PagedMemTests, ForkSharesEveryPageUntilItIsWritten) {
+  // given:
+  mem[0x0200] = 0x11;
+  mem[0x0300] = 0x22;
+
+  // when:
+  PagedMem child = mem.Fork();
+  child[0x0201] = 0x33;
+
+  // then:
+  for (u32 page = 0; page < PagedMem::NUM_PAGES; page++) {
+    EXPECT_EQ(child.SharesPage(mem, page), page != 0x02) << "page " << page;
+  }
+  const PagedMem &parent = mem;
+  EXPECT_EQ(child[0x0200], 0x11);
+  EXPECT_EQ(child[0x0201], 0x33);
+  EXPECT_EQ(parent[0x0201], 0x00);
+  EXPECT_EQ(parent[0x0300], 0x22);
+}
+
+TEST_F(My6502PagedMemTests, WritesToTheParentAreNotSeenByTheFork) {
+  // given:
+  mem[0x4000] = 0x01;
+  const PagedMem child = mem.Fork();
+
+  // when:
+  mem[0x4000] = 0x02;
+  mem.Initialize();
+
+  // then:
+  EXPECT_EQ(child[0x4000], 0x01);
+  EXPECT_EQ(static_cast<const PagedMem &>(mem)[0x4000], 0x00);
+}
+
+TEST_F(My6502PagedMemTests, ProgramsRunLikeOnFlatMemory) {
+  std::mt19937 random(65);
+  for (int program = 0; program < 20; program++) {
+    // given:
+    cpu.Reset(0x8000, *flat);
+    cpu.indexRegX = static_cast<Byte>(random());
+    cpu.indexRegY = static_cast<Byte>(random());
+    my6502test::WritePointers(random, *flat);
+    my6502test::WriteLoopingProgram(random, *flat, 1 + random() % 30);
+    PagedMem paged(*flat);
+    CPU pagedCpu = cpu;
+
+    // when:
+    const s32 CyclesUsed = cpu.Execute(2000, *flat).cyclesUsed;
+    const s32 PagedCyclesUsed = pagedCpu.Execute(2000, paged).cyclesUsed;
+
+    // then:
+    EXPECT_EQ(PagedCyclesUsed, CyclesUsed);
+    my6502test::VerifySameState(pagedCpu, cpu);
+    paged.CopyTo(*contents);
+    ASSERT_EQ(std::memcmp(contents->Data, flat->Data, Mem::MAX_MEM), 0) << "program " << program;
+  }
+}
+
+TEST_F(My6502PagedMemTests, ForkedMachinesBranchFromTheSameState) {
+  // given:
+  mem[0x8000] = CPU::INS_LDA_ZEROPAGE;
+  mem[0x8001] = 0x10;
+  mem[0x8002] = CPU::INS_STA_ABSOLUTE;
+  mem[0x8003] = 0x00;
+  mem[0x8004] = 0x30;
+  mem[0x0010] = 0x01;
+
+  // when:
+  std::vector<PagedMem> forks;
+  for (Byte value = 0; value < 8; value++) {
+    forks.push_back(mem.Fork());
+    forks.back()[0x0010] = value;
+    CPU child = cpu;
+    child.Execute(3 + 4, forks.back());
+  }
+
+  // then:
+  for (Byte value = 0; value < 8; value++) {
+    const PagedMem &fork = forks[value];
+    EXPECT_EQ(fork[0x3000], value);
+    EXPECT_TRUE(fork.SharesPage(mem, 0x80));
+  }
+  EXPECT_EQ(static_cast<const PagedMem &>(mem)[0x3000], 0x00);
+}
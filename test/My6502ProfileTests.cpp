@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_profile.h>
+#include <memory>
+
+class My6502ProfileTests : public testing::Test {
+public:
+  using Byte        = my6502::Byte;
+  using Word        = my6502::Word;
+  using CPU         = my6502::CPU;
+  using Mem         = my6502::Mem;
+  using NullProfile = my6502::NullProfile;
+  using Profile     = my6502::Profile;
+  using SequenceProfile = my6502::SequenceProfile;
+  using s32         = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+  Profile profile;
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { ; }
+};
+
+TEST_F(My6502ProfileTests, CountsEveryInstructionByOpcodeAndAddress) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_JSR;
+  m[0x8001] = 0x00;
+  m[0x8002] = 0x90;
+  m[0x8003] = CPU::INS_JSR;
+  m[0x8004] = 0x00;
+  m[0x8005] = 0x90;
+  m[0x9000] = CPU::INS_LDA_IMMEDIATE;
+  m[0x9001] = 0x42;
+  m[0x9002] = CPU::INS_RTS;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(2 * (6 + 2 + 6), m, profile).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, 2 * (6 + 2 + 6));
+  EXPECT_EQ(profile.Instructions(), 6u);
+  EXPECT_EQ(profile.opcodes[CPU::INS_JSR], 2u);
+  EXPECT_EQ(profile.opcodes[CPU::INS_LDA_IMMEDIATE], 2u);
+  EXPECT_EQ(profile.opcodes[CPU::INS_RTS], 2u);
+  EXPECT_EQ(profile.addresses[0x8000], 1u);
+  EXPECT_EQ(profile.addresses[0x8003], 1u);
+  EXPECT_EQ(profile.addresses[0x9000], 2u);
+  EXPECT_EQ(profile.addresses[0x9002], 2u);
+  const auto Hottest = profile.Hottest(2);
+  ASSERT_EQ(Hottest.size(), 2u);
+  EXPECT_EQ(Hottest[0].first, 0x9000);
+  EXPECT_EQ(Hottest[1].first, 0x9002);
+}
+
+TEST_F(My6502ProfileTests, CountsOnlyThePageCrossingsThatCostACycle) {
+  // given:
+  Mem &m = *mem;
+  cpu.indexRegX = 0xFF;
+  cpu.indexRegY = 0x01;
+  m[0x8000] = CPU::INS_LDA_ABSX;      // 0x2080 + 0xFF crosses, one more cycle
+  m[0x8001] = 0x80;
+  m[0x8002] = 0x20;
+  m[0x8003] = CPU::INS_STA_ABSOLUTEX; // crosses too, always 5 cycles
+  m[0x8004] = 0x80;
+  m[0x8005] = 0x20;
+  m[0x8006] = CPU::INS_LDA_ABSY;      // 0x2000 + 0x01 stays on the page
+  m[0x8007] = 0x00;
+  m[0x8008] = 0x20;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(5 + 5 + 4, m, profile).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, 5 + 5 + 4);
+  EXPECT_EQ(profile.pageCrosses[CPU::INS_LDA_ABSX], 1u);
+  EXPECT_EQ(profile.pageCrosses[CPU::INS_STA_ABSOLUTEX], 0u);
+  EXPECT_EQ(profile.pageCrosses[CPU::INS_LDA_ABSY], 0u);
+}
+
+TEST_F(My6502ProfileTests, CountsReadsAndWritesPerPage) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_LDA_ABS;
+  m[0x8001] = 0x34;
+  m[0x8002] = 0x12;
+  m[0x8003] = CPU::INS_STA_ABSOLUTE;
+  m[0x8004] = 0x00;
+  m[0x8005] = 0x30;
+  m[0x1234] = 0x99;
+
+  // when:
+  cpu.Execute(4 + 4, m, profile);
+
+  // then:
+  EXPECT_EQ(profile.pageReads[0x80], 6u); // both instructions are 3 bytes
+  EXPECT_EQ(profile.pageReads[0x12], 1u);
+  EXPECT_EQ(profile.pageWrites[0x30], 1u);
+  EXPECT_EQ(profile.pageWrites[0x12], 0u);
+  EXPECT_EQ(m[0x3000], 0x99);
+}
+
+TEST_F(My6502ProfileTests, NullProfileRunsLikeThePlainInterpreter) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_LDX_IMMEDIATE;
+  m[0x8001] = 0x80;
+  m[0x8002] = CPU::INS_STX_ZEROPAGE;
+  m[0x8003] = 0x10;
+  CPU plain = cpu;
+  auto plainMem = std::make_unique<Mem>(m);
+  NullProfile none;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(2 + 3, m, none).cyclesUsed;
+  const s32 PlainCyclesUsed = plain.Execute(2 + 3, *plainMem).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, PlainCyclesUsed);
+  EXPECT_EQ(cpu.programCounter, plain.programCounter);
+  EXPECT_EQ(cpu.indexRegX, plain.indexRegX);
+  EXPECT_EQ(cpu.processorStatus, plain.processorStatus);
+  EXPECT_EQ(m[0x0010], (*plainMem)[0x0010]);
+}
+
+TEST_F(My6502ProfileTests, CountsOpcodePairsAndLeafCalls) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_LDA_IMMEDIATE;
+  m[0x8001] = 0x01;
+  m[0x8002] = CPU::INS_STA_ZEROPAGE;
+  m[0x8003] = 0x40;
+  m[0x8004] = CPU::INS_JSR;
+  m[0x8005] = 0x00;
+  m[0x8006] = 0x90;
+  m[0x8007] = CPU::INS_JSR; // not a leaf, it calls on
+  m[0x8008] = 0x10;
+  m[0x8009] = 0x90;
+  m[0x800A] = 0x02; // KIL
+  m[0x9000] = CPU::INS_LDY_IMMEDIATE;
+  m[0x9001] = 0x01;
+  m[0x9002] = CPU::INS_RTS;
+  m[0x9010] = CPU::INS_JSR;
+  m[0x9011] = 0x00;
+  m[0x9012] = 0x90;
+  m[0x9013] = CPU::INS_RTS;
+  SequenceProfile sequences;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(2 + 3 + 2 * (6 + 2 + 6) + 6 + 6, m, sequences).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, 2 + 3 + 2 * (6 + 2 + 6) + 6 + 6);
+  EXPECT_EQ(sequences.instructions, 10u);
+  EXPECT_EQ(sequences.pairs[(CPU::INS_LDA_IMMEDIATE << 8) | CPU::INS_STA_ZEROPAGE], 1u);
+  EXPECT_EQ(sequences.pairs[(CPU::INS_LDY_IMMEDIATE << 8) | CPU::INS_RTS], 2u);
+  EXPECT_EQ(sequences.pairs[(CPU::INS_RTS << 8) | CPU::INS_RTS], 1u);
+  EXPECT_EQ(sequences.leafCalls, 2u);
+}
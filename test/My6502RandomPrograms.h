@@ -0,0 +1,93 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_opcodes.h>
+#include <iterator>
+#include <random>
+#include <vector>
+
+/** Random programs the engine tests run against CPU::Execute. Operands
+ *  of absolute instructions and the pointers in the zero page point
+ *  into data at 0x2000-0x60FF, well below the code at 0x8000. **/
+namespace my6502test {
+  using Byte = my6502::Byte;
+  using Word = my6502::Word;
+  using CPU  = my6502::CPU;
+  using Mem  = my6502::Mem;
+
+  static const Byte Loads[] = {
+    CPU::INS_LDA_IMMEDIATE, CPU::INS_LDA_ZEROPAGE, CPU::INS_LDA_ZEROPX, CPU::INS_LDA_ABS,
+    CPU::INS_LDA_ABSX, CPU::INS_LDA_ABSY, CPU::INS_LDA_INDIRECTX, CPU::INS_LDA_INDIRECTY,
+    CPU::INS_LDX_IMMEDIATE, CPU::INS_LDX_ZEROPAGE, CPU::INS_LDX_ZEROPY, CPU::INS_LDX_ABS,
+    CPU::INS_LDX_ABSY, CPU::INS_LDY_IMMEDIATE, CPU::INS_LDY_ZEROPAGE, CPU::INS_LDY_ZEROPX,
+    CPU::INS_LDY_ABS, CPU::INS_LDY_ABSX};
+  static const Byte Stores[] = {
+    CPU::INS_STA_ZEROPAGE, CPU::INS_STA_ZEROPAGEX, CPU::INS_STA_ABSOLUTE, CPU::INS_STA_ABSOLUTEX,
+    CPU::INS_STA_ABSOLUTEY, CPU::INS_STA_INDIRECTX, CPU::INS_STA_INDIRECTY, CPU::INS_STX_ZEROPAGE,
+    CPU::INS_STX_ABSOLUTE, CPU::INS_STY_ZEROPAGE, CPU::INS_STY_ZEROPAGEX, CPU::INS_STY_ABSOLUTE};
+
+  /** the high byte of an absolute operand or of a pointer **/
+  inline Byte DataPage(std::mt19937 &random) {
+    return static_cast<Byte>(0x20 + random() % 0x40);
+  }
+
+  /** ins and its operand at address, returns the address after them **/
+  inline Word WriteInstruction(std::mt19937 &random, Mem &memory, Word address, Byte ins) {
+    const Byte Length = my6502::OpcodeInfoTable[ins].bytes;
+    memory[address++] = ins;
+    if (Length >= 2) {
+      memory[address++] = static_cast<Byte>(random());
+    }
+    if (Length == 3) {
+      memory[address++] = DataPage(random);
+    }
+    return address;
+  }
+
+  /** count instructions picked from opcodes at address, returns the
+   *  address after them **/
+  inline Word WriteRandomInstructions(std::mt19937 &random, Mem &memory, Word address, int count,
+                                      const std::vector<Byte> &opcodes) {
+    for (int i = 0; i < count; i++) {
+      address = WriteInstruction(random, memory, address, opcodes[random() % opcodes.size()]);
+    }
+    return address;
+  }
+
+  /** random loads and stores at 0x8000 ending in a JSR back to 0x8000 **/
+  inline void WriteLoopingProgram(std::mt19937 &random, Mem &memory, int instructions) {
+    Word address = 0x8000;
+    for (int i = 0; i < instructions; i++) {
+      const bool store = random() % 3 == 0;
+      const Byte Ins = store ? Stores[random() % std::size(Stores)] : Loads[random() % std::size(Loads)];
+      address = WriteInstruction(random, memory, address, Ins);
+    }
+    memory[address++] = CPU::INS_JSR;
+    memory[address++] = 0x00;
+    memory[address++] = 0x80;
+  }
+
+  /** zero page pointers into 0x2000-0x5FFF, every odd byte is a high byte **/
+  inline void WritePointers(std::mt19937 &random, Mem &memory) {
+    for (Word address = 0; address < 0x100; address++) {
+      memory[address] = address & 1 ? DataPage(random) : static_cast<Byte>(random());
+    }
+  }
+
+  /** the pointers and some bytes of the data they point at **/
+  inline void WriteData(std::mt19937 &random, Mem &memory) {
+    WritePointers(random, memory);
+    for (Word address = 0x2000; address < 0x6100; address += 0x37) {
+      memory[address] = static_cast<Byte>(random());
+    }
+  }
+
+  inline void VerifySameState(const CPU &cpu, const CPU &expected) {
+    EXPECT_EQ(cpu.programCounter, expected.programCounter);
+    EXPECT_EQ(cpu.stackPointer, expected.stackPointer);
+    EXPECT_EQ(cpu.accumulator, expected.accumulator);
+    EXPECT_EQ(cpu.indexRegX, expected.indexRegX);
+    EXPECT_EQ(cpu.indexRegY, expected.indexRegY);
+    EXPECT_EQ(cpu.processorStatus, expected.processorStatus);
+  }
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_debug.h>
+#include <memory>
+
+class My6502RunUntilTests : public testing::Test {
+public:
+  using Byte           = my6502::Byte;
+  using Word           = my6502::Word;
+  using CPU            = my6502::CPU;
+  using Mem            = my6502::Mem;
+  using StopConditions = my6502::StopConditions;
+  using StopReason     = my6502::StopReason;
+  using ExecResult     = my6502::ExecResult;
+  using s32            = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  std::unique_ptr<StopConditions> until = std::make_unique<StopConditions>();
+  CPU cpu{};
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { ; }
+
+  /** LDA #$42, STA $10, LDX $20, STX $30, LDY #$00 from 0x8000 on **/
+  void WriteProgram() {
+    Mem &m = *mem;
+    m[0x8000] = CPU::INS_LDA_IMMEDIATE;
+    m[0x8001] = 0x42;
+    m[0x8002] = CPU::INS_STA_ZEROPAGE;
+    m[0x8003] = 0x10;
+    m[0x8004] = CPU::INS_LDX_ZEROPAGE;
+    m[0x8005] = 0x20;
+    m[0x8006] = CPU::INS_STX_ZEROPAGE;
+    m[0x8007] = 0x30;
+    m[0x8008] = CPU::INS_LDY_IMMEDIATE;
+    m[0x8009] = 0x00;
+    m[0x0020] = 0x77;
+  }
+};
+
+TEST_F(My6502RunUntilTests, StopsAtABreakpointAndResumesFromIt) {
+  // given:
+  WriteProgram();
+  until->SetBreakpoint(0x8004);
+
+  // when:
+  const ExecResult First = cpu.RunUntil(1000, *mem, *until);
+  const ExecResult Second = cpu.RunUntil(3 + 3, *mem, *until);
+
+  // then:
+  EXPECT_EQ(First.reason, StopReason::Breakpoint);
+  EXPECT_EQ(First.instructions, 2u);
+  EXPECT_EQ(First.cyclesUsed, 2 + 3);
+  EXPECT_EQ(Second.reason, StopReason::Cycles);
+  EXPECT_EQ(Second.instructions, 2u);
+  EXPECT_EQ(cpu.programCounter, 0x8008);
+  EXPECT_EQ((*mem)[0x0030], 0x77);
+}
+
+TEST_F(My6502RunUntilTests, StopsAfterTheInstructionThatWritesAWatchedAddress) {
+  // given:
+  WriteProgram();
+  until->WatchWrites(0x0030);
+
+  // when:
+  const ExecResult Result = cpu.RunUntil(1000, *mem, *until);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::WriteWatch);
+  EXPECT_EQ(Result.address, 0x0030);
+  EXPECT_EQ(Result.instructions, 4u);
+  EXPECT_EQ((*mem)[0x0030], 0x77);
+  EXPECT_EQ(cpu.programCounter, 0x8008);
+}
+
+TEST_F(My6502RunUntilTests, StopsAfterTheInstructionThatReadsAWatchedAddress) {
+  // given:
+  WriteProgram();
+  until->WatchReads(0x0020);
+  until->WatchReads(0x0010); // only written
+  until->Unwatch(0x0010);
+
+  // when:
+  const ExecResult Result = cpu.RunUntil(1000, *mem, *until);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::ReadWatch);
+  EXPECT_EQ(Result.address, 0x0020);
+  EXPECT_EQ(Result.instructions, 3u);
+  EXPECT_EQ(cpu.indexRegX, 0x77);
+  EXPECT_TRUE(until->Watching());
+}
+
+TEST_F(My6502RunUntilTests, StopsAfterAnInstructionCount) {
+  // given:
+  WriteProgram();
+  until->instructions = 3;
+
+  // when:
+  const ExecResult Result = cpu.RunUntil(1000, *mem, *until);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::Instructions);
+  EXPECT_EQ(Result.instructions, 3u);
+  EXPECT_EQ(Result.cyclesUsed, 2 + 3 + 3);
+  EXPECT_EQ(cpu.programCounter, 0x8006);
+}
+
+TEST_F(My6502RunUntilTests, StopsWhenThePredicateHolds) {
+  // given:
+  WriteProgram();
+  until->predicate = [](const CPU &cpu, void *) { return cpu.Flag.zeroFlag == 0 && cpu.indexRegX != 0; };
+
+  // when:
+  const ExecResult Result = cpu.RunUntil(1000, *mem, *until);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::Predicate);
+  EXPECT_EQ(Result.instructions, 3u);
+  EXPECT_EQ(cpu.programCounter, 0x8006);
+}
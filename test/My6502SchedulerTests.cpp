@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_bus.h>
+#include <emu6502_irq.h>
+#include <emu6502_scheduler.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+  /** logs when it is brought up to date, its events come every period cycles **/
+  struct Recorder {
+    std::vector<int> *log;
+    int id;
+    std::uint64_t next;
+    std::uint64_t period = 0;
+
+    static std::uint64_t CatchUp(void *device, std::uint64_t now) {
+      Recorder &r = *static_cast<Recorder *>(device);
+      if (r.next <= now) {
+        r.log->push_back(r.id);
+        r.next = r.period != 0 ? r.next + r.period : my6502::Scheduler::NEVER;
+      }
+      return r.next;
+    }
+  };
+
+  /** a one shot timer: writing n starts it, it raises its IRQ n cycles
+   *  later, reading acknowledges the IRQ and gives the low byte of the
+   *  cycle it was brought up to **/
+  struct Countdown {
+    my6502::InterruptController *irq;
+    my6502::InterruptController::Source source;
+    std::uint64_t expires = my6502::Scheduler::NEVER;
+    std::uint64_t synced = 0;
+
+    static std::uint64_t CatchUp(void *device, std::uint64_t now) {
+      Countdown &c = *static_cast<Countdown *>(device);
+      c.synced = now;
+      if (c.expires <= now) {
+        c.irq->Raise(c.source);
+        c.expires = my6502::Scheduler::NEVER;
+      }
+      return c.expires;
+    }
+    static my6502::Byte Read(void *device, my6502::Word) {
+      Countdown &c = *static_cast<Countdown *>(device);
+      c.irq->Release(c.source);
+      return static_cast<my6502::Byte>(c.synced);
+    }
+    static void Write(void *device, my6502::Word, my6502::Byte value) {
+      Countdown &c = *static_cast<Countdown *>(device);
+      c.expires = c.synced + value;
+    }
+  };
+}
+
+class My6502SchedulerTests : public testing::Test {
+public:
+  using Byte                = my6502::Byte;
+  using Word                = my6502::Word;
+  using CPU                 = my6502::CPU;
+  using Mem                 = my6502::Mem;
+  using Bus                 = my6502::Bus;
+  using Scheduler           = my6502::Scheduler;
+  using InterruptController = my6502::InterruptController;
+  using Line                = my6502::InterruptController::Line;
+  using ExecResult          = my6502::ExecResult;
+  using StopReason          = my6502::StopReason;
+  using s32                 = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+  InterruptController irq;
+  std::vector<int> log;
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { ; }
+};
+
+TEST_F(My6502SchedulerTests, RunsDueEventsInOrderAcrossTheWheelAndTheOverflow) {
+  // given:
+  Scheduler scheduler;
+  Recorder a{&log, 1, 300}, b{&log, 2, 5}, c{&log, 3, 260}, d{&log, 4, 5};
+  scheduler.Add(&Recorder::CatchUp, &a, a.next);
+  scheduler.Add(&Recorder::CatchUp, &b, b.next);
+  scheduler.Add(&Recorder::CatchUp, &c, c.next);
+  scheduler.Add(&Recorder::CatchUp, &d, d.next);
+
+  // when:
+  const std::uint64_t First = scheduler.NextEvent();
+  scheduler.Elapse(5);
+  scheduler.RunDue();
+  const std::uint64_t Second = scheduler.NextEvent();
+  scheduler.Elapse(400);
+  scheduler.RunDue();
+
+  // then:
+  EXPECT_EQ(First, 5u);
+  EXPECT_EQ(Second, 260u);
+  ASSERT_EQ(log.size(), 4u);
+  EXPECT_EQ(std::min(log[0], log[1]), 2);
+  EXPECT_EQ(std::max(log[0], log[1]), 4);
+  EXPECT_EQ(log[2], 3);
+  EXPECT_EQ(log[3], 1);
+  EXPECT_EQ(scheduler.NextEvent(), Scheduler::NEVER);
+  EXPECT_EQ(scheduler.catchUps, 4u);
+}
+
+TEST_F(My6502SchedulerTests, KeepsAPeriodicDeviceOnTimeOverManyTurnsOfTheWheel) {
+  // given:
+  Scheduler scheduler;
+  Recorder timer{&log, 1, 100, 100};
+  scheduler.Add(&Recorder::CatchUp, &timer, timer.next);
+  Recorder late{&log, 2, 5000};
+  const Scheduler::Device Late = scheduler.Add(&Recorder::CatchUp, &late, late.next);
+  scheduler.Reschedule(Late, 40); // moved from the overflow onto the wheel
+
+  // when:
+  while (scheduler.Now() + 37 <= 10000) {
+    scheduler.Elapse(37);
+    scheduler.RunDue();
+  }
+
+  // then:
+  EXPECT_EQ(std::count(log.begin(), log.end(), 1), 99); // 100 .. 9900, the clock stops at 9990
+  EXPECT_EQ(std::count(log.begin(), log.end(), 2), 1);  // caught up early at 40, then due at 5000
+  EXPECT_EQ(timer.next, 10000u);
+  EXPECT_EQ(scheduler.catchUps, 99u + 2u);
+}
+
+TEST_F(My6502SchedulerTests, ADeviceIsBroughtUpToTheCycleOfTheInstructionTouchingIt) {
+  // given:
+  Mem &m = *mem;
+  for (Word address = 0x8000; address < 0x8006; address += 2) {
+    m[address] = CPU::INS_LDA_IMMEDIATE;
+    m[address + 1] = 0x00;
+  }
+  m[0x8006] = CPU::INS_LDA_ABS;
+  m[0x8007] = 0x01;
+  m[0x8008] = 0xD0;
+  Bus bus{m};
+  Countdown timer{&irq, irq.AddSource(Line::IRQ)};
+  irq.scheduler.Map(bus, 0xD0, 0xD0, &Countdown::Read, &Countdown::Write, &Countdown::CatchUp, &timer);
+
+  // when:
+  const ExecResult Result = irq.Run(cpu, 3 * 2 + 4, bus);
+
+  // then:
+  EXPECT_EQ(Result.cyclesUsed, 3 * 2 + 4);
+  EXPECT_EQ(cpu.accumulator, 7); // the cycle after the opcode fetch of LDA $D001
+  EXPECT_EQ(irq.scheduler.catchUps, 1u); // not ticked, only synced on the read
+  EXPECT_EQ(irq.stretches, 1u);
+}
+
+TEST_F(My6502SchedulerTests, ADeviceWriteEndsTheStretchAtItsNextEvent) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_LDA_IMMEDIATE;
+  m[0x8001] = 20;
+  m[0x8002] = CPU::INS_STA_ABSOLUTE; // starts the timer at cycle 3, it runs out at 23
+  m[0x8003] = 0x00;
+  m[0x8004] = 0xD0;
+  for (Word address = 0x8005; address < 0x8100; address += 2) {
+    m[address] = CPU::INS_LDA_IMMEDIATE;
+    m[address + 1] = 0x00;
+  }
+  m[0x9000] = 0x02; // KIL
+  m[CPU::IRQ_VECTOR] = 0x00;
+  m[CPU::IRQ_VECTOR + 1] = 0x90;
+  Bus bus{m};
+  Countdown timer{&irq, irq.AddSource(Line::IRQ)};
+  irq.scheduler.Map(bus, 0xD0, 0xD0, &Countdown::Read, &Countdown::Write, &Countdown::CatchUp, &timer);
+
+  // when:
+  const ExecResult Result = irq.Run(cpu, 1000, bus);
+
+  // then:
+  EXPECT_EQ(Result.reason, StopReason::Halt);
+  EXPECT_EQ(Result.cyclesUsed, 24 + InterruptController::INTERRUPT_CYCLES);
+  EXPECT_EQ(irq.stretches, 2u); // cut short at the write, then the handler
+  EXPECT_EQ(irq.irqsTaken, 1u);
+  // taken after the LDA running at cycle 23, in front of the one at 24
+  EXPECT_EQ(m[0x01FF], 0x80);
+  EXPECT_EQ(m[0x01FE], 0x17);
+}
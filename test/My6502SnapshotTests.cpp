@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_snapshot.h>
+#include "My6502TempFiles.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class My6502SnapshotTests : public testing::Test {
+public:
+  using Byte     = my6502::Byte;
+  using Word     = my6502::Word;
+  using CPU      = my6502::CPU;
+  using Mem      = my6502::Mem;
+  using Snapshot = my6502::Snapshot;
+  using s32      = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+  std::string path = my6502test::TempPath("my6502_snapshot");
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { remove(path.c_str()); }
+
+  /** LDA #$42, LDX #$80, STX $10 at 0x8000, a byte of data at 0x3000 **/
+  void WriteProgram() {
+    Mem &m = *mem;
+    m[0x8000] = CPU::INS_LDA_IMMEDIATE;
+    m[0x8001] = 0x42;
+    m[0x8002] = CPU::INS_LDX_IMMEDIATE;
+    m[0x8003] = 0x80;
+    m[0x8004] = CPU::INS_STX_ZEROPAGE;
+    m[0x8005] = 0x10;
+    m[0x3000] = 0x99;
+  }
+};
+
+TEST_F(My6502SnapshotTests, RestoresRegistersAndMemory) {
+  // given:
+  WriteProgram();
+  cpu.Execute(2 + 2, *mem);
+  std::vector<Byte> bytes;
+  Snapshot::Take(cpu, *mem, bytes);
+  CPU restored{};
+  auto restoredMem = std::make_unique<Mem>();
+  restored.Reset(0x0000, *restoredMem);
+  (*restoredMem)[0x4000] = 0x11; // not in the snapshot, zeroed by Restore
+
+  // when:
+  Snapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(bytes.data(), bytes.size()));
+  ASSERT_TRUE(snapshot.Restore(restored, *restoredMem));
+
+  // then:
+  EXPECT_EQ(restored.programCounter, cpu.programCounter);
+  EXPECT_EQ(restored.stackPointer, cpu.stackPointer);
+  EXPECT_EQ(restored.accumulator, 0x42);
+  EXPECT_EQ(restored.indexRegX, 0x80);
+  EXPECT_EQ(restored.processorStatus, cpu.processorStatus);
+  EXPECT_EQ(memcmp(restoredMem->Data, mem->Data, Mem::MAX_MEM), 0);
+  EXPECT_EQ((*restoredMem)[0x4000], 0x00);
+}
+
+TEST_F(My6502SnapshotTests, StoresTheStatusInTheOrderOfThe6502) {
+  // given:
+  cpu.Flag.carryFlag = 1;
+  cpu.Flag.zeroFlag = 0;
+  cpu.Flag.interruptDisable = 1;
+  cpu.Flag.decimalMode = 0;
+  cpu.Flag.breakCommand = 1;
+  cpu.Flag.overflowFlag = 0;
+  cpu.Flag.negativeFlag = 1;
+  std::vector<Byte> bytes;
+  CPU restored{};
+
+  // when:
+  Snapshot::Take(cpu, *mem, bytes);
+  Snapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(bytes.data(), bytes.size()));
+  ASSERT_TRUE(snapshot.Restore(restored, *mem));
+
+  // then:
+  EXPECT_EQ(bytes[22], 0b10110101); // N V 1 B D I Z C
+  EXPECT_EQ(restored.Flag.carryFlag, 1);
+  EXPECT_EQ(restored.Flag.zeroFlag, 0);
+  EXPECT_EQ(restored.Flag.interruptDisable, 1);
+  EXPECT_EQ(restored.Flag.decimalMode, 0);
+  EXPECT_EQ(restored.Flag.breakCommand, 1);
+  EXPECT_EQ(restored.Flag.overflowFlag, 0);
+  EXPECT_EQ(restored.Flag.negativeFlag, 1);
+}
+
+TEST_F(My6502SnapshotTests, StoresOnlyPagesThatAreNotZero) {
+  // given:
+  WriteProgram();
+  std::vector<Byte> bytes;
+
+  // when:
+  Snapshot::Take(cpu, *mem, bytes);
+
+  // then:
+  EXPECT_EQ(bytes.size(), Snapshot::HEADER_SIZE + 2 * Mem::PAGE_SIZE);
+  Snapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(bytes.data(), bytes.size()));
+  EXPECT_EQ(snapshot.StoredPages(), 2u);
+  EXPECT_EQ(snapshot.Page(0x00), nullptr);
+  ASSERT_NE(snapshot.Page(0x30), nullptr);
+  EXPECT_EQ(snapshot.Page(0x30)[0x00], 0x99);
+  ASSERT_NE(snapshot.Page(0x80), nullptr);
+  EXPECT_EQ(snapshot.Page(0x80)[0x01], 0x42);
+}
+
+TEST_F(My6502SnapshotTests, ResumesARunFromAFile) {
+  // given:
+  WriteProgram();
+  cpu.Execute(2 + 2, *mem);
+  ASSERT_TRUE(Snapshot::Save(path.c_str(), cpu, *mem));
+  CPU resumed{};
+  auto resumedMem = std::make_unique<Mem>();
+  resumed.Reset(0x0000, *resumedMem);
+  Snapshot snapshot;
+  ASSERT_TRUE(snapshot.Open(path.c_str()));
+  ASSERT_TRUE(snapshot.Restore(resumed, *resumedMem));
+
+  // when:
+  const s32 CyclesUsed = resumed.Execute(3, *resumedMem).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, 3);
+  EXPECT_EQ(resumed.programCounter, 0x8006);
+  EXPECT_EQ((*resumedMem)[0x0010], 0x80);
+}
+
+TEST_F(My6502SnapshotTests, RejectsOtherVersionsAndShortData) {
+  // given:
+  WriteProgram();
+  std::vector<Byte> bytes;
+  Snapshot::Take(cpu, *mem, bytes);
+  std::vector<Byte> newer = bytes;
+  newer[8] = Snapshot::VERSION + 1;
+  Snapshot snapshot;
+
+  // when:
+  const bool OpenedNewer = snapshot.Open(newer.data(), newer.size());
+  const bool OpenedShort = snapshot.Open(bytes.data(), bytes.size() - 1);
+
+  // then:
+  EXPECT_FALSE(OpenedNewer);
+  EXPECT_FALSE(OpenedShort);
+  EXPECT_FALSE(snapshot.IsOpen());
+  EXPECT_FALSE(snapshot.Restore(cpu, *mem));
+}
@@ -41,7 +41,7 @@ void My6502StoreRegisterTests::TestStoreRegisterZeroPage(Byte OpcodeToTest, RegP
   constexpr s32 expected_cyles = 3;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
@@ -60,7 +60,7 @@ void My6502StoreRegisterTests::TestStoreRegisterAbsolute(Byte OpcodeToTest, RegP
   constexpr s32 expected_cyles = 4;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
@@ -79,7 +79,7 @@ void My6502StoreRegisterTests::TestStoreRegisterZeroPageX(Byte OpcodeToTest, Reg
   constexpr s32 expected_cyles = 4;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
@@ -131,7 +131,7 @@ TEST_F(My6502StoreRegisterTests, STAAbsoluteXCanStoreTheARegisterIntoMemory) {
   constexpr s32 expected_cyles = 5;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
@@ -150,7 +150,7 @@ TEST_F(My6502StoreRegisterTests, STAAbsoluteYCanStoreTheARegisterIntoMemory) {
   constexpr s32 expected_cyles = 5;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
@@ -171,7 +171,7 @@ TEST_F(My6502StoreRegisterTests, STAIndirectXCanStoreTheARegisterIntoMemory) {
   constexpr s32 expected_cyles = 6;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
@@ -192,10 +192,29 @@ TEST_F(My6502StoreRegisterTests, STAIndirectYCanStoreTheARegisterIntoMemory) {
   constexpr s32 expected_cyles = 6;
 
   // when:
-  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem);
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
 
   // then:
   EXPECT_EQ(CyclesUsed, expected_cyles);
   EXPECT_EQ(mem[0x8000 + 0x0F], 0x34);
   VerifyUnmodifiedFlagsFromStoreRegister(cpu, CPUCopy);
 }
+
+TEST_F(My6502StoreRegisterTests, STAKeepsTheZeroAndNegativeFlagsBothSet) {
+  // given:
+  cpu.Flag.zeroFlag = 1;
+  cpu.Flag.negativeFlag = 1;
+  CPU CPUCopy = cpu;
+  cpu.accumulator = 0x34;
+  mem[0xFFFC] = CPU::INS_STA_ZEROPAGE;
+  mem[0xFFFD] = 0x69;
+  constexpr s32 expected_cyles = 3;
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(expected_cyles, mem).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, expected_cyles);
+  EXPECT_EQ(mem[0x0069], 0x34);
+  VerifyUnmodifiedFlagsFromStoreRegister(cpu, CPUCopy);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+
+namespace my6502test {
+  /** a file in the test temp directory no other test uses, ctest runs
+   *  every test in its own process and may run them side by side **/
+  inline std::string TempPath(const char *prefix) {
+    const testing::TestInfo *Test = testing::UnitTest::GetInstance()->current_test_info();
+    return testing::TempDir() + prefix + "_" + Test->test_suite_name() + "_" + Test->name()
+      + "_" + std::to_string(getpid()) + ".bin";
+  }
+}
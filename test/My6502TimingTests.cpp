@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_opcodes.h>
+#include "My6502RandomPrograms.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+class My6502TimingTests : public testing::Test {
+public:
+  using Byte   = my6502::Byte;
+  using Word   = my6502::Word;
+  using u32    = my6502::u32;
+  using CPU    = my6502::CPU;
+  using Mem    = my6502::Mem;
+  using Timing = my6502::CPU::Timing;
+  using s32    = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { ; }
+
+  /** count random instructions of every implemented opcode that does
+   *  not jump. Every byte of the zero page is a high byte of the data at
+   *  0x2000-0x60FF, so all pointers and indexed addresses stay below the
+   *  program **/
+  void WriteRandomProgram(u32 count) {
+    std::vector<Byte> opcodes;
+    for (u32 op = 0; op < 256; op++) {
+      const my6502::Mnemonic Name = my6502::OpcodeInfoTable[op].mnemonic;
+      if (CPU::Decode(static_cast<Byte>(op)).cycles != 0
+          && Name != my6502::Mnemonic::JSR && Name != my6502::Mnemonic::RTS
+          && Name != my6502::Mnemonic::BRK && Name != my6502::Mnemonic::RTI
+          && Name != my6502::Mnemonic::JMP && my6502::OpcodeInfoTable[op].mode != CPU::AddrMode::Relative) {
+        opcodes.push_back(static_cast<Byte>(op));
+      }
+    }
+    std::mt19937 random(12345);
+    for (Word address = 0x0000; address < 0x0100; address++) {
+      (*mem)[address] = my6502test::DataPage(random);
+    }
+    my6502test::WriteRandomInstructions(random, *mem, 0x8000, static_cast<int>(count), opcodes);
+  }
+};
+
+TEST_F(My6502TimingTests, FastAndExactModesLeaveTheSameState) {
+  // given:
+  constexpr s32 Instructions = 3000;
+  WriteRandomProgram(Instructions);
+  CPU exact = cpu;
+  auto exactMem = std::make_unique<Mem>(*mem);
+
+  // when:
+  const s32 InstructionsRun = cpu.Execute<Timing::Fast>(Instructions, *mem).cyclesUsed;
+  s32 cyclesUsed = 0;
+  for (s32 n = 0; n < Instructions; n++) {
+    cyclesUsed += exact.Execute<Timing::Exact>(1, *exactMem).cyclesUsed; // one cycle starts exactly one instruction
+  }
+
+  // then:
+  EXPECT_EQ(InstructionsRun, Instructions);
+  EXPECT_GE(cyclesUsed, 2 * Instructions);
+  my6502test::VerifySameState(cpu, exact);
+  EXPECT_EQ(memcmp(mem->Data, exactMem->Data, Mem::MAX_MEM), 0);
+}
+
+TEST_F(My6502TimingTests, FastModeCountsInstructionsNotCycles) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_JSR;
+  m[0x8001] = 0x00;
+  m[0x8002] = 0x90;
+  m[0x9000] = CPU::INS_LDA_ABSX;
+  m[0x9001] = 0x80;
+  m[0x9002] = 0x20;
+  m[0x9003] = CPU::INS_RTS;
+  m[0x8003] = CPU::INS_LDA_IMMEDIATE;
+  m[0x8004] = 0x42;
+  cpu.indexRegX = 0xFF;
+
+  // when:
+  const s32 InstructionsRun = cpu.Execute<Timing::Fast>(4, m).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(InstructionsRun, 4);
+  EXPECT_EQ(cpu.programCounter, 0x8005);
+  EXPECT_EQ(cpu.accumulator, 0x42);
+}
+
+TEST_F(My6502TimingTests, ExactModeIsThePlainInterpreter) {
+  // given:
+  Mem &m = *mem;
+  m[0x8000] = CPU::INS_LDA_ABSX; // crosses a page, one more cycle
+  m[0x8001] = 0x80;
+  m[0x8002] = 0x20;
+  m[0x8003] = CPU::INS_STA_ZEROPAGE;
+  m[0x8004] = 0x10;
+  cpu.indexRegX = 0xFF;
+  CPU plain = cpu;
+  auto plainMem = std::make_unique<Mem>(m);
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute<Timing::Exact>(5 + 3, m).cyclesUsed;
+  const s32 PlainCyclesUsed = plain.Execute(5 + 3, *plainMem).cyclesUsed;
+
+  // then:
+  EXPECT_EQ(CyclesUsed, 5 + 3);
+  EXPECT_EQ(CyclesUsed, PlainCyclesUsed);
+  EXPECT_EQ(cpu.programCounter, plain.programCounter);
+}
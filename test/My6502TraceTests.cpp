@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <emu6502.h>
+#include <emu6502_trace.h>
+#include "My6502TempFiles.h"
+#include <memory>
+#include <string>
+
+class My6502TraceTests : public testing::Test {
+public:
+  using Byte          = my6502::Byte;
+  using Word          = my6502::Word;
+  using CPU           = my6502::CPU;
+  using Mem           = my6502::Mem;
+  using TraceRecorder = my6502::TraceRecorder;
+  using TraceReader   = my6502::TraceReader;
+  using s32           = my6502::s32;
+
+  // 64 KiB, kept off the stack
+  std::unique_ptr<Mem> mem = std::make_unique<Mem>();
+  CPU cpu{};
+  std::string path = my6502test::TempPath("my6502_trace");
+
+	virtual void SetUp() {
+		cpu.Reset(0x8000, *mem); }
+  virtual void TearDown() { remove(path.c_str()); }
+
+  /** LDA #$00, LDX #$80, STX $10 from start on **/
+  void WriteProgram(Word start) {
+    Mem &m = *mem;
+    m[start + 0] = CPU::INS_LDA_IMMEDIATE;
+    m[start + 1] = 0x00;
+    m[start + 2] = CPU::INS_LDX_IMMEDIATE;
+    m[start + 3] = 0x80;
+    m[start + 4] = CPU::INS_STX_ZEROPAGE;
+    m[start + 5] = 0x10;
+  }
+};
+
+TEST_F(My6502TraceTests, RecordsEveryInstructionWithTheRegistersAfterIt) {
+  // given:
+  WriteProgram(0x8000);
+  TraceRecorder recorder(*mem);
+  ASSERT_TRUE(recorder.Open(path.c_str()));
+
+  // when:
+  const s32 CyclesUsed = cpu.Execute(2 + 2 + 3, *mem, recorder).cyclesUsed;
+  ASSERT_TRUE(recorder.Close());
+
+  // then:
+  EXPECT_EQ(CyclesUsed, 2 + 2 + 3);
+  TraceReader reader;
+  ASSERT_TRUE(reader.Open(path.c_str()));
+  ASSERT_EQ(reader.Size(), 3u);
+  EXPECT_EQ(reader[0].pc, 0x8000);
+  EXPECT_EQ(reader[0].opcode, CPU::INS_LDA_IMMEDIATE);
+  EXPECT_EQ(reader[0].operands[0], 0x00);
+  EXPECT_EQ(reader[0].Cycles(), 2u);
+  EXPECT_EQ(reader[0].processorStatus & 0b10, 0b10); // zero flag
+  EXPECT_EQ(reader[1].pc, 0x8002);
+  EXPECT_EQ(reader[1].indexRegX, 0x80);
+  EXPECT_EQ(reader[1].processorStatus & 0b1000000, 0b1000000); // negative flag
+  EXPECT_EQ(reader[1].Cycles(), 4u);
+  EXPECT_EQ(reader[2].opcode, CPU::INS_STX_ZEROPAGE);
+  EXPECT_EQ(reader[2].operands[0], 0x10);
+  EXPECT_EQ(reader[2].Cycles(), 7u);
+}
+
+TEST_F(My6502TraceTests, KeepsEveryRecordWhenTheRingWrapsAround) {
+  // given:
+  const Word Start = 0x0200;
+  const int Passes = 10000;
+  for (int pass = 0; pass < Passes; pass++) {
+    WriteProgram(static_cast<Word>(Start + pass * 6));
+  }
+  cpu.programCounter = Start;
+  TraceRecorder recorder(*mem, 64);
+  ASSERT_TRUE(recorder.Open(path.c_str()));
+
+  // when:
+  for (int pass = 0; pass < Passes; pass++) {
+    cpu.Execute(2 + 2 + 3, *mem, recorder);
+  }
+  ASSERT_TRUE(recorder.Close());
+
+  // then:
+  TraceReader reader;
+  ASSERT_TRUE(reader.Open(path.c_str()));
+  ASSERT_EQ(reader.Size(), 3u * Passes);
+  for (my6502::u32 n = 0; n < reader.Size(); n++) {
+    ASSERT_EQ(reader[n].pc, Start + 6 * (n / 3) + 2 * (n % 3)) << "record " << n;
+  }
+  EXPECT_EQ(reader[reader.Size() - 1].Cycles(), 7u * Passes);
+}
+
+TEST_F(My6502TraceTests, FindsTheInstructionOfACycle) {
+  // given:
+  const Word Start = 0x0200;
+  const int Passes = 5000;
+  for (int pass = 0; pass < Passes; pass++) {
+    WriteProgram(static_cast<Word>(Start + pass * 6));
+  }
+  cpu.programCounter = Start;
+  TraceRecorder recorder(*mem);
+  ASSERT_TRUE(recorder.Open(path.c_str()));
+  cpu.Execute(7 * Passes, *mem, recorder);
+  ASSERT_TRUE(recorder.Close());
+  TraceReader reader;
+  ASSERT_TRUE(reader.Open(path.c_str()));
+
+  // when:
+  const my6502::u32 Exact = reader.FindCycle(7 * 3000 + 4);
+  const my6502::u32 Between = reader.FindCycle(7 * 3000 + 5);
+  const my6502::u32 Past = reader.FindCycle(7 * Passes + 1);
+
+  // then:
+  EXPECT_EQ(Exact, 3 * 3000 + 1);
+  EXPECT_EQ(Between, 3 * 3000 + 2);
+  EXPECT_EQ(Past, reader.Size());
+  EXPECT_EQ(reader.FindCycle(0), 0u);
+}
+
+TEST_F(My6502TraceTests, RejectsFilesThatAreNoTraces) {
+  // given:
+  FILE *file = fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  fputs("not a trace, just a few bytes of text that fill the header size ....", file);
+  fclose(file);
+  TraceReader reader;
+
+  // when:
+  const bool Opened = reader.Open(path.c_str());
+
+  // then:
+  EXPECT_FALSE(Opened);
+  EXPECT_EQ(reader.Size(), 0u);
+}
@@ -0,0 +1,70 @@
+#include <emu6502_aot.h>
+#include <emu6502_image.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/** Translates the code of a ROM image to a C++ translation unit that
+ *  defines a my6502::StaticCode::Program, see emu6502_aot.h. Built into
+ *  a native executable with my6502_add_aot_executable of
+ *  cmake/My6502Aot.cmake.
+ *
+ *  usage: my6502_aot <image> <raw|prg|hex|nes> <out.cpp> [--name symbol] [--address hex]
+ *  --address is the load address of a raw image, $8000 unless given.
+ **/
+
+namespace {
+
+  using namespace my6502;
+
+  bool ParseFormat(const char *text, Image::Format &format) {
+    const struct { const char *name; Image::Format format; } Formats[] = {
+      {"raw", Image::Format::Raw}, {"prg", Image::Format::PRG},
+      {"hex", Image::Format::IntelHex}, {"nes", Image::Format::INES}};
+    for (const auto &f : Formats) {
+      if (std::strcmp(text, f.name) == 0) {
+        format = f.format;
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+int main(int argc, char **argv) {
+  Image::Format format{};
+  if (argc < 4 || !ParseFormat(argv[2], format)) {
+    fprintf(stderr, "usage: %s <image> <raw|prg|hex|nes> <out.cpp> [--name symbol] [--address hex]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *name = "my6502_program";
+  Word address = 0x8000;
+  for (int i = 4; i < argc; i++) {
+    if (std::strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+      name = argv[++i];
+    } else if (std::strcmp(argv[i], "--address") == 0 && i + 1 < argc) {
+      address = static_cast<Word>(std::strtoul(argv[++i], nullptr, 16));
+    } else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  Image image;
+  if (!image.Open(argv[1], format, address)) {
+    fprintf(stderr, "could not open %s as a %s image\n", argv[1], argv[2]);
+    return EXIT_FAILURE;
+  }
+  StaticRecompiler recompiler;
+  recompiler.Translate(image);
+  const std::string Source = recompiler.Source(name);
+
+  FILE *out = fopen(argv[3], "wb");
+  if (out == nullptr || fwrite(Source.data(), 1, Source.size(), out) != Source.size() || fclose(out) != 0) {
+    fprintf(stderr, "could not write %s\n", argv[3]);
+    return EXIT_FAILURE;
+  }
+  printf("%s: %u blocks\n", argv[3], static_cast<unsigned>(recompiler.Blocks().size()));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include <emu6502.h>
+#include <emu6502_aot.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+/** main of the executables my6502_add_aot_executable builds: loads the
+ *  translated program, runs it from its reset vector on StaticCode until
+ *  it stops or the cycles run out and prints where it ended.
+ *
+ *  usage: <executable> [--cycles n] [--compare]
+ *  --compare runs the same cycles on CPU::Execute as well, prints the
+ *  throughput of both and fails unless both end in the same state.
+ **/
+
+extern const my6502::StaticCode::Program my6502_program;
+
+namespace {
+
+  using namespace my6502;
+  using Clock = std::chrono::steady_clock;
+
+  constexpr s32 SLICE = 1 << 30;
+
+  /** runs cycles in slices, stops early where the run stops **/
+  template <typename Run>
+  ExecResult RunFor(std::int64_t cycles, Run run) {
+    ExecResult total{StopReason::Cycles, 0, 0, 0};
+    while (cycles > 0) {
+      const ExecResult Slice = run(static_cast<s32>(cycles < SLICE ? cycles : SLICE));
+      cycles -= Slice.cyclesUsed;
+      total.cyclesUsed += Slice.cyclesUsed;
+      total.instructions += Slice.instructions;
+      if (Slice.reason != StopReason::Cycles) {
+        total.reason = Slice.reason;
+        total.address = Slice.address;
+        break;
+      }
+    }
+    return total;
+  }
+
+  void Print(const char *engine, const CPU &cpu, const ExecResult &result, double seconds) {
+    printf("%-11s PC=$%04X A=$%02X X=$%02X Y=$%02X SP=$%02X P=$%02X  %llu instructions, %.2f MIPS\n",
+      engine, cpu.programCounter, cpu.accumulator, cpu.indexRegX, cpu.indexRegY, cpu.stackPointer,
+      cpu.StatusToPush(false), static_cast<unsigned long long>(result.instructions),
+      result.instructions / seconds / 1e6);
+  }
+}
+
+int main(int argc, char **argv) {
+  std::int64_t cycles = 100000000;
+  bool compare = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      cycles = std::atoll(argv[++i]);
+    } else if (std::strcmp(argv[i], "--compare") == 0) {
+      compare = true;
+    } else {
+      fprintf(stderr, "usage: %s [--cycles n] [--compare]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  StaticCode code(my6502_program);
+  auto mem = std::make_unique<Mem>();
+  CPU cpu{};
+  cpu.Reset(my6502_program.entry, *mem);
+  code.LoadInto(*mem);
+
+  Clock::time_point t0 = Clock::now();
+  const ExecResult Result = RunFor(cycles, [&](s32 slice) { return code.Execute(cpu, slice, *mem); });
+  Print("translated", cpu, Result, std::chrono::duration<double>(Clock::now() - t0).count());
+  printf("%llu blocks run, %llu instructions interpreted, %llu stale blocks\n",
+    static_cast<unsigned long long>(code.blocksRun), static_cast<unsigned long long>(code.interpreted),
+    static_cast<unsigned long long>(code.staleBlocks));
+  if (!compare) {
+    return EXIT_SUCCESS;
+  }
+
+  auto referenceMem = std::make_unique<Mem>();
+  CPU reference{};
+  reference.Reset(my6502_program.entry, *referenceMem);
+  code.LoadInto(*referenceMem);
+  t0 = Clock::now();
+  const ExecResult Expected = RunFor(cycles, [&](s32 slice) { return reference.Execute(slice, *referenceMem); });
+  Print("interpreted", reference, Expected, std::chrono::duration<double>(Clock::now() - t0).count());
+
+  const bool Same = Result.reason == Expected.reason && Result.cyclesUsed == Expected.cyclesUsed
+    && Result.instructions == Expected.instructions && cpu.programCounter == reference.programCounter
+    && cpu.accumulator == reference.accumulator && cpu.indexRegX == reference.indexRegX
+    && cpu.indexRegY == reference.indexRegY && cpu.stackPointer == reference.stackPointer
+    && cpu.processorStatus == reference.processorStatus
+    && std::memcmp(mem->Data, referenceMem->Data, Mem::MAX_MEM) == 0;
+  if (!Same) {
+    fprintf(stderr, "the translated program ended in another state than the interpreter\n");
+    return EXIT_FAILURE;
+  }
+  printf("same final state\n");
+  return EXIT_SUCCESS;
+}